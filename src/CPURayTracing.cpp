@@ -1,26 +1,309 @@
 ﻿#include<iostream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
 #include "ObjFileReader.h"
 #include "rayTracer.h"
+#include "rtBatchRenderer.h"
+#include "rtCameraPath.h"
+#include "rtCheckpoint.h"
+#include "rtCoordinator.h"
+#include "rtPartialImage.h"
+#include "rtRenderOptions.h"
+#include "rtRenderServer.h"
+#include "rtSceneWatcher.h"
+#include "rtStartupPipeline.h"
+
+static int CountDifferingPixels(const std::vector<std::vector<rtColor>>& pixels, const std::vector<std::vector<rtColor>>& reference)
+{
+	int differing = 0;
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		for (size_t j = 0; j < pixels[i].size(); j++)
+		{
+			const rtColor& a = pixels[i][j];
+			const rtColor& b = reference[i][j];
+			differing += (a.m_r != b.m_r || a.m_g != b.m_g || a.m_b != b.m_b) ? 1 : 0;
+		}
+	}
+	return differing;
+}
+
+// the options that change pixels, a checkpoint is only resumed with the same ones
+static std::string CheckpointSettings(const rtRenderOptions& options)
+{
+	std::ostringstream settings;
+	settings << std::setprecision(17) << options.m_lightCutoff << ' ' << options.m_lightSamples << ' ' << TextureFilterName(options.m_textureFilter)
+		<< ' ' << options.m_compactGeometry << ' ' << ShadowModeName(options.m_overrideShadows ? options.m_shadows : eShadowMode::kAll);
+	return settings.str();
+}
+
+// renders the frame unpinned, pinned and with per node scenes, the chosen policy last so its image is kept
+static void BenchmarkNumaPolicies(rayTracer& app, const rtRenderOptions& options, const std::vector<rtTile>& tiles)
+{
+	std::vector<eNumaPolicy> policies = { eNumaPolicy::kOff, eNumaPolicy::kPin, eNumaPolicy::kReplicate };
+	policies.erase(std::find(policies.begin(), policies.end(), options.m_numaPolicy));
+	policies.push_back(options.m_numaPolicy);
+
+	std::vector<std::vector<rtColor>> reference;
+	for (eNumaPolicy policy : policies)
+	{
+		app.SetNumaPolicy(policy, options.m_numaReport);
+		auto traceStart = std::chrono::steady_clock::now();
+		app.ComputePixelColor(tiles, options.m_threads);
+		auto traceTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - traceStart);
+		double seconds = std::max<long long>(1, traceTime.count()) / 1000.0;
+		std::cout << NumaPolicyName(policy) << ": traced in " << traceTime.count() << "ms on " << options.m_threads << " threads, "
+			<< app.RaysTraced() / seconds / 1e6 << " Mrays/s";
+		if (reference.empty())
+		{
+			reference = app.GetPixels();
+		}
+		else
+		{
+			std::cout << ", " << CountDifferingPixels(app.GetPixels(), reference) << " pixels differ from " << NumaPolicyName(policies[0]);
+		}
+		std::cout << std::endl;
+	}
+}
+
+// renders the frame once per acceleration structure, the chosen one last so its image is kept
+static void BenchmarkAccelerators(rayTracer& app, const rtRenderOptions& options, const std::vector<rtTile>& tiles)
+{
+	std::vector<eAcceleratorType> types = { eAcceleratorType::kBVH2, eAcceleratorType::kBVH4, eAcceleratorType::kBVH8, eAcceleratorType::kGrid };
+	// the scene is built already, auto has been resolved to the structure it picked
+	eAcceleratorType chosenType = options.m_accelerator == eAcceleratorType::kAuto ? app.AcceleratorType() : options.m_accelerator;
+	auto chosen = std::find(types.begin(), types.end(), chosenType);
+	if (chosen != types.end())
+	{
+		types.erase(chosen);
+		types.push_back(chosenType);
+	}
+
+	std::vector<std::vector<rtColor>> reference;
+	for (eAcceleratorType type : types)
+	{
+		app.SetAccelerator(type, options.m_bvhBuild, options.m_threads);
+		auto buildStart = std::chrono::steady_clock::now();
+		app.BuildAccelerationStructure();
+		auto traceStart = std::chrono::steady_clock::now();
+		app.ComputePixelColor(tiles, options.m_threads);
+		auto traceEnd = std::chrono::steady_clock::now();
+
+		auto buildTime = std::chrono::duration_cast<std::chrono::milliseconds>(traceStart - buildStart);
+		auto traceTime = std::chrono::duration_cast<std::chrono::milliseconds>(traceEnd - traceStart);
+		double seconds = std::max<long long>(1, traceTime.count()) / 1000.0;
+		std::cout << AcceleratorTypeName(type) << ": built in " << buildTime.count() << "ms, traced in " << traceTime.count() << "ms, "
+			<< app.RaysTraced() / seconds / 1e6 << " Mrays/s";
+
+		const std::vector<std::vector<rtColor>>& pixels = app.GetPixels();
+		if (reference.empty())
+		{
+			reference = pixels;
+		}
+		else
+		{
+			std::cout << ", " << CountDifferingPixels(pixels, reference) << " pixels differ from " << AcceleratorTypeName(types[0]);
+		}
+		std::cout << std::endl;
+	}
+}
+
+// a tracer with every option set, the scene isn't loaded yet
+static std::unique_ptr<rayTracer> CreateTracer(const rtRenderOptions& options)
+{
+	auto app = std::make_unique<rayTracer>();
+	if (!options.m_detectInstructionSet)
+	{
+		app->SetInstructionSet(options.m_instructionSet);
+	}
+	app->SetLightSampling(options.m_lightCutoff, options.m_lightSamples);
+	app->SetAccelerator(options.m_accelerator, options.m_bvhBuild, options.m_threads);
+	app->SetCoherentRays(options.m_coherentRays);
+	app->SetPixelOrder(options.m_pixelOrder);
+	app->SetTextureFilter(options.m_textureFilter);
+	rtQualitySettings quality = QualitySettings(options.m_quality);
+	if (options.m_overrideShadows)
+	{
+		quality.m_shadows = options.m_shadows;
+	}
+	app->SetQuality(quality);
+	app->SetNumaPolicy(options.m_numaPolicy, options.m_numaReport);
+	if (options.m_outOfCore)
+	{
+		app->SetOutOfCore(rayTracer::OutputFilePath(options.m_outFolder, options.m_sceneFile));
+	}
+	return app;
+}
 
 int main(int argc, char* argv[])
 {
-	if (argc != 4)
+	rtRenderOptions options;
+	if (!options.parse(argc, argv))
 	{
 		std::cout << "file name required" << std::endl;
+		rtRenderOptions::printUsage();
+		return 0;
+	}
+
+	if (!options.m_mergeOutput.empty())
+	{
+		return rtPartialImage::merge(options.m_mergeOutput, options.m_mergeInputs) ? 0 : 1;
+	}
+
+	if (options.m_workers > 0)
+	{
+		rtCoordinator coordinator(options);
+		return coordinator.Run() ? 0 : 1;
+	}
+
+	auto rayTracerApp = CreateTracer(options);
+
+	// the server and camera paths set their frames up per job
+	bool singleFrame = !options.m_server && options.m_cameraPath.empty();
+	rtStartupPipeline startup;
+	if (!startup.Run(*rayTracerApp, options, singleFrame))
+	{
+		return 1;
+	}
+	if (options.m_buildReport)
+	{
+		std::cout << "kernels: " << InstructionSetName(rayTracerApp->InstructionSet()) << std::endl;
+		std::cout << "acceleration structure: " << AcceleratorTypeName(rayTracerApp->AcceleratorType());
+		if (rayTracerApp->AcceleratorType() == eAcceleratorType::kGrid)
+		{
+			std::cout << " built in " << rayTracerApp->AcceleratorBuildTime() << "ms" << std::endl;
+		}
+		else
+		{
+			std::cout << ", " << BVHBuildName(options.m_bvhBuild) << " build on " << options.m_threads << " threads in "
+				<< rayTracerApp->AcceleratorBuildTime() << "ms, SAH cost " << rayTracerApp->AcceleratorSahCost() << std::endl;
+		}
+	}
+
+	if (options.m_server)
+	{
+		rtRenderServer server(std::move(rayTracerApp), options.m_threads, options.m_shard, options.m_maxConcurrentJobs);
+		server.Run(std::cin);
 		return 0;
 	}
 
-	auto rayTracerApp = std::make_unique<rayTracer>();
+	if (options.m_watch)
+	{
+		rtSceneWatcher watcher(options, [&options]() -> std::unique_ptr<rayTracer>
+		{
+			auto app = CreateTracer(options);
+			rtStartupPipeline reload;
+			return reload.Run(*app, options, true) ? std::move(app) : nullptr;
+		});
+		return watcher.Run(std::move(rayTracerApp)) ? 0 : 1;
+	}
+
+	if (!options.m_cameraPath.empty())
+	{
+		rtCameraPath cameraPath;
+		if (!cameraPath.load(options.m_cameraPath, rayTracerApp->GetCamera()))
+		{
+			return 1;
+		}
+		rtBatchRenderer batch(*rayTracerApp, options);
+		return batch.Run(cameraPath.getFrames(), cameraPath.getMoves()) ? 0 : 1;
+	}
+
+	std::vector<rtTile> tiles = options.m_shard.buildTiles(rayTracerApp->GetImageSize());
+	if (options.m_progressiveInterval > 0 && options.m_shard.m_mode == eShardMode::kFull)
+	{
+		rayTracerApp->SetProgressiveOutput(rayTracer::OutputFilePath(options.m_outFolder, options.m_sceneFile), options.m_progressiveInterval);
+	}
+	startup.TracingStarted();
+	if (options.m_startupReport)
+	{
+		startup.PrintReport();
+	}
+	// with a checkpoint only the tiles it lacks are traced, tiles stays the whole output
+	std::vector<rtTile> pending = tiles;
+	bool checkpointing = !options.m_checkpointFile.empty() && !options.m_benchAccelerators && !options.m_benchNuma;
+	if (checkpointing)
+	{
+		uint64_t fingerprint = rtCheckpoint::fingerprint(options.m_sceneFile, CheckpointSettings(options));
+		rayTracerApp->SetCheckpoint(options.m_checkpointFile, options.m_checkpointInterval, fingerprint);
+		if (options.m_resume)
+		{
+			rayTracerApp->ResumeFromCheckpoint(pending);
+		}
+	}
+	auto traceStart = std::chrono::steady_clock::now();
+	if (options.m_benchAccelerators)
+	{
+		BenchmarkAccelerators(*rayTracerApp, options, tiles);
+	}
+	else if (options.m_benchNuma)
+	{
+		BenchmarkNumaPolicies(*rayTracerApp, options, tiles);
+	}
+	else
+	{
+		rayTracerApp->ComputePixelColor(pending, options.m_threads);
+	}
+	auto traceTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - traceStart);
+	if (options.m_rayStats)
+	{
+		double seconds = std::max<long long>(1, traceTime.count()) / 1000.0;
+		std::cout << "rays: " << rayTracerApp->RaysTraced() << " traced in " << traceTime.count() << "ms, "
+			<< rayTracerApp->RaysTraced() / seconds / 1e6 << " Mrays/s" << (options.m_coherentRays ? " (coherent)" : "") << std::endl;
+	}
+	if (options.m_geometryReport)
+	{
+		int triangles = std::max(1, rayTracerApp->TriangleCount());
+		std::cout << "geometry: " << rayTracerApp->TriangleCount() << " triangles, " << static_cast<double>(rayTracerApp->GeometryByteSize()) / triangles << " bytes per triangle" << std::endl;
+		std::cout << "traced in " << traceTime.count() << "ms" << std::endl;
+	}
 
-	rayTracerApp->Init(argv[1]);
-	rayTracerApp->ReadTextureFiles(argv[3]);
-	rayTracerApp->ComputeUV();
-	rayTracerApp->ComputeAspectRatioAndRenderPlane();
-	rayTracerApp->InitPixelArray();
-	rayTracerApp->CreatePixelIndexTo3DPointMap();
-	rayTracerApp->CreatePixelIndexToRayMap();
-	rayTracerApp->ComputePixelColor();
-	rayTracerApp->OutputFinalImage(argv[2]);
+	if (options.m_crop)
+	{
+		// the crop rectangle as the tiles cover it, clipped to the frame
+		rtTile region = tiles.empty() ? rtTile() : tiles[0];
+		for (const rtTile& tile : tiles)
+		{
+			region = rtTile(std::min(region.m_x0, tile.m_x0), std::min(region.m_y0, tile.m_y0), std::max(region.m_x1, tile.m_x1), std::max(region.m_y1, tile.m_y1));
+		}
+		if (region.empty())
+		{
+			std::cout << "The crop rectangle is outside the image" << std::endl;
+			return 1;
+		}
+		bool written = options.m_cropInto.empty()
+			? rayTracerApp->OutputCroppedImage(rayTracer::OutputFilePath(options.m_outFolder, options.m_sceneFile, "_crop"), region)
+			: rayTracerApp->OutputIntoImage(options.m_cropInto, tiles);
+		if (!written)
+		{
+			return 1;
+		}
+	}
+	else if (options.m_shard.m_mode == eShardMode::kFull)
+	{
+		rayTracerApp->OutputFinalImage(options.m_outFolder);
+	}
+	else
+	{
+		std::string partialFile = options.m_partialFile;
+		if (partialFile.empty())
+		{
+			partialFile = rayTracer::OutputFilePath(options.m_outFolder, options.m_sceneFile) + ".rtpart";
+		}
+		if (!rayTracerApp->OutputPartialImage(partialFile, tiles))
+		{
+			return 1;
+		}
+	}
+	if (checkpointing)
+	{
+		// the render is complete, nothing is left to resume
+		std::error_code error;
+		std::filesystem::remove(options.m_checkpointFile, error);
+	}
 
 	return 0;
-}
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 
 ObjFileReader::ObjFileReader()
 {
@@ -15,7 +16,7 @@ ObjFileReader::ObjFileReader(const std::string& _fileName)
 	m_fileName = _fileName;
 }
 
-std::shared_ptr<ObjFileInfo> ObjFileReader::getFileInfo()
+const std::shared_ptr<ObjFileInfo>& ObjFileReader::getFileInfo()
 {
 	return m_objFileInfo;
 }
@@ -25,6 +26,109 @@ std::string ObjFileReader::getFileName()
 	return m_fileName;
 }
 
+void ObjFileReader::setSettingsOnly(bool settingsOnly)
+{
+	m_settingsOnly = settingsOnly;
+}
+
+uint64_t ObjFileReader::getGeometryHash() const
+{
+	return m_geometryHash;
+}
+
+static bool IsSettingsKeyword(const std::string& keyword)
+{
+	static const char* const SETTINGS_KEYWORDS[] = { "eye", "viewdir", "updir", "vfov", "imsize", "bkgcolor", "mtlcolor", "texture", "light" };
+	return std::find(std::begin(SETTINGS_KEYWORDS), std::end(SETTINGS_KEYWORDS), keyword) != std::end(SETTINGS_KEYWORDS);
+}
+
+// FNV-1a over the line, after the number of materials defined before it
+static uint64_t HashLine(uint64_t hash, const std::string& line, size_t materialCount)
+{
+	hash = (hash ^ materialCount) * 1099511628211ull;
+	for (char c : line)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return (hash ^ '\n') * 1099511628211ull;
+}
+
+template <typename T>
+static void CopyArray(const std::pmr::vector<T>& from, std::pmr::vector<T>& to)
+{
+	to.assign(from.begin(), from.end());
+}
+
+std::shared_ptr<ObjFileReader> ObjFileReader::replicate() const
+{
+	auto copy = std::make_shared<ObjFileReader>(m_fileName);
+	const ObjFileInfo& from = *m_objFileInfo;
+	ObjFileInfo& to = *copy->m_objFileInfo;
+	to.eye = from.eye;
+	to.viewDir = from.viewDir;
+	to.upDir = from.upDir;
+	to.vFov = from.vFov;
+	to.imageSize = from.imageSize;
+	to.bkgColor = from.bkgColor;
+	to.materials = from.materials;
+	to.spheres = from.spheres;
+	to.lights = from.lights;
+	CopyArray(from.verteices, to.verteices);
+	CopyArray(from.vertexNormals, to.vertexNormals);
+	CopyArray(from.vertexTextureCoordinates, to.vertexTextureCoordinates);
+	CopyArray(from.faces, to.faces);
+	CopyArray(from.faceMaterialIndexs, to.faceMaterialIndexs);
+	if (from.compactFaces)
+	{
+		to.compactFaces = std::make_unique<rtCompactMesh>(*from.compactFaces);
+	}
+	to.meshes.reserve(from.meshes.size());
+	for (const rtMesh& mesh : from.meshes)
+	{
+		to.meshes.emplace_back(&to.arena);
+		rtMesh& meshCopy = to.meshes.back();
+		meshCopy.name = mesh.name;
+		CopyArray(mesh.verteices, meshCopy.verteices);
+		CopyArray(mesh.vertexNormals, meshCopy.vertexNormals);
+		CopyArray(mesh.vertexTextureCoordinates, meshCopy.vertexTextureCoordinates);
+		CopyArray(mesh.faces, meshCopy.faces);
+		CopyArray(mesh.faceMaterialIndexs, meshCopy.faceMaterialIndexs);
+		if (mesh.compact)
+		{
+			meshCopy.compact = std::make_unique<rtCompactMesh>(*mesh.compact);
+		}
+	}
+	to.instances = from.instances;
+	return copy;
+}
+
+std::vector<std::string> ObjFileReader::scanTextureFiles(const std::string& fileName)
+{
+	std::vector<std::string> textureFiles;
+	std::ifstream inFile(fileName);
+	std::string line;
+	std::string block;
+	std::istringstream iss;
+	while (std::getline(inFile, line))
+	{
+		// most lines are geometry, skip them without tokenizing
+		if (line.find("texture") == std::string::npos)
+		{
+			continue;
+		}
+		iss.clear();
+		iss.str(line);
+		while (iss >> block)
+		{
+			if (block == "texture" && iss >> block && std::find(textureFiles.begin(), textureFiles.end(), block) == textureFiles.end())
+			{
+				textureFiles.push_back(block);
+			}
+		}
+	}
+	return textureFiles;
+}
+
 eParseRetType ObjFileReader::parseFile()
 {
 	_ASSERT(m_objFileInfo);
@@ -37,7 +141,10 @@ eParseRetType ObjFileReader::parseFile()
 		return eParseRetType::kFileNotExists;
 	}
 
+	// one line buffer and one stream for the whole file, a fresh stream per line costs allocations
 	std::string line;
+	std::string block;
+	std::istringstream iss;
 
 	bool hasEye = false;
 	bool hasViewDir = false; 
@@ -45,15 +152,22 @@ eParseRetType ObjFileReader::parseFile()
 	bool hasVFov = false;
 	bool hasImgSize = false;
 	bool hasBkgColor = false;
+	rtMesh* currentMesh = nullptr;
+	m_geometryHash = 14695981039346656037ull;
 	while (std::getline(inFile, line))
 	{
-		std::istringstream iss(line);
-		std::string block;
+		iss.clear();
+		iss.str(line);
 		while (iss >> block)
 		{
+			if (m_settingsOnly && !IsSettingsKeyword(block))
+			{
+				m_geometryHash = HashLine(m_geometryHash, line, m_objFileInfo->materials.size());
+				break;
+			}
 			if (block == "eye")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -72,7 +186,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "viewdir")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -91,7 +205,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "updir")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -124,7 +238,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "imsize")
 			{
-				std::vector<int> vec(2);
+				int vec[2] = {};
 				for (int i = 0; i < 2; i++)
 				{
 					if (iss >> block)
@@ -143,7 +257,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "bkgcolor")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -162,7 +276,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "mtlcolor")
 			{
-				std::vector<double> vec(12);
+				double vec[12] = {};
 				for (int i = 0; i < 12; i++)
 				{
 					if (iss >> block)
@@ -180,7 +294,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "sphere")
 			{
-				std::vector<double> vec(4);
+				double vec[4] = {};
 				for (int i = 0; i < 4; i++)
 				{
 					if (iss >> block)
@@ -210,7 +324,7 @@ eParseRetType ObjFileReader::parseFile()
 				{
 				case eLightType::kPointLight:
 				{
-					std::vector<double> vec(6);
+					double vec[6] = {};
 					for (int i = 0; i < 6; i++)
 					{
 						if (iss >> block)
@@ -232,7 +346,7 @@ eParseRetType ObjFileReader::parseFile()
 				}
 				case eLightType::kDirectionalLight:
 				{
-					std::vector<double> vec(6);
+					double vec[6] = {};
 					for (int i = 0; i < 6; i++)
 					{
 						if (iss >> block)
@@ -254,7 +368,7 @@ eParseRetType ObjFileReader::parseFile()
 				}
 				case eLightType::kSpotlight:
 				{
-					std::vector<double> vec(10);
+					double vec[10] = {};
 					for (int i = 0; i < 10; i++)
 					{
 						if (iss >> block)
@@ -278,7 +392,7 @@ eParseRetType ObjFileReader::parseFile()
 				}
 				case eLightType::kAttPointLight:
 				{
-					std::vector<double> vec(9);
+					double vec[9] = {};
 					for (int i = 0; i < 9; i++)
 					{
 						if (iss >> block)
@@ -300,7 +414,7 @@ eParseRetType ObjFileReader::parseFile()
 				}
 				case eLightType::kAttSpotlight:
 				{
-					std::vector<double> vec(13);
+					double vec[13] = {};
 					for (int i = 0; i < 10; i++)
 					{
 						if (iss >> block)
@@ -328,7 +442,7 @@ eParseRetType ObjFileReader::parseFile()
 			}
 			else if (block == "v")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -343,11 +457,11 @@ eParseRetType ObjFileReader::parseFile()
 					}
 				}
 				rtPoint p(vec[0], vec[1], vec[2]);
-				m_objFileInfo->verteices.push_back(p);
+				(currentMesh ? currentMesh->verteices : m_objFileInfo->verteices).push_back(p);
 			}
 			else if (block == "vn")
 			{
-				std::vector<double> vec(3);
+				double vec[3] = {};
 				for (int i = 0; i < 3; i++)
 				{
 					if (iss >> block)
@@ -362,11 +476,11 @@ eParseRetType ObjFileReader::parseFile()
 					}
 				}
 				rtVector3 v(vec[0], vec[1], vec[2]);
-				m_objFileInfo->vertexNormals.push_back(v);
+				(currentMesh ? currentMesh->vertexNormals : m_objFileInfo->vertexNormals).push_back(v);
 			}
 			else if (block == "vt")
 			{
-				std::vector<double> vec(2);
+				double vec[2] = {};
 				for (int i = 0; i < 2; i++)
 				{
 					if (iss >> block)
@@ -381,37 +495,26 @@ eParseRetType ObjFileReader::parseFile()
 					}
 				}
 				rtVector2<double> v(vec[0], vec[1]);
-				m_objFileInfo->vertexTextureCoordinates.push_back(v);
+				(currentMesh ? currentMesh->vertexTextureCoordinates : m_objFileInfo->vertexTextureCoordinates).push_back(v);
 			}
 			else if (block == "f")
 			{
-				std::vector<std::vector<int>> vec;
+				rtFace face;
 				for (int i = 0; i < 3; i++)
 				{
-					std::string index;
-					int n = 0;
-					std::vector<int> face;
 					if (iss >> block)
 					{
-						for (int j = 0; j < block.size(); j++)
+						// "v", "v/vt", "v//vn" or "v/vt/vn", an empty slot between slashes reads as -1
+						int n = 0;
+						size_t start = 0;
+						for (size_t j = 0; j <= block.size() && n < 3; j++)
 						{
-							if (block[j] != '/')
-							{
-								index.push_back(block[j]);
-							}
-							else
+							if (j == block.size() || block[j] == '/')
 							{
-								n++;
-								face.push_back(index.empty() ? -1 : std::stoi(index));
-								index = "";
+								face[i][n++] = j == start ? -1 : std::atoi(block.c_str() + start);
+								start = j + 1;
 							}
 						}
-						face.push_back(std::stoi(index));
-						if (face.size() == 2)
-						{
-							face.push_back(0);
-						}
-						vec.push_back(face);
 					}
 					else
 					{
@@ -420,8 +523,72 @@ eParseRetType ObjFileReader::parseFile()
 						return eParseRetType::kEyeKeywordFormatError;
 					}
 				}
-				m_objFileInfo->faces.push_back(vec);
-				m_objFileInfo->faceMaterialIndexs.push_back(m_objFileInfo->materials.size() - 1);
+				(currentMesh ? currentMesh->faces : m_objFileInfo->faces).push_back(face);
+				(currentMesh ? currentMesh->faceMaterialIndexs : m_objFileInfo->faceMaterialIndexs).push_back(m_objFileInfo->materials.size() - 1);
+			}
+			else if (block == "mesh")
+			{
+				if (currentMesh || !(iss >> block))
+				{
+					std::cout << "-----------FILE PARSE ERROR-------------" << std::endl;
+					std::cout << "Keyword: mesh requires a name and can't be nested" << std::endl;
+					return eParseRetType::kEyeKeywordFormatError;
+				}
+				m_objFileInfo->meshes.push_back(rtMesh(&m_objFileInfo->arena));
+				currentMesh = &m_objFileInfo->meshes.back();
+				currentMesh->name = block;
+			}
+			else if (block == "endmesh")
+			{
+				currentMesh = nullptr;
+			}
+			else if (block == "instance")
+			{
+				// instance <mesh> [translate x y z] [rotate x y z degrees] [scale x y z] [material]
+				// transforms apply in the order they are written
+				rtInstance instance;
+				if (iss >> block)
+				{
+					for (size_t i = 0; i < m_objFileInfo->meshes.size(); i++)
+					{
+						if (m_objFileInfo->meshes[i].name == block)
+						{
+							instance.meshIndex = static_cast<int>(i);
+						}
+					}
+				}
+				if (currentMesh || instance.meshIndex < 0)
+				{
+					std::cout << "-----------FILE PARSE ERROR-------------" << std::endl;
+					std::cout << "Keyword: instance requires the name of a mesh defined before" << std::endl;
+					return eParseRetType::kEyeKeywordFormatError;
+				}
+				while (iss >> block)
+				{
+					if (block == "material")
+					{
+						instance.materialIndex = m_objFileInfo->materials.size() - 1;
+						continue;
+					}
+					int count = block == "rotate" ? 4 : 3;
+					double vec[4] = {};
+					for (int i = 0; i < count; i++)
+					{
+						std::string value;
+						if ((block != "translate" && block != "rotate" && block != "scale") || !(iss >> value))
+						{
+							std::cout << "-----------FILE PARSE ERROR-------------" << std::endl;
+							std::cout << "Keyword: instance can't parse " << block << std::endl;
+							return eParseRetType::kEyeKeywordFormatError;
+						}
+						vec[i] = std::stod(value);
+					}
+					rtVector3 v(vec[0], vec[1], vec[2]);
+					rtTransform t = block == "translate" ? rtTransform::translate(v) : (block == "scale" ? rtTransform::scale(v) : rtTransform::rotate(v, vec[3]));
+					instance.transform = t.multiply(instance.transform);
+				}
+				instance.inverse = instance.transform.inverse();
+				m_objFileInfo->instances.push_back(instance);
 			}
 			else if (block == "texture")
 			{
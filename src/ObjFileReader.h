@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <memory>
@@ -7,12 +8,53 @@
 #include "rtMaterial.h"
 #include "rtLight.h"
 #include "rtSphere.h"
+#include "rtTransform.h"
+#include "rtArena.h"
+#include "rtCompactMesh.h"
 #include "FileReader.h"
 
 using ObjKeywords = std::string;
 
+// v/vt/vn indices of the three corners as written in the file (1-based). an empty slot
+// between slashes, as in "v//vn", is -1, and slots after the last one written stay 0.
+// face[k][0] is the vertex, face[k][1] the texture coordinate and face[k][2] the normal
+struct rtFace
+{
+	int* operator[](int corner) { return m_corners[corner]; }
+	const int* operator[](int corner) const { return m_corners[corner]; }
+
+	int m_corners[3][3] = {};
+};
+
+// geometry defined once between "mesh <name>" and "endmesh", indices are local to the mesh
+struct rtMesh
+{
+	explicit rtMesh(std::pmr::memory_resource* arena)
+		: verteices(arena), vertexNormals(arena), vertexTextureCoordinates(arena), faces(arena), faceMaterialIndexs(arena) {}
+
+	std::string name;
+	std::pmr::vector<rtPoint> verteices;
+	std::pmr::vector<rtVector3> vertexNormals;
+	std::pmr::vector<rtVector2<double>> vertexTextureCoordinates;
+	std::pmr::vector<rtFace> faces;
+	std::pmr::vector<int> faceMaterialIndexs;
+	// replaces the arrays above once the geometry is compacted
+	std::unique_ptr<rtCompactMesh> compact;
+};
+
+// placement of a mesh, materialIndex overrides the mesh's face materials when not -1
+struct rtInstance
+{
+	int meshIndex = -1;
+	rtTransform transform;
+	rtTransform inverse;
+	int materialIndex = -1;
+};
+
+// geometry arrays are carved out of the scene's arena, it has to be declared first
 struct ObjFileInfo
 {
+	rtArena arena;
 	rtPoint eye;
 	rtVector3 viewDir;
 	rtVector3 upDir;
@@ -22,11 +64,14 @@ struct ObjFileInfo
 	std::vector<rtMaterial> materials;
 	std::vector<rtSphere> spheres;
 	std::vector<rtLight> lights;
-	std::vector<rtPoint> verteices;
-	std::vector<rtVector3> vertexNormals;
-	std::vector<rtVector2<double>> vertexTextureCoordinates;
-	std::vector<std::vector<std::vector<int>>> faces;
-	std::vector<int> faceMaterialIndexs;
+	std::pmr::vector<rtPoint> verteices{ &arena };
+	std::pmr::vector<rtVector3> vertexNormals{ &arena };
+	std::pmr::vector<rtVector2<double>> vertexTextureCoordinates{ &arena };
+	std::pmr::vector<rtFace> faces{ &arena };
+	std::pmr::vector<int> faceMaterialIndexs{ &arena };
+	std::unique_ptr<rtCompactMesh> compactFaces;
+	std::vector<rtMesh> meshes;
+	std::vector<rtInstance> instances;
 };
 
 class ObjFileReader : public FileReaderBase
@@ -35,12 +80,24 @@ public:
 	ObjFileReader();
 	ObjFileReader(const std::string& _fileName);
 	eParseRetType parseFile() override;
-	std::shared_ptr<ObjFileInfo> getFileInfo();
+	const std::shared_ptr<ObjFileInfo>& getFileInfo();
 	std::string getFileName();
+	// texture files the scene names, found by a scan that parses nothing else, so they can be
+	// decoded while parseFile runs
+	static std::vector<std::string> scanTextureFiles(const std::string& fileName);
+	// reader holding a deep copy of the parsed scene in its own arena, allocated and written by
+	// the calling thread
+	std::shared_ptr<ObjFileReader> replicate() const;
+	// settings only: parseFile reads the camera, background, materials and lights, and every
+	// other line only goes into a fingerprint of the geometry and the materials it is given
+	void setSettingsOnly(bool settingsOnly);
+	uint64_t getGeometryHash() const;
 
 	~ObjFileReader() override {}
 
 private:
 
 	std::shared_ptr<ObjFileInfo> m_objFileInfo;
+	bool m_settingsOnly = false;
+	uint64_t m_geometryHash = 0;
 };
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "PpmFileWriter.h"
+#include "rtTiledImageFile.h"
+#include <iostream>
+
+ppmFileWriter::ppmFileWriter(const std::string& fileName)
+{
+	m_fileName = fileName;
+}
+
+bool ppmFileWriter::writeImage(const std::vector<std::vector<rtColor>>& pixels, const rtVector2<int>& size)
+{
+	std::vector<int> rgb(static_cast<size_t>(size.m_x) * size.m_y * 3);
+	for (int j = 0; j < size.m_y; j++)
+	{
+		for (int i = 0; i < size.m_x; i++)
+		{
+			rtColor pixel = pixels[i][j];
+			size_t offset = (static_cast<size_t>(j) * size.m_x + i) * 3;
+			rgb[offset] = pixel.rtoi();
+			rgb[offset + 1] = pixel.gtoi();
+			rgb[offset + 2] = pixel.btoi();
+		}
+	}
+	return writeImage(rgb, size);
+}
+
+bool ppmFileWriter::writeImage(const std::vector<int>& rgb, const rtVector2<int>& size)
+{
+	std::ofstream outfile(m_fileName);
+	if (outfile.fail())
+	{
+		return false;
+	}
+
+	outfile << "P3\n";
+	outfile << size.m_x << ' ' << size.m_y << '\n';
+	outfile << "255\n";
+
+	// output the whole img
+	for (int j = 0; j < size.m_y; j++)
+	{
+		for (int i = 0; i < size.m_x; i++)
+		{
+			if ((i + j * size.m_x) != 0 && (i + j * size.m_x) % 5 == 0)
+			{
+				outfile << "\n"; // 5 pixels one line
+			}
+			size_t offset = (static_cast<size_t>(j) * size.m_x + i) * 3;
+			outfile << rgb[offset] << " " << rgb[offset + 1] << " " << rgb[offset + 2] << " ";
+		}
+	}
+	outfile.close();
+	return true;
+}
+
+bool ppmFileWriter::writeRegion(const std::vector<std::vector<rtColor>>& pixels, const rtTile& region)
+{
+	std::vector<int> rgb(static_cast<size_t>(region.width()) * region.height() * 3);
+	for (int j = region.m_y0; j < region.m_y1; j++)
+	{
+		for (int i = region.m_x0; i < region.m_x1; i++)
+		{
+			rtColor pixel = pixels[i][j];
+			size_t offset = (static_cast<size_t>(j - region.m_y0) * region.width() + (i - region.m_x0)) * 3;
+			rgb[offset] = pixel.rtoi();
+			rgb[offset + 1] = pixel.gtoi();
+			rgb[offset + 2] = pixel.btoi();
+		}
+	}
+	return writeImage(rgb, rtVector2<int>(region.width(), region.height()));
+}
+
+bool ppmFileWriter::patchImage(const std::vector<std::vector<rtColor>>& pixels, const rtVector2<int>& size, const std::vector<rtTile>& tiles)
+{
+	std::ifstream inFile(m_fileName);
+	std::string magic;
+	inFile >> magic;
+	if (inFile.fail())
+	{
+		std::cout << "Can't read image: " << m_fileName << std::endl;
+		return false;
+	}
+
+	if (magic == "P6")
+	{
+		inFile.close();
+		rtTiledImageFile image;
+		if (!image.open(m_fileName, size))
+		{
+			return false;
+		}
+		std::vector<rtColor> tilePixels;
+		for (const rtTile& tile : tiles)
+		{
+			tilePixels.clear();
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
+			{
+				tilePixels.insert(tilePixels.end(), pixels[i].begin() + tile.m_y0, pixels[i].begin() + tile.m_y1);
+			}
+			if (!image.writeTile(tile, tilePixels))
+			{
+				return false;
+			}
+		}
+		return image.close();
+	}
+
+	int width = 0, height = 0, maxValue = 0;
+	inFile >> width >> height >> maxValue;
+	if (inFile.fail() || magic != "P3")
+	{
+		std::cout << "Not a ppm image: " << m_fileName << std::endl;
+		return false;
+	}
+	if (width != size.m_x || height != size.m_y)
+	{
+		std::cout << "Image is " << width << "x" << height << ", not " << size.m_x << "x" << size.m_y << ": " << m_fileName << std::endl;
+		return false;
+	}
+	std::vector<int> rgb(static_cast<size_t>(width) * height * 3);
+	for (int& value : rgb)
+	{
+		inFile >> value;
+	}
+	if (inFile.fail())
+	{
+		std::cout << "Corrupted image: " << m_fileName << std::endl;
+		return false;
+	}
+	inFile.close();
+
+	for (const rtTile& tile : tiles)
+	{
+		for (int j = tile.m_y0; j < tile.m_y1; j++)
+		{
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
+			{
+				rtColor pixel = pixels[i][j];
+				size_t offset = (static_cast<size_t>(j) * width + i) * 3;
+				rgb[offset] = pixel.rtoi();
+				rgb[offset + 1] = pixel.gtoi();
+				rgb[offset + 2] = pixel.btoi();
+			}
+		}
+	}
+	return writeImage(rgb, size);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <fstream>
+#include <vector>
+#include <string>
+#include "rtVector.h"
+#include "rtColor.h"
+#include "rtTile.h"
+
+class ppmFileWriter
+{
+public:
+	ppmFileWriter(const std::string& fileName);
+	bool writeImage(const std::vector<std::vector<rtColor>>& pixels, const rtVector2<int>& size);
+	bool writeImage(const std::vector<int>& rgb, const rtVector2<int>& size);
+	// only the pixels inside region, as an image of the region's size
+	bool writeRegion(const std::vector<std::vector<rtColor>>& pixels, const rtTile& region);
+	// replaces the pixels of tiles in the existing image, which must be size large. binary
+	// images are written in place, text images are read and written back whole
+	bool patchImage(const std::vector<std::vector<rtColor>>& pixels, const rtVector2<int>& size, const std::vector<rtTile>& tiles);
+
+private:
+	std::string m_fileName;
+};
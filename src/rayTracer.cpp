@@ -1,665 +1,1635 @@
 #include "rayTracer.h"
 #include "PpmFileReader.h"
+#include "PpmFileWriter.h"
+#include "rtIntersect.h"
+#include "rtPartialImage.h"
+#include "rtCheckpoint.h"
+#include "rtTiledImageFile.h"
+#include "rtAllocationCounter.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <filesystem>
 #include <cmath>
+#include <cstring>
 #include <corecrt_math_defines.h>
 
-static constexpr int MAX_RECURSIVE_DEPTH = 7;
-static constexpr double EPSILON = 0.00000005;
-
-bool rayTracer::Init(const std::string& fileName)
+// a light's share of BlinnPhongShading before its shadow ray
+struct rtLightTerm
 {
-	m_fileReader = std::make_unique<ObjFileReader>(fileName);
+	rtVector3 m_lightDir;
+	double m_maxT = 0.0;
+	double m_fatt = 1.0;
+	double m_r = 0.0;
+	double m_g = 0.0;
+	double m_b = 0.0;
+};
+
+// shading never nests, one set of buffers per thread is enough. RenderTile reserves
+// them up front so tracing doesn't grow them
+static thread_local rtLightCandidates t_lightCandidates;
+static thread_local std::vector<rtLightTerm> t_lightTerms;
+// primary and secondary rays traced by this thread, RenderTile adds them to m_raysTraced
+static thread_local uint64_t t_raysTraced = 0;
+// the tile RenderTile traced last when rendering out of core, column by column
+static thread_local std::vector<rtColor> t_tilePixels;
+// the record of the tile being traced while ComputePixelColor records dependencies
+static thread_local rtTileDependencies t_dependencies;
+static thread_local const rtDependencyMap* t_dependencyMap = nullptr;
+
+// notes a traced ray in the tile's record, hit is null for a miss
+static void RecordRay(const ObjFileInfo& fileInfo, const rtRay& ray, const rtHitRecord* hit)
+{
+	if (hit == nullptr)
+	{
+		t_dependencyMap->addSegment(t_dependencies, ray, std::numeric_limits<double>::infinity());
+		t_dependencies.m_background = true;
+		return;
+	}
+	t_dependencyMap->addSegment(t_dependencies, ray, hit->m_t);
+	t_dependencyMap->addMaterial(t_dependencies, PrimitiveMaterialIndex(fileInfo, hit->m_prim));
+}
 
-	if (eParseRetType::kSuccess != m_fileReader->parseFile())
+// a ray of a coherent tile and how its color combines with its children's, the same
+// way RecursiveTraceRay combines them. children are indices into the next depth
+struct rtPathNode
+{
+	rtColor m_color;
+	double m_reflectance = 0.0;
+	double m_transmittance = 0.0;
+	int m_reflection = -1;
+	int m_transmission = -1;
+};
+
+struct rtQueuedRay
+{
+	rtRay m_ray;
+	double m_etai;
+	rtPrimitiveRef m_lastPrim;
+	double m_lastEta;
+};
+
+// direction octant first, then the Morton code of the origin inside the scene bounds, so
+// neighbors in the order start close together and head the same way
+static uint64_t CoherenceKey(const rtRay& ray, const rtAABB& bounds)
+{
+	uint64_t octant = (ray.m_direction.m_x < 0.0 ? 1 : 0) | (ray.m_direction.m_y < 0.0 ? 2 : 0) | (ray.m_direction.m_z < 0.0 ? 4 : 0);
+	double origin[3] = { ray.m_origin.m_x, ray.m_origin.m_y, ray.m_origin.m_z };
+	double minimum[3] = { bounds.m_min.m_x, bounds.m_min.m_y, bounds.m_min.m_z };
+	uint64_t morton = 0;
+	for (int axis = 0; axis < 3; axis++)
 	{
-		return false;
+		double extent = bounds.extent(axis);
+		double t = extent > 0.0 ? (origin[axis] - minimum[axis]) / extent : 0.0;
+		t = std::min(std::max(t, 0.0), 1.0);
+		morton |= static_cast<uint64_t>(SpreadBitsBy3(static_cast<uint32_t>(t * 1023.0))) << axis;
 	}
-	return true;
+	return (octant << 30) | morton;
 }
 
-bool rayTracer::ReadTextureFiles(const std::string& textureDir)
+// Blinn-Phong terms of the candidate lights of one type, the light model is picked at compile time
+template <eLightType Type>
+static void AddLightTerms(const std::vector<rtLightData<Type>>& lights, const std::vector<int>& candidates, const rtMaterialRecord& material,
+	const rtColor& diffuse, const rtPoint& intersection, const rtVector3& normal, const rtVector3& V, std::vector<rtLightTerm>& terms)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
-	for (int i = 0; i < fileInfo->materials.size(); i++)
+	for (int index : candidates)
 	{
-		std::string texName = fileInfo->materials[i].getTextureFile();
-		auto fullPath = (std::filesystem::path(textureDir) / texName).string();
-		if (!texName.empty())
+		rtLightTerm term;
+		if (!Illuminate(lights[index], intersection, term.m_lightDir, term.m_maxT, term.m_fatt))
+		{
+			continue;
+		}
+
+		// calculate the H vector in phong equation
+		rtVector3 H = term.m_lightDir.add(V).getTwoNorm();
+		double nl = rtVector3::dotProduct(normal, term.m_lightDir);
+		double nh = rtVector3::dotProduct(normal, H);
+		// one power per light, and none where it can only come out 0
+		double highlight = 0.0;
+		if (material.is(rtMaterialRecord::kSpecular) && (nh > 0.0 || material.m_falloff <= 0.0))
+		{
+			highlight = std::pow(std::max(nh, 0.0), material.m_falloff);
+		}
+		term.m_r = diffuse.m_r * std::max(nl, 0.0) + material.m_specular.m_r * highlight;
+		term.m_g = diffuse.m_g * std::max(nl, 0.0) + material.m_specular.m_g * highlight;
+		term.m_b = diffuse.m_b * std::max(nl, 0.0) + material.m_specular.m_b * highlight;
+		if (term.m_r == 0.0 && term.m_g == 0.0 && term.m_b == 0.0 && std::isfinite(term.m_fatt))
 		{
-			std::unique_ptr<ppmFileReader> ppmFileReaderInstance = std::make_unique<ppmFileReader>(fullPath);
-			std::vector<rtColor> texture;
-			rtVector2<int> size;
-			ppmFileReaderInstance->getTextureArray(texture, size);
-			m_textureData[texName] = texture;
-			m_textureSize[texName] = size;
+			// facing away, the shadow ray could not change anything
+			continue;
 		}
+		terms.push_back(term);
 	}
-	return true;
 }
 
-bool rayTracer::ComputeUV()
+static uint64_t SplitMix64(uint64_t& state)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
 
-	// check viewDir and upDir are not parallel
-	m_u = rtVector3::crossProduct(fileInfo->viewDir, fileInfo->upDir);
+static uint64_t HashPoint(const rtPoint& p)
+{
+	double coords[3] = { p.m_x, p.m_y, p.m_z };
+	uint64_t state = 0;
+	for (double c : coords)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &c, sizeof(bits));
+		uint64_t mix = state ^ bits;
+		state = SplitMix64(mix);
+	}
+	return state;
+}
 
-	if (m_u.m_x == 0.0 && m_u.m_y == 0.0 && m_u.m_z == 0.0)
+bool rayTracer::Init(const std::string& fileName)
+{
+	m_fileReader = std::make_shared<ObjFileReader>(fileName);
+
+	if (eParseRetType::kSuccess != m_fileReader->parseFile())
 	{
-		std::cout << "viewDir and upDir are parallel" << std::endl;
 		return false;
 	}
 
-	m_u.twoNorm();
-	m_v = rtVector3::crossProduct(m_u, fileInfo->viewDir);
-	m_v.twoNorm();
+	auto fileInfo = m_fileReader->getFileInfo();
+	m_camera.m_eye = fileInfo->eye;
+	m_camera.m_viewDir = fileInfo->viewDir;
+	m_camera.m_upDir = fileInfo->upDir;
+	m_camera.m_vFov = fileInfo->vFov;
+	m_camera.m_imageSize = fileInfo->imageSize;
+	m_frameSize = fileInfo->imageSize;
+	return true;
+}
 
+bool rayTracer::ReadTextureFiles(const std::string& textureDir, const rtDecodedTextures& decoded)
+{
+	auto materials = std::make_shared<rtMaterialTable>();
+	materials->build(m_fileReader->getFileInfo()->materials, textureDir, decoded);
+	m_textureDir = textureDir;
+	m_materials = materials;
 	return true;
 }
 
-bool rayTracer::ComputeAspectRatioAndRenderPlane()
+void rayTracer::BuildAccelerationStructure()
 {
-	auto fileInfo = m_fileReader->getFileInfo();
+	auto buildStart = std::chrono::steady_clock::now();
+	m_builtAcceleratorType = m_acceleratorType == eAcceleratorType::kAuto ? ChooseAcceleratorType(*m_fileReader->getFileInfo()) : m_acceleratorType;
+	m_accelerator = CreateAccelerator(m_builtAcceleratorType, m_fileReader->getFileInfo(), m_bvhBuild, m_bvhBuildThreads);
+	m_accelerator->build();
+	m_acceleratorBuildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+	BuildLightStructure();
+	if (m_lightCutoff > 0.0)
+	{
+		const rtLightBVH& culling = m_lights->culling();
+		std::cout << "light culling: " << culling.lightCount() << " lights, " << culling.unboundedCount() << " reach everywhere, "
+			<< culling.boundedCount() << " bounded, " << culling.lightCount() - culling.unboundedCount() - culling.boundedCount() << " never reach the scene" << std::endl;
+	}
+}
 
-	double aspectRatio = static_cast<double>(fileInfo->imageSize.m_x) / static_cast<double>(fileInfo->imageSize.m_y);
-	double distance = 5.0; // random number
-	double height = 2.0 * distance * std::tan(fileInfo->vFov * M_PI / 360.0);
-	double width = height * aspectRatio;
-	
-	rtVector3 n = fileInfo->viewDir.getTwoNorm();
-	rtPoint center = rtPoint::add(fileInfo->eye, n.scale(distance));
-	m_ul = rtPoint::add(rtPoint::add(center, m_u.scale(-width / 2.0)), m_v.scale(height / 2.0));
-	m_ur = rtPoint::add(fileInfo->eye, n.scale(distance).add(m_u.scale(width / 2.0).add(m_v.scale(height / 2.0))));
-	m_ll = rtPoint::add(fileInfo->eye, n.scale(distance).add(m_u.scale(-width / 2.0).add(m_v.scale(-height / 2.0))));
-	m_lr = rtPoint::add(fileInfo->eye, n.scale(distance).add(m_u.scale(width / 2.0).add(m_v.scale(-height / 2.0))));
+void rayTracer::SetAccelerator(eAcceleratorType type, eBVHBuild method, int threads)
+{
+	m_acceleratorType = type;
+	m_bvhBuild = method;
+	m_bvhBuildThreads = threads;
+}
 
-	return true;
+eAcceleratorType rayTracer::AcceleratorType() const
+{
+	return m_builtAcceleratorType;
 }
 
-void rayTracer::InitPixelArray()
+double rayTracer::AcceleratorBuildTime() const
 {
-	auto fileInfo = m_fileReader->getFileInfo();
+	return m_acceleratorBuildTime;
+}
 
-	m_pixels.resize(static_cast<int>(fileInfo->imageSize.m_x), std::vector<rtColor>(static_cast<int>(fileInfo->imageSize.m_y), fileInfo->bkgColor));
+double rayTracer::AcceleratorSahCost() const
+{
+	return m_accelerator ? m_accelerator->sahCost() : 0.0;
+}
 
-	for (int i = 0; i < fileInfo->imageSize.m_x; i++)
-	{
-		for (int j = 0; j < fileInfo->imageSize.m_y; j++)
-		{
-			m_pixels[i][j] = fileInfo->bkgColor;
-		}
-	}
+void rayTracer::SetCoherentRays(bool coherent)
+{
+	m_coherentRays = coherent;
 }
 
-void rayTracer::CreatePixelIndexTo3DPointMap()
+void rayTracer::SetInstructionSet(eInstructionSet set)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
-	rtVector3 d_h = m_ur.subtract(m_ul).scale(1.0 / static_cast<double>(fileInfo->imageSize.m_x));
-	rtVector3 d_v = m_ll.subtract(m_ul).scale(1.0 / static_cast<double>(fileInfo->imageSize.m_y));
+	SetActiveInstructionSet(set);
+	m_isa = set;
+}
 
-	rtVector3 d_ch = m_ur.subtract(m_ul).scale(1.0 / (2.0 * static_cast<double>(fileInfo->imageSize.m_x)));
-	rtVector3 d_cv = m_ll.subtract(m_ul).scale(1.0 / (2.0 * static_cast<double>(fileInfo->imageSize.m_y)));
-	
-	for (int i = 0; i < fileInfo->imageSize.m_x; i++)
-	{
-		for (int j = 0; j < fileInfo->imageSize.m_y; j++)
-		{
-			rtPoint p = rtPoint::add(rtPoint::add(rtPoint::add(rtPoint::add(m_ul, d_h.scale((double)i)), d_v.scale((double)j)), d_ch), d_cv);
-			rtVector2<int> index(i, j);
-			m_imgIndex2PointMap[index] = p;
-		}
-	}
+eInstructionSet rayTracer::InstructionSet() const
+{
+	return m_isa;
+}
+
+void rayTracer::SetTextureFilter(eTextureFilter filter)
+{
+	m_textureFilter = filter;
+}
 
+void rayTracer::SetQuality(const rtQualitySettings& quality)
+{
+	m_quality = quality;
 }
 
-void rayTracer::CreatePixelIndexToRayMap()
+void rayTracer::SetNumaPolicy(eNumaPolicy policy, bool report)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
-	for (int i = 0; i < fileInfo->imageSize.m_x; i++)
+	m_numaPolicy = policy;
+	m_numaReport = report;
+}
+
+void rayTracer::SetPixelOrder(eTraversalOrder order)
+{
+	m_pixelOrder = order;
+}
+
+void rayTracer::SetProgressiveOutput(const std::string& fileName, int tileInterval)
+{
+	m_progressiveFile = fileName;
+	m_progressiveInterval = tileInterval;
+}
+
+void rayTracer::SetCheckpoint(const std::string& fileName, double intervalSeconds, uint64_t fingerprint)
+{
+	m_checkpointFile = fileName;
+	m_checkpointInterval = intervalSeconds;
+	m_checkpointFingerprint = fingerprint;
+	m_checkpointTiles.clear();
+}
+
+bool rayTracer::ResumeFromCheckpoint(std::vector<rtTile>& tiles)
+{
+	std::vector<rtTile> finished;
+	if (!rtCheckpoint::read(m_checkpointFile, m_checkpointFingerprint, m_frameSize, finished, m_pixels))
+	{
+		return false;
+	}
+	auto sameTile = [](const rtTile& a, const rtTile& b)
+	{
+		return a.m_x0 == b.m_x0 && a.m_y0 == b.m_y0 && a.m_x1 == b.m_x1 && a.m_y1 == b.m_y1;
+	};
+	// tiles of another tile size don't match and are traced again
+	std::vector<rtTile> pending;
+	for (const rtTile& tile : tiles)
 	{
-		for (int j = 0; j < fileInfo->imageSize.m_y; j++)
+		if (std::none_of(finished.begin(), finished.end(), [&](const rtTile& done) { return sameTile(tile, done); }))
 		{
-			rtVector2<int> index(i, j);
-			rtPoint end = m_imgIndex2PointMap[index];
-			rtVector3 rayDir = end.subtract(fileInfo->eye);
-			rayDir.twoNorm();
-			rtRay ray;
-			ray.m_origin = fileInfo->eye;
-			ray.m_direction = rayDir;
-			m_imgIndex2RayMap[index] = ray;
+			pending.push_back(tile);
 		}
 	}
+	std::cout << "resumed " << tiles.size() - pending.size() << " of " << tiles.size() << " tiles from " << m_checkpointFile << std::endl;
+	m_checkpointTiles = finished;
+	tiles = pending;
+	return true;
 }
 
-void rayTracer::ComputePixelColor()
+void rayTracer::SetDependencyRecording(bool record)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
-	for (int i = 0; i < fileInfo->imageSize.m_x; i++)
+	m_recordDependencies = record;
+	m_dependencies = rtDependencyMap();
+}
+
+bool rayTracer::ReusePreviousFrame(const rayTracer& previous)
+{
+	const rtCamera& a = m_camera;
+	const rtCamera& b = previous.m_camera;
+	bool sameCamera = a.m_eye.m_x == b.m_eye.m_x && a.m_eye.m_y == b.m_eye.m_y && a.m_eye.m_z == b.m_eye.m_z
+		&& a.m_viewDir.m_x == b.m_viewDir.m_x && a.m_viewDir.m_y == b.m_viewDir.m_y && a.m_viewDir.m_z == b.m_viewDir.m_z
+		&& a.m_upDir.m_x == b.m_upDir.m_x && a.m_upDir.m_y == b.m_upDir.m_y && a.m_upDir.m_z == b.m_upDir.m_z
+		&& a.m_vFov == b.m_vFov && m_frameSize.m_x == previous.m_frameSize.m_x && m_frameSize.m_y == previous.m_frameSize.m_y;
+	if (!sameCamera || !previous.m_recordDependencies || previous.m_dependencies.empty() || previous.m_pixels.empty())
 	{
-		for (int j = 0; j < fileInfo->imageSize.m_y; j++)
-		{
-			rtVector2<int> index(i, j);
-			rtRay ray = m_imgIndex2RayMap[index];
-			rtColor pixelColor = RecursiveTraceRay(ray, 0, 1.0, true, -1, 1.0);
-			pixelColor.clamp();
-			m_pixels[i][j] = pixelColor;
-		}
+		return false;
 	}
+	m_pixels = previous.m_pixels;
+	m_dependencies = previous.m_dependencies;
+	return true;
 }
 
-rtColor rayTracer::RecursiveTraceRay(const rtRay& incidence, int recusiveDepth, double etai, bool isSphere, int objIndex, double lastEta)
+std::vector<rtTile> rayTracer::TilesToUpdate(const std::vector<rtTile>& tiles, const rtSceneEdit& edit)
 {
-	auto fileInfo = m_fileReader->getFileInfo();
-	if (recusiveDepth == MAX_RECURSIVE_DEPTH)
+	std::vector<rtTile> affected = m_dependencies.affectedTiles(tiles, edit);
+	if (affected.size() == tiles.size())
 	{
-		double r, g, b;
-		if (isSphere)
-		{
-			r = fileInfo->materials[fileInfo->spheres[objIndex].m_materialIndex].m_odr;
-			g = fileInfo->materials[fileInfo->spheres[objIndex].m_materialIndex].m_odg;
-			b = fileInfo->materials[fileInfo->spheres[objIndex].m_materialIndex].m_odb;
-		}
-		else
-		{
-			r = fileInfo->materials[fileInfo->faceMaterialIndexs[objIndex]].m_odr;
-			g = fileInfo->materials[fileInfo->faceMaterialIndexs[objIndex]].m_odg;
-			b = fileInfo->materials[fileInfo->faceMaterialIndexs[objIndex]].m_odb;
-		}
-		return rtColor(r, g, b);
+		// everything is traced again, the records start over on the current scene bounds
+		m_dependencies = rtDependencyMap();
 	}
+	return affected;
+}
 
-	// determine is a ray intersects with an object;
-	bool exit = false;
-	rtColor hit;
-	double t1 = std::numeric_limits<double>::infinity();
-
-	rtVector3 triNormal;
-
-	double finalAlpha, finalBeta, finalGamma;
-
-	bool isSphere_ = true;
-	int objIndex_ = -1;
-	
-	int total = 0;
+static bool SameVector(const rtVector3& a, const rtVector3& b)
+{
+	return a.m_x == b.m_x && a.m_y == b.m_y && a.m_z == b.m_z;
+}
 
-	for (int sphereIndex = 0; sphereIndex < fileInfo->spheres.size(); sphereIndex++)
-	{
-		double xc = fileInfo->spheres[sphereIndex].m_center.m_x;
-		double yc = fileInfo->spheres[sphereIndex].m_center.m_y;
-		double zc = fileInfo->spheres[sphereIndex].m_center.m_z;
-		double r = fileInfo->spheres[sphereIndex].m_radius;
+static bool SamePoint(const rtPoint& a, const rtPoint& b)
+{
+	return a.m_x == b.m_x && a.m_y == b.m_y && a.m_z == b.m_z;
+}
 
-		double distanceX = incidence.m_origin.m_x - xc;
-		double distanceY = incidence.m_origin.m_y - yc;
-		double distanceZ = incidence.m_origin.m_z - zc;
+static bool SameColor(const rtColor& a, const rtColor& b)
+{
+	return a.m_r == b.m_r && a.m_g == b.m_g && a.m_b == b.m_b;
+}
 
-		double A = 1.0;
-		double B = 2.0 * (incidence.m_direction.m_x * distanceX +
-						 incidence.m_direction.m_y * distanceY +
-						 incidence.m_direction.m_z * distanceZ);
-		double C = distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ - r * r;
+static bool SameMaterial(const rtMaterial& a, const rtMaterial& b)
+{
+	return a.m_odr == b.m_odr && a.m_odg == b.m_odg && a.m_odb == b.m_odb && a.m_osr == b.m_osr && a.m_osg == b.m_osg && a.m_osb == b.m_osb
+		&& a.m_ka == b.m_ka && a.m_kd == b.m_kd && a.m_ks == b.m_ks && a.m_falloff == b.m_falloff && a.m_alpha == b.m_alpha && a.m_eta == b.m_eta
+		&& a.getTextureFile() == b.getTextureFile();
+}
 
-		double delta = B * B - 4.0 * A * C;
+static bool SameLight(const rtLight& a, const rtLight& b)
+{
+	return a.m_type == b.m_type && SamePoint(a.m_center, b.m_center) && SameColor(a.m_color, b.m_color) && SameVector(a.m_vec3, b.m_vec3)
+		&& a.m_theta == b.m_theta && a.m_c1 == b.m_c1 && a.m_c2 == b.m_c2 && a.m_c3 == b.m_c3;
+}
 
-		if (delta == 0.0)// (delta close to zero)
-		{
-			double tempT = (-B) / (2.0 * A);
-			if (tempT < t1 && tempT > 0)
-			{
-				t1 = tempT;
-				objIndex_ = sphereIndex;
-			}
-			else 
-			{
-				total++;
-			}
-		}
-		else if (delta > 0)
+void rayTracer::ApplySceneSettings(const ObjFileInfo* settings, const std::vector<std::string>& changedTextures, rtSceneEdit& edit)
+{
+	ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	std::vector<rtMaterial> previousMaterials = fileInfo.materials;
+	bool cameraChanged = false;
+	bool lightsChanged = false;
+	if (settings != nullptr)
+	{
+		cameraChanged = !SamePoint(settings->eye, fileInfo.eye) || !SameVector(settings->viewDir, fileInfo.viewDir) || !SameVector(settings->upDir, fileInfo.upDir)
+			|| settings->vFov != fileInfo.vFov || settings->imageSize.m_x != fileInfo.imageSize.m_x || settings->imageSize.m_y != fileInfo.imageSize.m_y;
+		if (cameraChanged)
 		{
-			double tempT1 = (std::sqrt(delta) - B) / (2.0 * A);
-			double tempT2 = (-std::sqrt(delta) - B) / (2.0 * A);
-			bool isHit = false;
-			if ((tempT1 < t1) && tempT1 > 0)
-			{
-				t1 = tempT1;
-				objIndex_ = sphereIndex;
-				isHit = true;
-			}
-
-			if ((tempT2 < t1) && tempT2 > 0)
-			{
-				t1 = tempT2;
-				objIndex_ = sphereIndex;
-				isHit = true;
-			}
-
-			if (!isHit)
-			{
-				total++;
-			}
+			fileInfo.eye = settings->eye;
+			fileInfo.viewDir = settings->viewDir;
+			fileInfo.upDir = settings->upDir;
+			fileInfo.vFov = settings->vFov;
+			fileInfo.imageSize = settings->imageSize;
+			m_camera.m_eye = settings->eye;
+			m_camera.m_viewDir = settings->viewDir;
+			m_camera.m_upDir = settings->upDir;
+			m_camera.m_vFov = settings->vFov;
+			m_camera.m_imageSize = settings->imageSize;
+			edit.m_everything = true;
 		}
-		else
+		if (!SameColor(settings->bkgColor, fileInfo.bkgColor))
 		{
-			total++;
+			fileInfo.bkgColor = settings->bkgColor;
+			edit.m_background = true;
 		}
-	}
-
-	// check for all triangles
-	for (int triangleIndex = 0; triangleIndex < fileInfo->faces.size(); triangleIndex++)
-	{
-		rtPoint firstVertex = fileInfo->verteices[fileInfo->faces[triangleIndex][0][0] - 1];
-		rtPoint secondVertex = fileInfo->verteices[fileInfo->faces[triangleIndex][1][0] - 1];;
-		rtPoint thirdVertex = fileInfo->verteices[fileInfo->faces[triangleIndex][2][0] - 1];;
-		rtVector3 e1 = secondVertex.subtract(firstVertex);
-		rtVector3 e2 = thirdVertex.subtract(firstVertex);
-		rtVector3 normal = rtVector3::crossProduct(e1, e2);
-		double A = normal.m_x;
-		double B = normal.m_y;
-		double C = normal.m_z;
-		double D = -(firstVertex.m_x * A + firstVertex.m_y * B + firstVertex.m_z * C);
-		double deterimint = A * incidence.m_direction.m_x + B * incidence.m_direction.m_y + C * incidence.m_direction.m_z;
-
-		// check if viewdir is parallel to the surface
-		if (deterimint <= EPSILON && deterimint >= -EPSILON)
+		if (settings->materials.size() != fileInfo.materials.size())
 		{
-			total++;
-			continue;
+			// materials nothing uses were added or removed
+			fileInfo.materials = settings->materials;
+			edit.m_everything = true;
 		}
-		double tTri = -(A * incidence.m_origin.m_x + B * incidence.m_origin.m_y + C * incidence.m_origin.m_z + D) / deterimint;
-		if (tTri < 0.0 || tTri > t1)
+		for (size_t i = 0; i < fileInfo.materials.size(); i++)
 		{
-			total++;
-			continue;
-		}
-		rtPoint hitPoint = rtPoint::add(incidence.m_origin, incidence.m_direction.scale(tTri));
-		rtVector3 e3 = hitPoint.subtract(secondVertex);
-		rtVector3 e4 = hitPoint.subtract(thirdVertex);
-		double totalArea = rtVector3::area(e1, e2);
-		double aArea = rtVector3::area(e3, e4);
-		double bArea = rtVector3::area(e4, e2);
-		double cArea = rtVector3::area(e1, e3);
-		double alpha = aArea / totalArea;
-		double beta = bArea / totalArea;
-		double gamma = cArea / totalArea;
-
-		// determine Barycentric coordinates
-		if (alpha < 1 && alpha > 0 && beta < 1 && beta > 0 && gamma > 0 && gamma < 1 && alpha + beta + gamma - 1 < EPSILON)
-		{
-			t1 = tTri;
-			isSphere_ = false;
-			objIndex_ = triangleIndex;
-			finalAlpha = alpha;
-			finalBeta = beta;
-			finalGamma = gamma;
-			if (fileInfo->faces[triangleIndex][0][2] == 0)
-			{
-				// if no vn, which means flat shading
-				triNormal = normal;
-			}
-			else
+			if (!SameMaterial(settings->materials[i], fileInfo.materials[i]))
 			{
-				// smooth shading
-				rtVector3 firstNromal = fileInfo->vertexNormals[fileInfo->faces[triangleIndex][0][2] - 1];
-				rtVector3 secondNromal = fileInfo->vertexNormals[fileInfo->faces[triangleIndex][1][2] - 1];
-				rtVector3 thirdNromal = fileInfo->vertexNormals[fileInfo->faces[triangleIndex][2][2] - 1];
-				rtVector3 smoothNormal = (firstNromal.scale(alpha).add(secondNromal.scale(beta)).add(thirdNromal.scale(gamma))).getTwoNorm();
-				triNormal = smoothNormal;
+				// shadow rays take the alpha of every occluder, and tiles record only the
+				// cells those rays crossed, not what they passed through
+				if (settings->materials[i].m_alpha != fileInfo.materials[i].m_alpha)
+				{
+					edit.m_lights = true;
+				}
+				fileInfo.materials[i] = settings->materials[i];
+				edit.m_materials.push_back(static_cast<int>(i));
 			}
 		}
-		else
+		lightsChanged = settings->lights.size() != fileInfo.lights.size()
+			|| !std::equal(settings->lights.begin(), settings->lights.end(), fileInfo.lights.begin(), SameLight);
+		if (lightsChanged)
 		{
-			total++;
-			continue;
+			fileInfo.lights = settings->lights;
 		}
 	}
-	// if we detect an intersection,find this point and change img color
-	if (total != (fileInfo->spheres.size() + fileInfo->faces.size()))
+	for (size_t i = 0; i < fileInfo.materials.size(); i++)
 	{
-		rtVector3 I = incidence.m_direction.getTwoNorm().scale(-1);
-		rtVector3 rayDir = incidence.m_direction.scale(t1);
-		rtPoint closest = rtPoint::add(incidence.m_origin, rayDir);
-		rtMaterial temp;
-		rtVector3 normal;
-		if (isSphere_)
-		{
-			// compute normal vector for sphere which will be used in phong equation
-			temp = fileInfo->materials[fileInfo->spheres[objIndex_].m_materialIndex];
-			normal = closest.subtract(fileInfo->spheres[objIndex_].m_center).getTwoNorm();
-		}
-		else
-		{
-			// compute normal vector for triangle which will be used in phong equation
-			temp = fileInfo->materials[fileInfo->faceMaterialIndexs[objIndex_]];
-			normal = triNormal.getTwoNorm();
-		}
-
-		if (rtVector3::dotProduct(I, normal) < 0)
-		{
-			normal = normal.scale(-1);
-		}
-
-		if (isSphere_ && (isSphere_ == isSphere) && (objIndex == objIndex_))
+		const std::string& texture = fileInfo.materials[i].getTextureFile();
+		if (!texture.empty() && std::find(changedTextures.begin(), changedTextures.end(), texture) != changedTextures.end())
 		{
-			exit = true;
+			edit.m_materials.push_back(static_cast<int>(i));
 		}
+	}
 
-		std::string name = temp.getTextureFile();
-		if (!name.empty()) // if texture detected
+	if (!edit.m_materials.empty() || edit.m_everything)
+	{
+		// textures that didn't change stay resident, the new table shares them
+		rtDecodedTextures decoded;
+		for (size_t i = 0; i < previousMaterials.size() && i < m_materials->size(); i++)
 		{
-			rtColor texelColor;
-			double textureU, textureV;
-			if (!isSphere_)
-			{
-				//mapping texture to a triangle
-				rtVector2<double> firstTexCord = fileInfo->vertexTextureCoordinates[fileInfo->faces[objIndex_][0][1] - 1];
-				rtVector2<double> secondTexCord = fileInfo->vertexTextureCoordinates[fileInfo->faces[objIndex_][1][1] - 1];
-				rtVector2<double> thirdTexCord = fileInfo->vertexTextureCoordinates[fileInfo->faces[objIndex_][2][1] - 1];
-				// using Barycentric coordinates
-				textureU = (finalAlpha * firstTexCord.m_x + finalBeta * secondTexCord.m_x + finalGamma * thirdTexCord.m_x);
-				textureV = (finalAlpha * firstTexCord.m_y + finalBeta * secondTexCord.m_y + finalGamma * thirdTexCord.m_y);
-			}
-			else
+			const std::string& texture = previousMaterials[i].getTextureFile();
+			if (!texture.empty() && std::find(changedTextures.begin(), changedTextures.end(), texture) == changedTextures.end())
 			{
-				//mapping texture to a sphere
-				double phi = std::acos((closest.m_z - fileInfo->spheres[objIndex_].m_center.m_z) / fileInfo->spheres[objIndex_].m_radius);
-				double zeta = std::atan2((closest.m_y - fileInfo->spheres[objIndex_].m_center.m_y), (closest.m_x - fileInfo->spheres[objIndex_].m_center.m_x));
-				textureV = phi / M_PI;
-				textureU = (zeta + M_PI) / (2.0 * M_PI);
+				decoded.emplace(texture, m_materials->sharedTexture((*m_materials)[static_cast<int>(i)].m_texture));
 			}
-			texelColor = m_textureData[name][static_cast<int>(textureV * (m_textureSize[name].m_y - 1.0) + 0.5) * static_cast<int>(m_textureSize[name].m_x)
-										   + static_cast<int>(textureU * (m_textureSize[name].m_x - 1.0) + 0.5)];
-			rtMaterial tempMtl(texelColor.m_r / 255.0, texelColor.m_g / 255.0, texelColor.m_b / 255.0,
-								temp.m_osr, temp.m_osg, temp.m_osb,
-								temp.m_ka, temp.m_kd, temp.m_ks, temp.m_falloff, temp.m_alpha, temp.m_eta);
-			hit = BlinnPhongShading(tempMtl, closest, objIndex_, normal, isSphere_, incidence.m_origin);
-		}
-		else // no texture detected, apply normal phong equation
-		{
-			hit = BlinnPhongShading(temp, closest, objIndex_, normal, isSphere_, incidence.m_origin);
 		}
+		auto materials = std::make_shared<rtMaterialTable>();
+		materials->build(fileInfo.materials, m_textureDir, decoded);
+		m_materials = materials;
+	}
+	if (lightsChanged)
+	{
+		BuildLightStructure();
+		edit.m_lights = true;
+	}
+	if (cameraChanged)
+	{
+		PrepareFrame();
+	}
+}
 
-		
-		rtVector3 forwardEpsilon = incidence.m_direction.scale(t1 + EPSILON);
-		rtPoint forward = rtPoint::add(incidence.m_origin, forwardEpsilon);
-
-		rtVector3 backwardEpsilon = incidence.m_direction.scale(t1 - EPSILON);
-		rtPoint backward = rtPoint::add(incidence.m_origin, backwardEpsilon);
+void rayTracer::SetOutOfCore(const std::string& fileName)
+{
+	m_outOfCoreFile = fileName;
+}
 
-		rtRay reflection;
-		rtVector3 reflectionDir;
+uint64_t rayTracer::RaysTraced() const
+{
+	return m_raysTraced;
+}
 
-		double cosphii = std::abs(rtVector3::dotProduct(I, normal));
-		double sinphii = std::pow(1.0 - cosphii * cosphii, 0.5);
-		reflectionDir = normal.scale(cosphii * 2.0).add(incidence.m_direction.getTwoNorm());
-		reflection.m_origin = backward;
-		reflection.m_direction = reflectionDir;
+void rayTracer::SetLightSampling(double cutoff, int shadowSamples)
+{
+	m_lightCutoff = cutoff;
+	m_lightSamples = shadowSamples;
+}
 
-		double curEta = temp.m_eta;
-		double curAlpha = temp.m_alpha;
+void rayTracer::BuildLightStructure()
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	auto lights = std::make_shared<rtLightSet>();
+	lights->build(fileInfo.lights, m_accelerator->bounds(), m_lightCutoff);
+	m_lights = lights;
+}
 
-		if (exit)
-		{
-			curEta = lastEta;
-		}
-		double F0 = ((curEta - etai) / (curEta + etai)) * ((curEta - etai) / (curEta + etai));
-		double FresnelReflectance = F0 + (1.0 - F0) * std::pow((1.0 - cosphii), 5.0);
+bool rayTracer::CompactGeometry()
+{
+	ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	size_t fullBytes = GeometryByteSize();
+
+	auto compactFaces = std::make_unique<rtCompactMesh>();
+	bool ok = compactFaces->encode(fileInfo.verteices, fileInfo.vertexNormals, fileInfo.vertexTextureCoordinates, fileInfo.faces, fileInfo.faceMaterialIndexs);
+	double maxError = compactFaces->maxPositionError();
+	std::vector<std::unique_ptr<rtCompactMesh>> compactMeshes;
+	for (const rtMesh& mesh : fileInfo.meshes)
+	{
+		compactMeshes.push_back(std::make_unique<rtCompactMesh>());
+		ok = ok && compactMeshes.back()->encode(mesh.verteices, mesh.vertexNormals, mesh.vertexTextureCoordinates, mesh.faces, mesh.faceMaterialIndexs);
+		maxError = std::max(maxError, compactMeshes.back()->maxPositionError());
+	}
+	if (!ok)
+	{
+		std::cout << "compact geometry: material indices must be in 0..65535, keeping full precision" << std::endl;
+		return false;
+	}
 
-		rtRay transmission;
-		rtVector3 transmissionDir;
-		if (!isSphere_)
-		{
-			transmissionDir = incidence.m_direction.getTwoNorm();
-		}
-		else
-		{
-			double firstCoff = std::pow(1.0 - (etai / curEta) * (etai / curEta) * (1.0 - cosphii * cosphii), 0.5);
-			transmissionDir = normal.scale(-1.0).scale(firstCoff).add(normal.scale(cosphii * (etai / curEta))).add(I.scale(-1.0).scale(etai / curEta));
-			transmissionDir.twoNorm();
-		}
+	// drop the full precision arrays, their memory all came from the scene arena
+	fileInfo.compactFaces = std::move(compactFaces);
+	fileInfo.verteices = std::pmr::vector<rtPoint>(&fileInfo.arena);
+	fileInfo.vertexNormals = std::pmr::vector<rtVector3>(&fileInfo.arena);
+	fileInfo.vertexTextureCoordinates = std::pmr::vector<rtVector2<double>>(&fileInfo.arena);
+	fileInfo.faces = std::pmr::vector<rtFace>(&fileInfo.arena);
+	fileInfo.faceMaterialIndexs = std::pmr::vector<int>(&fileInfo.arena);
+	for (size_t m = 0; m < fileInfo.meshes.size(); m++)
+	{
+		rtMesh& mesh = fileInfo.meshes[m];
+		mesh.compact = std::move(compactMeshes[m]);
+		mesh.verteices = std::pmr::vector<rtPoint>(&fileInfo.arena);
+		mesh.vertexNormals = std::pmr::vector<rtVector3>(&fileInfo.arena);
+		mesh.vertexTextureCoordinates = std::pmr::vector<rtVector2<double>>(&fileInfo.arena);
+		mesh.faces = std::pmr::vector<rtFace>(&fileInfo.arena);
+		mesh.faceMaterialIndexs = std::pmr::vector<int>(&fileInfo.arena);
+	}
+	fileInfo.arena.release();
 
-		transmission.m_origin = forward;
-		transmission.m_direction = transmissionDir;
+	int triangles = std::max(1, TriangleCount());
+	std::cout << "compact geometry: " << TriangleCount() << " triangles, " << static_cast<double>(GeometryByteSize()) / triangles
+		<< " bytes per triangle (" << static_cast<double>(fullBytes) / triangles << " at full precision), max position error " << maxError << std::endl;
+	return true;
+}
 
-		if (sinphii > (curEta / etai))
-		{
-			hit = hit + (RecursiveTraceRay(reflection, recusiveDepth + 1, etai, isSphere_, objIndex_, etai) * FresnelReflectance);
-		}
-		else
-		{
-			rtColor trans;
-			trans = RecursiveTraceRay(transmission, recusiveDepth + 1, isSphere_ ? curEta : etai, isSphere_, objIndex_, etai) * ((1.0 - FresnelReflectance) * (1.0 - curAlpha));
-			hit = hit + (RecursiveTraceRay(reflection, recusiveDepth + 1, etai, isSphere_, objIndex_, etai) * FresnelReflectance) + trans;
-		}
-		
-	}
-	else
+size_t rayTracer::GeometryByteSize() const
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	size_t bytes = TriangleMeshView(fileInfo).byteSize();
+	for (const rtMesh& mesh : fileInfo.meshes)
 	{
-		return fileInfo->bkgColor;
+		bytes += TriangleMeshView(mesh).byteSize();
 	}
+	return bytes;
+}
 
-	return hit;
+int rayTracer::TriangleCount() const
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	int count = TriangleMeshView(fileInfo).faceCount();
+	for (const rtMesh& mesh : fileInfo.meshes)
+	{
+		count += TriangleMeshView(mesh).faceCount();
+	}
+	return count;
 }
 
-rtColor rayTracer::BlinnPhongShading(const rtMaterial& mtlColor, const rtPoint& intersection, int objIndex, const rtVector3& normal, bool isSphere, const rtPoint& newOrigin)
+bool rayTracer::SetSphereCenter(int sphereIndex, const rtPoint& center)
 {
 	auto fileInfo = m_fileReader->getFileInfo();
-	rtPoint center;
-
-	// set intial color based on material property
-	double r = mtlColor.m_ka * mtlColor.m_odr;
-	double g = mtlColor.m_ka * mtlColor.m_odg;
-	double b = mtlColor.m_ka * mtlColor.m_odb;
+	if (sphereIndex < 0 || sphereIndex >= static_cast<int>(fileInfo->spheres.size()))
+	{
+		return false;
+	}
+	fileInfo->spheres[sphereIndex].m_center = center;
+	return true;
+}
 
-	// shoot lights to the intersection
-	for (int i = 0; i < fileInfo->lights.size(); i++)
+bool rayTracer::SetVertexPosition(int vertexIndex, const rtPoint& position)
+{
+	auto fileInfo = m_fileReader->getFileInfo();
+	if (vertexIndex < 0 || vertexIndex >= static_cast<int>(fileInfo->verteices.size()))
 	{
-		auto curLight = fileInfo->lights[i];
-		double shadowMask = 1.0;
-		rtVector3 lightDir;
-		double maxT1 = 0.0;
-		double fatt = 1.0;
+		return false;
+	}
+	fileInfo->verteices[vertexIndex] = position;
+	return true;
+}
 
-		// calculate the L vector in phong equation
-		switch (curLight.getType())
-		{
-		case eLightType::kAttPointLight:
-		case eLightType::kPointLight:
-		{
-			rtPoint lightSource(curLight.m_center.m_x, curLight.m_center.m_y, curLight.m_center.m_z);
-			lightDir = lightSource.subtract(intersection);
-			maxT1 = lightDir.length();
-			lightDir.twoNorm();
+rtAABB rayTracer::SphereBounds(int sphereIndex) const
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	if (sphereIndex < 0 || sphereIndex >= static_cast<int>(fileInfo.spheres.size()))
+	{
+		return rtAABB();
+	}
+	const rtSphere& sphere = fileInfo.spheres[sphereIndex];
+	rtVector3 r(sphere.m_radius, sphere.m_radius, sphere.m_radius);
+	return rtAABB(rtPoint::add(sphere.m_center, r.scale(-1.0)), rtPoint::add(sphere.m_center, r));
+}
 
-			// for point light, use fatt to indicate "Light Source Attenuation"
-			fatt = 1.0 / (curLight.m_c1 + curLight.m_c2 * maxT1 + curLight.m_c3 * maxT1 * maxT1);
-		}
-		break;
-		case eLightType::kDirectionalLight:
-		{
-			lightDir = rtVector3(-curLight.m_vec3.m_x, -curLight.m_vec3.m_y, -curLight.m_vec3.m_z);
-			lightDir.twoNorm();
-		}
-		break;
-		case eLightType::kSpotlight:
-		case eLightType::kAttSpotlight:
+rtAABB rayTracer::VertexBounds(int vertexIndex) const
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	rtAABB bounds;
+	if (vertexIndex < 0 || vertexIndex >= static_cast<int>(fileInfo.verteices.size()))
+	{
+		return bounds;
+	}
+	bounds.expand(fileInfo.verteices[vertexIndex]);
+	for (const rtFace& face : fileInfo.faces)
+	{
+		// face corners are 1-based
+		if (face[0][0] == vertexIndex + 1 || face[1][0] == vertexIndex + 1 || face[2][0] == vertexIndex + 1)
 		{
-			rtVector3 vobj = intersection.subtract(curLight.m_center).getTwoNorm();
-			rtVector3 vlight(curLight.m_vec3.m_x, curLight.m_vec3.m_y, curLight.m_vec3.m_z);
-			vlight.twoNorm();
-
-			// check if this spotlight is valid for the single intersection 
-			// then add them to the global lights vector and count the number 
-			if (rtVector3::dotProduct(vlight, vobj) >= std::cos(curLight.m_theta * M_PI / 180.0))
+			for (int k = 0; k < 3; k++)
 			{
-				rtPoint lightSource(curLight.m_center.m_x, curLight.m_center.m_y, curLight.m_center.m_z);
-				lightDir = lightSource.subtract(intersection);
-				maxT1 = lightDir.length();
-				lightDir.twoNorm();
-				// for point light, use fatt to indicate "Light Source Attenuation"
-				fatt = 1.0 / (curLight.m_c1 + curLight.m_c2 * maxT1 + curLight.m_c3 * maxT1 * maxT1);
-			}
-			else
-			{
-				continue;
+				bounds.expand(fileInfo.verteices[face[k][0] - 1]);
 			}
 		}
-		break;
-		default:
-			break;
+	}
+	return bounds;
+}
+
+bool rayTracer::UpdateAccelerationStructure()
+{
+	bool rebuilt = m_accelerator->update();
+	// moved geometry can change the scene bounds the light regions are clipped to
+	BuildLightStructure();
+	return rebuilt;
+}
+
+bool rayTracer::ComputeUV()
+{
+	// check viewDir and upDir are not parallel
+	m_u = rtVector3::crossProduct(m_camera.m_viewDir, m_camera.m_upDir);
+
+	if (m_u.m_x == 0.0 && m_u.m_y == 0.0 && m_u.m_z == 0.0)
+	{
+		std::cout << "viewDir and upDir are parallel" << std::endl;
+		return false;
+	}
+
+	m_u.twoNorm();
+	m_v = rtVector3::crossProduct(m_u, m_camera.m_viewDir);
+	m_v.twoNorm();
+
+	return true;
+}
+
+bool rayTracer::ComputeAspectRatioAndRenderPlane()
+{
+	double aspectRatio = static_cast<double>(m_camera.m_imageSize.m_x) / static_cast<double>(m_camera.m_imageSize.m_y);
+	double distance = 5.0; // random number
+	double height = 2.0 * distance * std::tan(m_camera.m_vFov * M_PI / 360.0);
+	double width = height * aspectRatio;
+	
+	rtVector3 n = m_camera.m_viewDir.getTwoNorm();
+	rtPoint center = rtPoint::add(m_camera.m_eye, n.scale(distance));
+	m_ul = rtPoint::add(rtPoint::add(center, m_u.scale(-width / 2.0)), m_v.scale(height / 2.0));
+	m_ur = rtPoint::add(m_camera.m_eye, n.scale(distance).add(m_u.scale(width / 2.0).add(m_v.scale(height / 2.0))));
+	m_ll = rtPoint::add(m_camera.m_eye, n.scale(distance).add(m_u.scale(-width / 2.0).add(m_v.scale(-height / 2.0))));
+	m_lr = rtPoint::add(m_camera.m_eye, n.scale(distance).add(m_u.scale(width / 2.0).add(m_v.scale(-height / 2.0))));
+
+	return true;
+}
+
+void rayTracer::InitPixelArray()
+{
+	auto fileInfo = m_fileReader->getFileInfo();
+
+	if (!m_outOfCoreFile.empty())
+	{
+		m_pixels.clear();
+		return;
+	}
+	m_pixels.assign(static_cast<int>(m_frameSize.m_x), std::vector<rtColor>(static_cast<int>(m_frameSize.m_y), fileInfo->bkgColor));
+
+	for (int i = 0; i < m_frameSize.m_x; i++)
+	{
+		for (int j = 0; j < m_frameSize.m_y; j++)
+		{
+			m_pixels[i][j] = fileInfo->bkgColor;
 		}
+	}
+}
 
-		// calculate the V and H vectors in phong equation
-		rtVector3 V = newOrigin.subtract(intersection).getTwoNorm();
-		rtVector3 H = lightDir.add(V).getTwoNorm();
-		double nl = rtVector3::dotProduct(normal, lightDir);
-		double nh = rtVector3::dotProduct(normal, H);
+void rayTracer::ComputePixelGrid()
+{
+	// the render plane spans the full image, reduced quality only spaces the pixels wider
+	const rtVector2<int>& imageSize = m_frameSize;
+	m_pixelStepH = m_ur.subtract(m_ul).scale(1.0 / static_cast<double>(imageSize.m_x));
+	m_pixelStepV = m_ll.subtract(m_ul).scale(1.0 / static_cast<double>(imageSize.m_y));
+	m_halfPixelH = m_ur.subtract(m_ul).scale(1.0 / (2.0 * static_cast<double>(imageSize.m_x)));
+	m_halfPixelV = m_ll.subtract(m_ul).scale(1.0 / (2.0 * static_cast<double>(imageSize.m_y)));
+	// the angle one pixel subtends
+	m_pixelSpread = 2.0 * std::tan(m_camera.m_vFov * M_PI / 360.0) / imageSize.m_y;
+}
+
+rtRay rayTracer::PrimaryRay(const rtVector2<int>& pixel) const
+{
+	// through the pixel's center
+	rtPoint end = rtPoint::add(rtPoint::add(rtPoint::add(rtPoint::add(m_ul, m_pixelStepH.scale((double)pixel.m_x)), m_pixelStepV.scale((double)pixel.m_y)), m_halfPixelH), m_halfPixelV);
+	rtVector3 rayDir = end.subtract(m_camera.m_eye);
+	rayDir.twoNorm();
+	rtRay ray;
+	ray.m_origin = m_camera.m_eye;
+	ray.m_direction = rayDir;
+	ray.m_coneSpread = m_pixelSpread;
+	return ray;
+}
 
-		// shoot shadow rays to check shadow
-		double t1 = std::numeric_limits<double>::infinity();
-		rtRay shadowRay;
-		shadowRay.m_origin = intersection;
-		shadowRay.m_direction = lightDir;
-		double x0 = shadowRay.m_origin.m_x;
-		double y0 = shadowRay.m_origin.m_y;
-		double z0 = shadowRay.m_origin.m_z;
-		double xd = shadowRay.m_direction.m_x;
-		double yd = shadowRay.m_direction.m_y;
-		double zd = shadowRay.m_direction.m_z;
-
-		for (int k = 0; k < fileInfo->spheres.size(); k++)
-		{
-			if (k == objIndex && isSphere)
+void rayTracer::ComputePixelColor()
+{
+	m_raysTraced = 0;
+	RenderTile(rtTile(0, 0, m_frameSize.m_x, m_frameSize.m_y));
+}
+
+void rayTracer::ComputePixelColor(const std::vector<rtTile>& tiles, int threadCount)
+{
+	// tiles are pulled dynamically so uneven tiles don't stall a thread
+	std::atomic<int> nextTile(0);
+	rtAllocationCounter::reset();
+	m_raysTraced = 0;
+
+	// finished tiles are copied into their own image, tiles still being traced are never read
+	std::mutex progressMutex;
+	std::vector<std::vector<rtColor>> progress;
+	int tilesDone = 0;
+	if (m_progressiveInterval > 0 && m_recordDependencies && !m_dependencies.empty())
+	{
+		// a re-render of a recorded frame: the tiles not traced again are final already
+		progress = m_pixels;
+	}
+	else if (m_progressiveInterval > 0)
+	{
+		progress.assign(m_pixels.size(), std::vector<rtColor>(m_pixels.empty() ? 0 : m_pixels[0].size()));
+	}
+	auto finishTile = [&](const rayTracer& tracer, const rtTile& tile)
+	{
+		std::lock_guard<std::mutex> lock(progressMutex);
+		for (int i = tile.m_x0; i < tile.m_x1; i++)
+		{
+			std::copy(tracer.m_pixels[i].begin() + tile.m_y0, tracer.m_pixels[i].begin() + tile.m_y1, progress[i].begin() + tile.m_y0);
+		}
+		if (++tilesDone % m_progressiveInterval == 0 && tilesDone < static_cast<int>(tiles.size()))
+		{
+			WriteFullSizeImage(m_progressiveFile, progress);
+		}
+	};
+
+	rtTiledImageFile outOfCore;
+	bool outOfCoreFailed = false;
+	if (!m_outOfCoreFile.empty() && !outOfCore.create(m_outOfCoreFile, m_frameSize))
+	{
+		return;
+	}
+
+	// finished tiles of replicas are copied in right away so the checkpoint finds all of them
+	// in m_pixels. other threads only write pixels of unfinished tiles meanwhile
+	auto lastCheckpoint = std::chrono::steady_clock::now();
+	auto checkpointTile = [&](const rayTracer& tracer, const rtTile& tile)
+	{
+		std::lock_guard<std::mutex> lock(progressMutex);
+		if (&tracer != this)
+		{
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
 			{
-				continue;
+				std::copy(tracer.m_pixels[i].begin() + tile.m_y0, tracer.m_pixels[i].begin() + tile.m_y1, m_pixels[i].begin() + tile.m_y0);
 			}
+		}
+		m_checkpointTiles.push_back(tile);
+		auto now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - lastCheckpoint).count() >= m_checkpointInterval)
+		{
+			rtCheckpoint::write(m_checkpointFile, m_checkpointFingerprint, m_frameSize, m_checkpointTiles, m_pixels);
+			lastCheckpoint = now;
+		}
+	};
 
-			double xc = fileInfo->spheres[k].m_center.m_x;
-			double yc = fileInfo->spheres[k].m_center.m_y;
-			double zc = fileInfo->spheres[k].m_center.m_z;
-			double r = fileInfo->spheres[k].m_radius;
-
-			double A = 1.0;
-			double B = 2.0 * (xd * (x0 - xc) + yd * (y0 - yc) + zd * (z0 - zc));
-			double C = (x0 - xc) * (x0 - xc) + (y0 - yc) * (y0 - yc) + (z0 - zc) * (z0 - zc) - r * r;
-			double delta = B * B - 4.0 * A * C;
+	// the records of a new frame are laid over the scene as it is now
+	if (m_recordDependencies && m_dependencies.empty())
+	{
+		m_dependencies.reset(m_accelerator->bounds(), static_cast<int>(m_fileReader->getFileInfo()->materials.size()));
+	}
 
-			// check discriminant
-			if (delta == 0.0)
+	// numa: threads bound to cpus spread over the nodes, with replicate each node's threads
+	// trace their node's copy of the scene and their tiles are copied back at the end
+	std::vector<rtThreadPlacement> placement;
+	std::vector<std::unique_ptr<rayTracer>> replicas;
+	std::vector<rayTracer*> tracedBy(tiles.size(), this);
+	if (m_numaPolicy != eNumaPolicy::kOff && threadCount > 1)
+	{
+		rtNumaTopology topology = rtNumaTopology::detect();
+		placement = topology.place(threadCount);
+		if (m_numaPolicy == eNumaPolicy::kReplicate)
+		{
+			auto replicateStart = std::chrono::steady_clock::now();
+			// thread n is the first on node n, nodes without threads get no copy
+			replicas.resize(std::min(topology.nodes().size(), placement.size()));
+			std::vector<std::thread> builders;
+			for (size_t n = 0; n < replicas.size(); n++)
 			{
-				double temp_t1 = (-B) / (2.0 * A);
-				if (temp_t1 > 0 && temp_t1 < t1)
+				builders.emplace_back([&, n]()
 				{
-					t1 = temp_t1;
-				}
+					rtNumaTopology::pinThisThread(placement[n].m_cpu);
+					replicas[n] = CreateReplica();
+				});
 			}
-			else if (delta > 0.0)
+			for (auto& builder : builders)
 			{
-				double temp_t1 = (std::sqrt(delta) - B) / (2.0 * A);
-				double temp_t2 = (-std::sqrt(delta) - B) / (2.0 * A);
-
-				double comparator = curLight.getType() == eLightType::kDirectionalLight ? std::numeric_limits<double>::infinity() : maxT1;
-				if ((temp_t1 > 0 && temp_t1 < comparator) || (temp_t2 > 0 && temp_t2 < comparator))
+				builder.join();
+			}
+			if (m_numaReport)
+			{
+				std::cout << "numa: scene replicated on " << replicas.size() << " nodes in "
+					<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replicateStart).count() << "ms" << std::endl;
+			}
+		}
+		if (m_numaReport)
+		{
+			for (size_t n = 0; n < topology.nodes().size(); n++)
+			{
+				std::cout << "numa: node " << topology.nodes()[n].m_id << ":";
+				for (int i = 0; i < threadCount; i++)
 				{
-					shadowMask = shadowMask * (1.0 - fileInfo->materials[fileInfo->spheres[k].m_materialIndex].m_alpha);
+					if (placement[i].m_node == static_cast<int>(n))
+					{
+						std::cout << " thread " << i << " on cpu " << placement[i].m_cpu << ",";
+					}
 				}
+				std::cout << (replicas.empty() ? " shared scene" : " own scene") << std::endl;
+			}
+		}
+	}
 
-				if ((temp_t1 < t1) && temp_t1 > 0)
+	auto worker = [&](int threadIndex)
+	{
+		rayTracer* tracer = this;
+		if (!placement.empty())
+		{
+			const rtThreadPlacement& place = placement[threadIndex];
+			if (!rtNumaTopology::pinThisThread(place.m_cpu) && m_numaReport)
+			{
+				std::cout << "numa: thread " << threadIndex << " could not be pinned" << std::endl;
+			}
+			if (!replicas.empty())
+			{
+				tracer = replicas[place.m_node].get();
+			}
+		}
+		for (int t = nextTile++; t < static_cast<int>(tiles.size()); t = nextTile++)
+		{
+			if (m_recordDependencies)
+			{
+				m_dependencies.begin(t_dependencies, tiles[t]);
+				t_dependencyMap = &m_dependencies;
+			}
+			tracer->RenderTile(tiles[t]);
+			tracedBy[t] = tracer;
+			if (m_recordDependencies)
+			{
+				t_dependencyMap = nullptr;
+				std::lock_guard<std::mutex> lock(progressMutex);
+				m_dependencies.store(t_dependencies);
+			}
+			if (!m_outOfCoreFile.empty())
+			{
+				// a failed write stops the render, the file can't be completed anyway
+				if (!outOfCore.writeTile(tiles[t], t_tilePixels))
 				{
-					t1 = temp_t1;
+					outOfCoreFailed = true;
+					nextTile = static_cast<int>(tiles.size());
 				}
+				continue;
+			}
+			if (m_progressiveInterval > 0)
+			{
+				finishTile(*tracer, tiles[t]);
+			}
+			if (!m_checkpointFile.empty())
+			{
+				checkpointTile(*tracer, tiles[t]);
+			}
+		}
+	};
 
-				if ((temp_t2 < t1) && temp_t2 > 0)
-				{
-					t1 = temp_t2;
-				}
+	if (threadCount <= 1)
+	{
+		worker(0);
+	}
+	else
+	{
+		std::vector<std::thread> threads;
+		for (int i = 0; i < threadCount; i++)
+		{
+			threads.emplace_back(worker, i);
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	if (!m_outOfCoreFile.empty() && !outOfCore.close() && !outOfCoreFailed)
+	{
+		std::cout << "Can't write image: " << m_outOfCoreFile << std::endl;
+	}
+	for (size_t t = 0; t < tiles.size() && m_outOfCoreFile.empty(); t++)
+	{
+		if (tracedBy[t] != this)
+		{
+			const rtTile& tile = tiles[t];
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
+			{
+				std::copy(tracedBy[t]->m_pixels[i].begin() + tile.m_y0, tracedBy[t]->m_pixels[i].begin() + tile.m_y1, m_pixels[i].begin() + tile.m_y0);
 			}
 		}
-		// shoot shadow rays and check if it intersect with triangles
-		for (int triIndex = 0; triIndex < fileInfo->faces.size(); triIndex++)
+	}
+	for (const auto& replica : replicas)
+	{
+		m_raysTraced += replica->m_raysTraced;
+	}
+
+	if (rtAllocationCounter::enabled())
+	{
+		std::cout << "heap allocations while tracing: " << rtAllocationCounter::tracingAllocations() << std::endl;
+	}
+}
+
+void rayTracer::RenderTile(const rtTile& tile)
+{
+	// the previous tile's scratch data is dead by now
+	rtScratchArena& scratch = rtScratchArena::forThisThread();
+	scratch.reset();
+	size_t lightCount = m_fileReader->getFileInfo()->lights.size();
+	t_lightCandidates.reserve(lightCount);
+	t_lightTerms.reserve(lightCount);
+	if (!m_outOfCoreFile.empty())
+	{
+		t_tilePixels.resize(static_cast<size_t>(tile.width()) * tile.height());
+	}
+	rtAllocationCounter::TracingScope tracing;
+
+	// the tile's pixels in render order
+	size_t pixelCount = static_cast<size_t>(tile.width()) * tile.height();
+	std::pmr::vector<rtVector2<int>> pixels(scratch.resource());
+	pixels.reserve(pixelCount);
+	for (int i = tile.m_x0; i < tile.m_x1; i++)
+	{
+		for (int j = tile.m_y0; j < tile.m_y1; j++)
+		{
+			pixels.push_back(rtVector2<int>(i, j));
+		}
+	}
+	if (m_pixelOrder != eTraversalOrder::kColumn)
+	{
+		// ties fall back to the column index, the same as a stable sort
+		std::pmr::vector<std::pair<uint64_t, int>> keys(scratch.resource());
+		keys.reserve(pixelCount);
+		for (size_t p = 0; p < pixels.size(); p++)
+		{
+			keys.emplace_back(TraversalKey(m_pixelOrder, pixels[p].m_x - tile.m_x0, pixels[p].m_y - tile.m_y0, tile.width(), tile.height()), static_cast<int>(p));
+		}
+		std::sort(keys.begin(), keys.end());
+		std::pmr::vector<rtVector2<int>> ordered(scratch.resource());
+		ordered.reserve(pixelCount);
+		for (const auto& key : keys)
 		{
-			if (triIndex == objIndex && (!isSphere))
+			ordered.push_back(pixels[key.second]);
+		}
+		pixels.swap(ordered);
+	}
+
+	// gather the tile's primary rays into one contiguous run before tracing them
+	std::pmr::vector<rtRay> rays(scratch.resource());
+	rays.reserve(pixelCount);
+	for (const rtVector2<int>& pixel : pixels)
+	{
+		rays.push_back(PrimaryRay(pixel));
+	}
+
+	t_raysTraced = 0;
+	if (m_coherentRays)
+	{
+		TraceTileCoherent(tile, pixels, rays, scratch.resource());
+		m_raysTraced += t_raysTraced;
+		return;
+	}
+
+	const rtRay* ray = rays.data();
+	for (const rtVector2<int>& pixel : pixels)
+	{
+		rtColor pixelColor = RecursiveTraceRay(*ray++, 0, 1.0, rtPrimitiveRef(), 1.0);
+		pixelColor.clamp();
+		StorePixel(tile, pixel, pixelColor);
+	}
+	m_raysTraced += t_raysTraced;
+}
+
+void rayTracer::TraceTileCoherent(const rtTile& tile, const std::pmr::vector<rtVector2<int>>& pixels, const std::pmr::vector<rtRay>& rays, std::pmr::memory_resource* scratch)
+{
+	if (rays.empty())
+	{
+		return;
+	}
+	const ObjFileInfo* fileInfo = m_fileReader->getFileInfo().get();
+	rtAABB bounds = m_accelerator->bounds();
+
+	// levels[d][i] is the node of the i-th ray of depth d, its children are in levels[d + 1].
+	// the primary rays are the pixels, in the order of rays
+	std::pmr::vector<std::pmr::vector<rtPathNode>> levels(scratch);
+	std::pmr::vector<rtQueuedRay> wave(scratch);
+	std::pmr::vector<rtQueuedRay> nextWave(scratch);
+	std::pmr::vector<std::pair<uint64_t, int>> order(scratch);
+	levels.reserve(m_quality.m_maxDepth + 1);
+	wave.reserve(rays.size());
+	for (const rtRay& ray : rays)
+	{
+		wave.push_back({ ray, 1.0, rtPrimitiveRef(), 1.0 });
+	}
+
+	for (int depth = 0; !wave.empty(); depth++)
+	{
+		levels.emplace_back(wave.size());
+		std::pmr::vector<rtPathNode>& nodes = levels.back();
+
+		order.clear();
+		for (size_t i = 0; i < wave.size(); i++)
+		{
+			// primary rays are coherent in scanline order already
+			order.emplace_back(depth == 0 ? 0 : CoherenceKey(wave[i].m_ray, bounds), static_cast<int>(i));
+		}
+		if (depth > 0)
+		{
+			std::sort(order.begin(), order.end());
+		}
+
+		nextWave.clear();
+		if (depth < m_quality.m_maxDepth)
+		{
+			nextWave.reserve(2 * wave.size());
+		}
+		for (const auto& entry : order)
+		{
+			const rtQueuedRay& queued = wave[entry.second];
+			rtPathNode& node = nodes[entry.second];
+			if (depth == m_quality.m_maxDepth)
 			{
+				node.m_color = DepthLimitColor(queued.m_lastPrim);
 				continue;
 			}
-			// same logic when shooting viewing ray
-			rtPoint firstVertex = fileInfo->verteices[fileInfo->faces[triIndex][0][0] - 1];
-			rtPoint secondVertex = fileInfo->verteices[fileInfo->faces[triIndex][1][0] - 1];;
-			rtPoint thirdVertex = fileInfo->verteices[fileInfo->faces[triIndex][2][0] - 1];;
-			rtVector3 e1 = secondVertex.subtract(firstVertex);
-			rtVector3 e2 = thirdVertex.subtract(firstVertex);
-			rtVector3 normal = rtVector3::crossProduct(e1, e2);
-			double A = normal.m_x;
-			double B = normal.m_y;
-			double C = normal.m_z;
-			double D = -(firstVertex.m_x * A + firstVertex.m_y * B + firstVertex.m_z * C);
-			double deterimint = A * xd + B * yd + C * zd;
-			if (deterimint <= EPSILON && deterimint >= -EPSILON)
+
+			rtHitRecord hitRecord;
+			t_raysTraced++;
+			bool found = m_accelerator->closestHit(queued.m_ray, hitRecord);
+			if (t_dependencyMap)
+			{
+				RecordRay(*fileInfo, queued.m_ray, found ? &hitRecord : nullptr);
+			}
+			if (!found)
 			{
+				node.m_color = fileInfo->bkgColor;
 				continue;
 			}
-			double triT = -(A * x0 + B * y0 + C * z0 + D) / deterimint;
-			if (triT <= 0.0)
+
+			rtSecondaryRays secondary;
+			node.m_color = ShadeHit(queued.m_ray, hitRecord, queued.m_etai, queued.m_lastPrim, queued.m_lastEta, secondary);
+			node.m_reflectance = secondary.m_reflectance;
+			node.m_reflection = static_cast<int>(nextWave.size());
+			nextWave.push_back({ secondary.m_reflection, queued.m_etai, hitRecord.m_prim, queued.m_etai });
+			if (secondary.m_transmits)
+			{
+				node.m_transmittance = secondary.m_transmittance;
+				node.m_transmission = static_cast<int>(nextWave.size());
+				nextWave.push_back({ secondary.m_transmission, secondary.m_transmissionEta, hitRecord.m_prim, queued.m_etai });
+			}
+		}
+		std::swap(wave, nextWave);
+	}
+
+	// deepest level first, every child is final before its parent combines it
+	for (size_t d = levels.size() - 1; d-- > 0;)
+	{
+		std::pmr::vector<rtPathNode>& children = levels[d + 1];
+		for (rtPathNode& node : levels[d])
+		{
+			if (node.m_reflection < 0)
 			{
 				continue;
 			}
-			rtPoint hitP = rtPoint::add(intersection, shadowRay.m_direction.scale(triT));
-			rtVector3 e3 = hitP.subtract(secondVertex);
-			rtVector3 e4 = hitP.subtract(thirdVertex);
-			double totalArea = rtVector3::area(e1, e2);
-			double aArea = rtVector3::area(e3, e4);
-			double bArea = rtVector3::area(e4, e2);
-			double cArea = rtVector3::area(e1, e3);
-			double alpha = aArea / totalArea;
-			double beta = bArea / totalArea;
-			double gamma = cArea / totalArea;
-			if (alpha < 1.0 && alpha > 0.0 && beta < 1.0 && beta > 0.0 && gamma > 0.0 && gamma < 1.0 && alpha + beta + gamma - 1 < EPSILON)
+			if (node.m_transmission < 0)
+			{
+				node.m_color = node.m_color + (children[node.m_reflection].m_color * node.m_reflectance);
+			}
+			else
 			{
-				double comparator = curLight.getType() == eLightType::kDirectionalLight ? std::numeric_limits<double>::infinity() : maxT1;
+				rtColor trans = children[node.m_transmission].m_color * node.m_transmittance;
+				node.m_color = node.m_color + (children[node.m_reflection].m_color * node.m_reflectance) + trans;
+			}
+		}
+	}
 
-				if (triT > 0 && triT < comparator)
-				{
-					shadowMask = shadowMask * (1.0 - fileInfo->materials[fileInfo->faceMaterialIndexs[triIndex]].m_alpha);
-				}
+	const rtPathNode* node = levels[0].data();
+	for (const rtVector2<int>& pixel : pixels)
+	{
+		rtColor pixelColor = (node++)->m_color;
+		pixelColor.clamp();
+		StorePixel(tile, pixel, pixelColor);
+	}
+}
 
-				if (triT < t1 && triT > 0) // todo might not correct
-				{
-					t1 = triT;
-				}
-			}
+void rayTracer::StorePixel(const rtTile& tile, const rtVector2<int>& pixel, const rtColor& color)
+{
+	if (!m_outOfCoreFile.empty())
+	{
+		t_tilePixels[static_cast<size_t>(pixel.m_x - tile.m_x0) * tile.height() + (pixel.m_y - tile.m_y0)] = color;
+		return;
+	}
+	m_pixels[pixel.m_x][pixel.m_y] = color;
+}
+
+rtColor rayTracer::RecursiveTraceRay(const rtRay& incidence, int recusiveDepth, double etai, const rtPrimitiveRef& lastPrim, double lastEta)
+{
+	if (recusiveDepth == m_quality.m_maxDepth)
+	{
+		return DepthLimitColor(lastPrim);
+	}
+
+	// determine is a ray intersects with an object;
+	rtHitRecord hitRecord;
+	t_raysTraced++;
+	bool found = m_accelerator->closestHit(incidence, hitRecord);
+	if (t_dependencyMap)
+	{
+		RecordRay(*m_fileReader->getFileInfo(), incidence, found ? &hitRecord : nullptr);
+	}
+	if (!found)
+	{
+		return m_fileReader->getFileInfo()->bkgColor;
+	}
+
+	rtSecondaryRays secondary;
+	rtColor hit = ShadeHit(incidence, hitRecord, etai, lastPrim, lastEta, secondary);
+	const rtPrimitiveRef& prim = hitRecord.m_prim;
+	if (!secondary.m_transmits)
+	{
+		return hit + (RecursiveTraceRay(secondary.m_reflection, recusiveDepth + 1, etai, prim, etai) * secondary.m_reflectance);
+	}
+	rtColor trans;
+	trans = RecursiveTraceRay(secondary.m_transmission, recusiveDepth + 1, secondary.m_transmissionEta, prim, etai) * secondary.m_transmittance;
+	return hit + (RecursiveTraceRay(secondary.m_reflection, recusiveDepth + 1, etai, prim, etai) * secondary.m_reflectance) + trans;
+}
+
+rtColor rayTracer::DepthLimitColor(const rtPrimitiveRef& lastPrim) const
+{
+	const ObjFileInfo* fileInfo = m_fileReader->getFileInfo().get();
+	const rtMaterial& lastMtl = fileInfo->materials[PrimitiveMaterialIndex(*fileInfo, lastPrim)];
+	return rtColor(lastMtl.m_odr, lastMtl.m_odg, lastMtl.m_odb);
+}
+
+double rayTracer::TextureLod(const rtTexture& texture, const rtRay& incidence, double t, const rtPrimitiveRef& prim, double cosine) const
+{
+	const ObjFileInfo& fileInfo = *m_fileReader->getFileInfo();
+	double texelArea = static_cast<double>(texture.size().m_x) * texture.size().m_y;
+
+	// full resolution texels per unit of surface length
+	double texelDensity;
+	if (prim.m_isSphere)
+	{
+		double radius = fileInfo.spheres[prim.m_objIndex].m_radius;
+		texelDensity = std::sqrt(texelArea / (4.0 * M_PI * radius * radius));
+	}
+	else
+	{
+		rtTriangleMeshView mesh = TriangleMeshView(fileInfo, prim);
+		rtPoint p[3];
+		rtVector2<double> uv[3];
+		mesh.positions(prim.m_objIndex, p);
+		mesh.textureCoordinates(prim.m_objIndex, uv);
+		double worldArea = rtVector3::crossProduct(p[1].subtract(p[0]), p[2].subtract(p[0])).length();
+		double uvArea = std::abs((uv[1].m_x - uv[0].m_x) * (uv[2].m_y - uv[0].m_y) - (uv[2].m_x - uv[0].m_x) * (uv[1].m_y - uv[0].m_y));
+		texelDensity = worldArea > 0.0 ? std::sqrt(uvArea * texelArea / worldArea) : 0.0;
+	}
+
+	// the cone's width where it meets the surface, stretched by grazing incidence
+	double width = incidence.m_coneWidth + incidence.m_coneSpread * t;
+	double footprint = width * texelDensity / std::max(cosine, 1e-3);
+	return footprint > 0.0 ? std::log2(footprint) : 0.0;
+}
+
+rtColor rayTracer::ShadeHit(const rtRay& incidence, const rtHitRecord& hitRecord, double etai, const rtPrimitiveRef& lastPrim, double lastEta, rtSecondaryRays& secondary)
+{
+	const ObjFileInfo* fileInfo = m_fileReader->getFileInfo().get();
+	bool exit = false;
+	rtColor hit;
+
+	double t1 = hitRecord.m_t;
+	const rtPrimitiveRef& prim = hitRecord.m_prim;
+	bool isSphere_ = prim.m_isSphere;
+	int objIndex_ = prim.m_objIndex;
+	double finalAlpha = hitRecord.m_alpha;
+	double finalBeta = hitRecord.m_beta;
+	double finalGamma = hitRecord.m_gamma;
+
+	rtVector3 triNormal;
+	if (!isSphere_)
+	{
+		rtTriangleMeshView mesh = TriangleMeshView(*fileInfo, prim);
+		rtVector3 vertexNormals[3];
+		if (!mesh.normals(objIndex_, vertexNormals))
+		{
+			// if no vn, which means flat shading
+			rtPoint p[3];
+			mesh.positions(objIndex_, p);
+			rtVector3 e1 = p[1].subtract(p[0]);
+			rtVector3 e2 = p[2].subtract(p[0]);
+			triNormal = rtVector3::crossProduct(e1, e2);
+		}
+		else
+		{
+			// smooth shading
+			triNormal = (vertexNormals[0].scale(finalAlpha).add(vertexNormals[1].scale(finalBeta)).add(vertexNormals[2].scale(finalGamma))).getTwoNorm();
+		}
+
+		if (prim.m_instanceIndex >= 0)
+		{
+			// mesh space normal to world space
+			triNormal = fileInfo->instances[prim.m_instanceIndex].inverse.transformNormalByInverse(triNormal);
+		}
+	}
+
+	// find the intersection point and its color
+	rtVector3 I = incidence.m_direction.getTwoNorm().scale(-1);
+	rtVector3 rayDir = incidence.m_direction.scale(t1);
+	rtPoint closest = rtPoint::add(incidence.m_origin, rayDir);
+	const rtMaterialRecord& material = (*m_materials)[PrimitiveMaterialIndex(*fileInfo, prim)];
+	rtVector3 normal;
+	if (isSphere_)
+	{
+		// compute normal vector for sphere which will be used in phong equation
+		normal = closest.subtract(fileInfo->spheres[objIndex_].m_center).getTwoNorm();
+	}
+	else
+	{
+		// compute normal vector for triangle which will be used in phong equation
+		normal = triNormal.getTwoNorm();
+	}
+
+	if (rtVector3::dotProduct(I, normal) < 0)
+	{
+		normal = normal.scale(-1);
+	}
+
+	if (isSphere_ && (isSphere_ == lastPrim.m_isSphere) && (lastPrim.m_objIndex == objIndex_))
+	{
+		exit = true;
+	}
+
+	if (material.is(rtMaterialRecord::kTextured)) // if texture detected
+	{
+		rtColor texelColor;
+		double textureU, textureV;
+		if (!isSphere_)
+		{
+			//mapping texture to a triangle
+			rtVector2<double> texCords[3];
+			TriangleMeshView(*fileInfo, prim).textureCoordinates(objIndex_, texCords);
+			const rtVector2<double>& firstTexCord = texCords[0];
+			const rtVector2<double>& secondTexCord = texCords[1];
+			const rtVector2<double>& thirdTexCord = texCords[2];
+			// using Barycentric coordinates
+			textureU = (finalAlpha * firstTexCord.m_x + finalBeta * secondTexCord.m_x + finalGamma * thirdTexCord.m_x);
+			textureV = (finalAlpha * firstTexCord.m_y + finalBeta * secondTexCord.m_y + finalGamma * thirdTexCord.m_y);
+		}
+		else
+		{
+			//mapping texture to a sphere
+			double phi = std::acos((closest.m_z - fileInfo->spheres[objIndex_].m_center.m_z) / fileInfo->spheres[objIndex_].m_radius);
+			double zeta = std::atan2((closest.m_y - fileInfo->spheres[objIndex_].m_center.m_y), (closest.m_x - fileInfo->spheres[objIndex_].m_center.m_x));
+			textureV = phi / M_PI;
+			textureU = (zeta + M_PI) / (2.0 * M_PI);
+		}
+		const rtTexture& texture = m_materials->texture(material.m_texture);
+		if (m_textureFilter == eTextureFilter::kNearest)
+		{
+			texelColor = m_quality.m_textureLevel > 0 ? texture.sampleLevel(textureU, textureV, m_quality.m_textureLevel) : texture.sample(textureU, textureV);
+		}
+		else
+		{
+			double lod = TextureLod(texture, incidence, t1, prim, std::abs(rtVector3::dotProduct(I, normal)));
+			// reduced quality reads no finer than its texture level
+			lod = std::max(lod, static_cast<double>(m_quality.m_textureLevel));
+			texelColor = texture.sample(textureU, textureV, lod, m_textureFilter);
 		}
+		// the texel replaces the diffuse color
+		rtColor od(texelColor.m_r / 255.0, texelColor.m_g / 255.0, texelColor.m_b / 255.0);
+		rtColor ambient(material.m_ka * od.m_r, material.m_ka * od.m_g, material.m_ka * od.m_b);
+		rtColor diffuse(material.m_kd * od.m_r, material.m_kd * od.m_g, material.m_kd * od.m_b);
+		hit = BlinnPhongShading(material, ambient, diffuse, closest, prim, normal, incidence.m_origin);
+	}
+	else // no texture detected, apply normal phong equation
+	{
+		hit = BlinnPhongShading(material, material.m_ambient, material.m_diffuse, closest, prim, normal, incidence.m_origin);
+	}
+
+	rtVector3 forwardEpsilon = incidence.m_direction.scale(t1 + EPSILON);
+	rtPoint forward = rtPoint::add(incidence.m_origin, forwardEpsilon);
+
+	rtVector3 backwardEpsilon = incidence.m_direction.scale(t1 - EPSILON);
+	rtPoint backward = rtPoint::add(incidence.m_origin, backwardEpsilon);
+
+	rtRay reflection;
+	rtVector3 reflectionDir;
+
+	double cosphii = std::abs(rtVector3::dotProduct(I, normal));
+	double sinphii = std::pow(1.0 - cosphii * cosphii, 0.5);
+	reflectionDir = normal.scale(cosphii * 2.0).add(incidence.m_direction.getTwoNorm());
+	reflection.m_origin = backward;
+	reflection.m_direction = reflectionDir;
+	reflection.m_coneWidth = incidence.m_coneWidth + incidence.m_coneSpread * t1;
+	reflection.m_coneSpread = incidence.m_coneSpread;
 
-		// using phong equation to calculate rgb values
-		r += shadowMask * fatt * (mtlColor.m_kd * mtlColor.m_odr * std::max(nl, 0.0) + mtlColor.m_ks * mtlColor.m_osr * std::pow(std::max(nh, 0.0), mtlColor.m_falloff));
-		g += shadowMask * fatt * (mtlColor.m_kd * mtlColor.m_odg * std::max(nl, 0.0) + mtlColor.m_ks * mtlColor.m_osg * std::pow(std::max(nh, 0.0), mtlColor.m_falloff));
-		b += shadowMask * fatt * (mtlColor.m_kd * mtlColor.m_odb * std::max(nl, 0.0) + mtlColor.m_ks * mtlColor.m_osb * std::pow(std::max(nh, 0.0), mtlColor.m_falloff));
+	double curEta = material.m_eta;
+	double curAlpha = material.m_alpha;
+
+	if (exit)
+	{
+		curEta = lastEta;
+	}
+	double F0 = ((curEta - etai) / (curEta + etai)) * ((curEta - etai) / (curEta + etai));
+	double FresnelReflectance = F0 + (1.0 - F0) * std::pow((1.0 - cosphii), 5.0);
+
+	secondary.m_reflection = reflection;
+	secondary.m_reflectance = FresnelReflectance;
+	// no transmission past the critical angle, and none through opaque materials
+	secondary.m_transmits = !(sinphii > (curEta / etai)) && !material.is(rtMaterialRecord::kOpaque);
+	if (!secondary.m_transmits)
+	{
+		return hit;
 	}
-	rtColor ans(r, g, b);
-	return ans;
+
+	rtVector3 transmissionDir;
+	if (!isSphere_)
+	{
+		transmissionDir = incidence.m_direction.getTwoNorm();
+	}
+	else
+	{
+		double firstCoff = std::pow(1.0 - (etai / curEta) * (etai / curEta) * (1.0 - cosphii * cosphii), 0.5);
+		transmissionDir = normal.scale(-1.0).scale(firstCoff).add(normal.scale(cosphii * (etai / curEta))).add(I.scale(-1.0).scale(etai / curEta));
+		transmissionDir.twoNorm();
+	}
+
+	secondary.m_transmission.m_origin = forward;
+	secondary.m_transmission.m_direction = transmissionDir;
+	secondary.m_transmission.m_coneWidth = reflection.m_coneWidth;
+	secondary.m_transmission.m_coneSpread = reflection.m_coneSpread;
+	secondary.m_transmittance = (1.0 - FresnelReflectance) * (1.0 - curAlpha);
+	secondary.m_transmissionEta = isSphere_ ? curEta : etai;
+	return hit;
 }
 
-void rayTracer::OutputFinalImage(const std::string& outFolderName)
+template <>
+rtColor rayTracer::BlinnPhongShadingKernel<eInstructionSet::kGeneric>(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
 {
-	auto outFilePath = std::filesystem::path(m_fileReader->getFileName());
-	std::string outfileName = outFolderName + "\\" + outFilePath.stem().string() + ".ppm";
-	std::ofstream outfile(outfileName);
-	outfile << "P3\n";
-	auto fileInfo = m_fileReader->getFileInfo();
-	outfile << fileInfo->imageSize.m_x << ' ' << fileInfo->imageSize.m_y << '\n';
-	outfile << "255\n";
+	return ComputeBlinnPhong(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+}
+
+template <>
+RT_TARGET_SSE4 rtColor rayTracer::BlinnPhongShadingKernel<eInstructionSet::kSSE4>(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
+{
+	return ComputeBlinnPhong(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+}
 
-	// output the whole img
-	for (int j = 0; j < fileInfo->imageSize.m_y; j++)
+template <>
+RT_TARGET_AVX2 rtColor rayTracer::BlinnPhongShadingKernel<eInstructionSet::kAVX2>(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
+{
+	return ComputeBlinnPhong(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+}
+
+template <>
+RT_TARGET_AVX512 rtColor rayTracer::BlinnPhongShadingKernel<eInstructionSet::kAVX512>(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
+{
+	return ComputeBlinnPhong(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+}
+
+rtColor rayTracer::BlinnPhongShading(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
+{
+	switch (m_isa)
+	{
+	case eInstructionSet::kSSE4:
+		return BlinnPhongShadingKernel<eInstructionSet::kSSE4>(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+	case eInstructionSet::kAVX2:
+		return BlinnPhongShadingKernel<eInstructionSet::kAVX2>(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+	case eInstructionSet::kAVX512:
+		return BlinnPhongShadingKernel<eInstructionSet::kAVX512>(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+	default:
+		return BlinnPhongShadingKernel<eInstructionSet::kGeneric>(material, ambient, diffuse, intersection, prim, normal, newOrigin);
+	}
+}
+
+rtColor rayTracer::ComputeBlinnPhong(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection,
+	const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin)
+{
+	// set intial color based on material property
+	double r = ambient.m_r;
+	double g = ambient.m_g;
+	double b = ambient.m_b;
+
+	// only lights whose influence reaches the intersection, one kernel per light type
+	rtLightCandidates& candidates = t_lightCandidates;
+	m_lights->gather(intersection, candidates);
+
+	// calculate the V vector in phong equation, it is the same for every light
+	rtVector3 V = newOrigin.subtract(intersection).getTwoNorm();
+	std::vector<rtLightTerm>& terms = t_lightTerms;
+	terms.clear();
+	AddLightTerms(m_lights->m_directional, candidates.ofType(eLightType::kDirectionalLight), material, diffuse, intersection, normal, V, terms);
+	AddLightTerms(m_lights->m_point, candidates.ofType(eLightType::kPointLight), material, diffuse, intersection, normal, V, terms);
+	AddLightTerms(m_lights->m_spot, candidates.ofType(eLightType::kSpotlight), material, diffuse, intersection, normal, V, terms);
+	AddLightTerms(m_lights->m_attPoint, candidates.ofType(eLightType::kAttPointLight), material, diffuse, intersection, normal, V, terms);
+	AddLightTerms(m_lights->m_attSpot, candidates.ofType(eLightType::kAttSpotlight), material, diffuse, intersection, normal, V, terms);
+
+	rtRay shadowRay;
+	shadowRay.m_origin = intersection;
+	if (m_quality.m_shadows != eShadowMode::kAll)
+	{
+		// reduced quality: the strongest light's shadow ray stands for every light, or no light is shadowed
+		double shadowMask = 1.0;
+		if (m_quality.m_shadows == eShadowMode::kOne && !terms.empty())
+		{
+			auto strength = [](const rtLightTerm& term) { return term.m_fatt * (std::abs(term.m_r) + std::abs(term.m_g) + std::abs(term.m_b)); };
+			const rtLightTerm& strongest = *std::max_element(terms.begin(), terms.end(),
+				[&](const rtLightTerm& lhs, const rtLightTerm& rhs) { return strength(lhs) < strength(rhs); });
+			shadowRay.m_direction = strongest.m_lightDir;
+			shadowMask = m_accelerator->transmittance(shadowRay, strongest.m_maxT, prim);
+			if (t_dependencyMap)
+			{
+				t_dependencyMap->addSegment(t_dependencies, shadowRay, strongest.m_maxT);
+			}
+		}
+		for (const rtLightTerm& term : terms)
+		{
+			r += shadowMask * term.m_fatt * term.m_r;
+			g += shadowMask * term.m_fatt * term.m_g;
+			b += shadowMask * term.m_fatt * term.m_b;
+		}
+		return rtColor(r, g, b);
+	}
+
+	double totalWeight = 0.0;
+	bool sample = m_lightSamples > 0 && static_cast<int>(terms.size()) > m_lightSamples;
+	if (sample)
+	{
+		for (const rtLightTerm& term : terms)
+		{
+			totalWeight += term.m_fatt * (std::abs(term.m_r) + std::abs(term.m_g) + std::abs(term.m_b));
+		}
+		sample = totalWeight > 0.0 && std::isfinite(totalWeight);
+	}
+
+	if (!sample)
 	{
-		for (int i = 0; i < fileInfo->imageSize.m_x; i++)
+		for (const rtLightTerm& term : terms)
 		{
-			if ((i + j * fileInfo->imageSize.m_x) != 0 && (i + j * fileInfo->imageSize.m_x) % 5 == 0)
+			// shoot shadow rays to check shadow
+			shadowRay.m_direction = term.m_lightDir;
+			double shadowMask = m_accelerator->transmittance(shadowRay, term.m_maxT, prim);
+			if (t_dependencyMap)
 			{
-				outfile << "\n"; // 5 pixels one line
+				t_dependencyMap->addSegment(t_dependencies, shadowRay, term.m_maxT);
 			}
-			outfile << m_pixels[i][j].rtoi() << " " << m_pixels[i][j].gtoi() << " " << m_pixels[i][j].btoi() << " ";
+
+			// using phong equation to calculate rgb values
+			r += shadowMask * term.m_fatt * term.m_r;
+			g += shadowMask * term.m_fatt * term.m_g;
+			b += shadowMask * term.m_fatt * term.m_b;
 		}
+		return rtColor(r, g, b);
 	}
-	outfile.close();
+
+	// fixed shadow ray budget: pick lights in proportion to their unshadowed contribution and
+	// weight by the inverse probability. seeded by the hit point so any thread gets the same picks
+	uint64_t state = HashPoint(intersection);
+	for (int s = 0; s < m_lightSamples; s++)
+	{
+		double u = static_cast<double>(SplitMix64(state) >> 11) * (1.0 / 9007199254740992.0) * totalWeight;
+		size_t pick = 0;
+		double weight = 0.0;
+		for (; pick < terms.size(); pick++)
+		{
+			weight = terms[pick].m_fatt * (std::abs(terms[pick].m_r) + std::abs(terms[pick].m_g) + std::abs(terms[pick].m_b));
+			if (u < weight || pick + 1 == terms.size())
+			{
+				break;
+			}
+			u -= weight;
+		}
+		if (weight <= 0.0)
+		{
+			continue;
+		}
+		const rtLightTerm& term = terms[pick];
+		shadowRay.m_direction = term.m_lightDir;
+		double shadowMask = m_accelerator->transmittance(shadowRay, term.m_maxT, prim);
+		if (t_dependencyMap)
+		{
+			t_dependencyMap->addSegment(t_dependencies, shadowRay, term.m_maxT);
+		}
+		double scale = shadowMask * term.m_fatt * totalWeight / (weight * m_lightSamples);
+		r += scale * term.m_r;
+		g += scale * term.m_g;
+		b += scale * term.m_b;
+	}
+	return rtColor(r, g, b);
+}
+
+void rayTracer::OutputFinalImage(const std::string& outFolderName)
+{
+	if (!m_outOfCoreFile.empty())
+	{
+		return;
+	}
+	OutputImage(OutputFilePath(outFolderName, m_fileReader->getFileName()));
+}
+
+bool rayTracer::OutputImage(const std::string& fileName)
+{
+	return WriteFullSizeImage(fileName, m_pixels);
+}
+
+bool rayTracer::WriteFullSizeImage(const std::string& fileName, const std::vector<std::vector<rtColor>>& pixels) const
+{
+	ppmFileWriter writer(fileName);
+	const rtVector2<int>& size = m_camera.m_imageSize;
+	if (m_frameSize.m_x == size.m_x && m_frameSize.m_y == size.m_y)
+	{
+		return writer.writeImage(pixels, size);
+	}
+
+	// bilinear between the centers of the traced pixels, edges clamped
+	std::vector<std::vector<rtColor>> upscaled(size.m_x, std::vector<rtColor>(size.m_y));
+	double scaleX = static_cast<double>(m_frameSize.m_x) / size.m_x;
+	double scaleY = static_cast<double>(m_frameSize.m_y) / size.m_y;
+	for (int i = 0; i < size.m_x; i++)
+	{
+		double x = std::min(std::max((i + 0.5) * scaleX - 0.5, 0.0), m_frameSize.m_x - 1.0);
+		int x0 = static_cast<int>(x);
+		int x1 = std::min(x0 + 1, m_frameSize.m_x - 1);
+		double fx = x - x0;
+		for (int j = 0; j < size.m_y; j++)
+		{
+			double y = std::min(std::max((j + 0.5) * scaleY - 0.5, 0.0), m_frameSize.m_y - 1.0);
+			int y0 = static_cast<int>(y);
+			int y1 = std::min(y0 + 1, m_frameSize.m_y - 1);
+			double fy = y - y0;
+			rtColor c00 = pixels[x0][y0], c10 = pixels[x1][y0], c01 = pixels[x0][y1], c11 = pixels[x1][y1];
+			rtColor top = (c00 * (1.0 - fx)) + (c10 * fx);
+			rtColor bottom = (c01 * (1.0 - fx)) + (c11 * fx);
+			upscaled[i][j] = (top * (1.0 - fy)) + (bottom * fy);
+		}
+	}
+	return writer.writeImage(upscaled, size);
+}
+
+bool rayTracer::OutputPartialImage(const std::string& fileName, const std::vector<rtTile>& tiles)
+{
+	return rtPartialImage::write(fileName, m_frameSize, tiles, m_pixels);
+}
+
+bool rayTracer::OutputCroppedImage(const std::string& fileName, const rtTile& region)
+{
+	ppmFileWriter writer(fileName);
+	return writer.writeRegion(m_pixels, region);
+}
+
+bool rayTracer::OutputIntoImage(const std::string& fileName, const std::vector<rtTile>& tiles)
+{
+	ppmFileWriter writer(fileName);
+	return writer.patchImage(m_pixels, m_frameSize, tiles);
+}
+
+bool rayTracer::PrepareFrame()
+{
+	// at least one pixel each way however small the scale
+	m_frameSize.m_x = std::max(1, static_cast<int>(std::ceil(m_camera.m_imageSize.m_x * m_quality.m_resolutionScale)));
+	m_frameSize.m_y = std::max(1, static_cast<int>(std::ceil(m_camera.m_imageSize.m_y * m_quality.m_resolutionScale)));
+	if (!ComputeUV() || !ComputeAspectRatioAndRenderPlane())
+	{
+		return false;
+	}
+	InitPixelArray();
+	ComputePixelGrid();
+	return true;
+}
+
+std::unique_ptr<rayTracer> rayTracer::CreateJobInstance() const
+{
+	// the parsed scene and the material table are read-only while tracing and are shared,
+	// only the camera dependent frame state is per instance
+	auto instance = std::make_unique<rayTracer>();
+	instance->m_fileReader = m_fileReader;
+	instance->m_materials = m_materials;
+	instance->m_accelerator = m_accelerator;
+	instance->m_lights = m_lights;
+	instance->m_lightCutoff = m_lightCutoff;
+	instance->m_lightSamples = m_lightSamples;
+	instance->m_coherentRays = m_coherentRays;
+	instance->m_pixelOrder = m_pixelOrder;
+	instance->m_textureFilter = m_textureFilter;
+	instance->m_quality = m_quality;
+	instance->m_recordDependencies = m_recordDependencies;
+	instance->m_isa = m_isa;
+	instance->m_numaPolicy = m_numaPolicy;
+	instance->m_numaReport = m_numaReport;
+	instance->m_outOfCoreFile = m_outOfCoreFile;
+	instance->m_camera = m_camera;
+	return instance;
+}
+
+std::unique_ptr<rayTracer> rayTracer::CreateReplica() const
+{
+	auto replica = CreateJobInstance();
+	replica->m_fileReader = m_fileReader->replicate();
+	replica->m_materials = m_materials->replicate();
+	replica->m_lights = std::make_shared<rtLightSet>(*m_lights);
+	replica->m_accelerator = CreateAccelerator(m_builtAcceleratorType, replica->m_fileReader->getFileInfo(), m_bvhBuild, 1);
+	replica->m_accelerator->build();
+	replica->m_builtAcceleratorType = m_builtAcceleratorType;
+	replica->PrepareFrame();
+	return replica;
+}
+
+const std::vector<std::vector<rtColor>>& rayTracer::GetPixels() const
+{
+	return m_pixels;
+}
+
+const rtCamera& rayTracer::GetCamera() const
+{
+	return m_camera;
+}
+
+void rayTracer::SetCamera(const rtCamera& camera)
+{
+	m_camera = camera;
+}
+
+rtVector2<int> rayTracer::GetImageSize()
+{
+	return m_frameSize;
+}
+
+std::string rayTracer::OutputFilePath(const std::string& outFolderName, const std::string& sceneFileName, const std::string& suffix)
+{
+	auto outFilePath = std::filesystem::path(sceneFileName);
+	return outFolderName + "\\" + outFilePath.stem().string() + suffix + ".ppm";
 }
\ No newline at end of file
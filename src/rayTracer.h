@@ -1,27 +1,157 @@
 #pragma once
 #include "ObjFileReader.h"
 #include <map>
+#include <atomic>
 #include "rtRay.h"
+#include "rtTile.h"
+#include "rtTraversalOrder.h"
+#include "rtCamera.h"
+#include "rtMaterialTable.h"
+#include "rtAccelerator.h"
+#include "rtArena.h"
+#include "rtCompactMesh.h"
+#include "rtLightSet.h"
+#include "rtInstructionSet.h"
+#include "rtNumaTopology.h"
+#include "rtQuality.h"
+#include "rtDependencyMap.h"
+
+// the reflection and transmission rays a shaded hit spawns and the weights of their colors
+struct rtSecondaryRays
+{
+	rtRay m_reflection;
+	double m_reflectance = 0.0;
+	// false on total internal reflection and for opaque materials
+	bool m_transmits = false;
+	rtRay m_transmission;
+	double m_transmittance = 0.0;
+	double m_transmissionEta = 1.0;   // etai of the transmitted ray
+};
 
 class rayTracer
 {
 public:
 	rayTracer() {}
 	bool Init(const std::string& fileName);
-	bool ReadTextureFiles(const std::string& textureDir);
+	// decoded holds textures loaded ahead, by file name, the others are read here
+	bool ReadTextureFiles(const std::string& textureDir, const rtDecodedTextures& decoded = {});
+	// the structure BuildAccelerationStructure builds, a binary BVH by default, and how its
+	// trees are split. with threads > 1 the upper subtrees are built concurrently
+	void SetAccelerator(eAcceleratorType type, eBVHBuild method = eBVHBuild::kMedian, int threads = 1);
+	void BuildAccelerationStructure();
+	// the structure the last BuildAccelerationStructure built, with kAuto resolved
+	eAcceleratorType AcceleratorType() const;
+	// milliseconds it spent building the structure, and its quality
+	double AcceleratorBuildTime() const;
+	double AcceleratorSahCost() const;
+	// many lights: lights whose attenuation leaves less than cutoff (0..1) of a material's response
+	// are culled by distance, and with shadowSamples > 0 a shading point casts at most that many
+	// shadow rays, picked in proportion to the unshadowed contribution. call before BuildAccelerationStructure
+	void SetLightSampling(double cutoff, int shadowSamples);
+	// coherent: trace each tile breadth first, sorting every depth's reflection and transmission
+	// rays by direction octant and origin before tracing them. the image doesn't change
+	void SetCoherentRays(bool coherent);
+	// instruction set of the shading and intersection kernels, the best the cpu supports by
+	// default. call before BuildAccelerationStructure, the structure keeps the set it was built with
+	void SetInstructionSet(eInstructionSet set);
+	eInstructionSet InstructionSet() const;
+	// how textures are read. nearest by default, the filtered modes pick a mip level from the ray cone's footprint
+	void SetTextureFilter(eTextureFilter filter);
+	// resolution, recursion depth, shadow rays and texture level, final quality by default.
+	// call before PrepareFrame, the image is traced at the scaled size and upscaled on output
+	void SetQuality(const rtQualitySettings& quality);
+	// thread placement of multi-threaded ComputePixelColor calls, off by default. report prints
+	// where every thread ran
+	void SetNumaPolicy(eNumaPolicy policy, bool report);
+	// order of the pixels inside each tile, column by column by default
+	void SetPixelOrder(eTraversalOrder order);
+	// progressive output: after every tileInterval finished tiles ComputePixelColor rewrites
+	// fileName with the tiles done so far, the others stay black. 0 turns it off
+	void SetProgressiveOutput(const std::string& fileName, int tileInterval);
+	// checkpointing: ComputePixelColor writes every finished tile to fileName (see rtCheckpoint)
+	// once intervalSeconds passed since the last write. an empty fileName turns it off
+	void SetCheckpoint(const std::string& fileName, double intervalSeconds, uint64_t fingerprint);
+	// restores the tiles the checkpoint holds and removes them from tiles, which then lists the
+	// ones still to render. false if there is no usable checkpoint, tiles is left unchanged
+	bool ResumeFromCheckpoint(std::vector<rtTile>& tiles);
+	// out of core: ComputePixelColor writes finished tiles straight into fileName, a binary
+	// ppm sized up front, and only the tiles being traced are held in memory. call before
+	// PrepareFrame, OutputFinalImage then has nothing left to write
+	void SetOutOfCore(const std::string& fileName);
+	// incremental re-renders: ComputePixelColor records per tile which materials its hits were
+	// shaded with, whether it shows background and which coarse cells of the scene its rays
+	// crossed (see rtDependencyMap)
+	void SetDependencyRecording(bool record);
+	// takes over previous's image and tile records. false unless previous recorded them for
+	// the same camera and image size
+	bool ReusePreviousFrame(const rayTracer& previous);
+	// the tiles edit can change since the recorded render, the others keep their pixels
+	std::vector<rtTile> TilesToUpdate(const std::vector<rtTile>& tiles, const rtSceneEdit& edit);
+	// hot reload: takes the camera, background, materials and lights of settings, a settings only
+	// parse of the scene file whose geometry didn't change, and reads the textures named in
+	// changedTextures again. geometry and the other textures stay as they are. what changed
+	// is added to edit, a new camera sets the frame up again. settings may be null
+	void ApplySceneSettings(const ObjFileInfo* settings, const std::vector<std::string>& changedTextures, rtSceneEdit& edit);
+	// primary and secondary rays traced by the last ComputePixelColor, shadow rays not included
+	uint64_t RaysTraced() const;
+	// replaces the full precision triangle arrays with rtCompactMesh encodings, call it before
+	// BuildAccelerationStructure. vertices can't be moved afterwards
+	bool CompactGeometry();
+	size_t GeometryByteSize() const;
+	int TriangleCount() const;
 	bool ComputeUV();
 	bool ComputeAspectRatioAndRenderPlane();
 	void InitPixelArray();
-	void CreatePixelIndexTo3DPointMap();
-	void CreatePixelIndexToRayMap();
+	// pixel spacing on the render plane, primary rays are made from it as they are traced
+	void ComputePixelGrid();
+	rtRay PrimaryRay(const rtVector2<int>& pixel) const;
 	void ComputePixelColor();
-	rtColor RecursiveTraceRay(const rtRay& incidence, int recusiveDepth, double etai, bool isSphere, int whichObj, double lastEta);
-	rtColor BlinnPhongShading(const rtMaterial& mtlColor, const rtPoint& intersection, int objIndex, const rtVector3& normal, bool isSphere, const rtPoint& newOrigin);
+	void ComputePixelColor(const std::vector<rtTile>& tiles, int threadCount);
+	void RenderTile(const rtTile& tile);
+	rtColor RecursiveTraceRay(const rtRay& incidence, int recusiveDepth, double etai, const rtPrimitiveRef& lastPrim, double lastEta);
+	// local color of a hit, secondary receives the rays to trace next
+	rtColor ShadeHit(const rtRay& incidence, const rtHitRecord& hitRecord, double etai, const rtPrimitiveRef& lastPrim, double lastEta, rtSecondaryRays& secondary);
+	// mip level to read for a texture hit at distance t along incidence, cosine between the ray and the normal
+	double TextureLod(const rtTexture& texture, const rtRay& incidence, double t, const rtPrimitiveRef& prim, double cosine) const;
+	rtColor BlinnPhongShading(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection, const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin);
 	void OutputFinalImage(const std::string& outFolderName);
+	bool OutputImage(const std::string& fileName);
+	bool OutputPartialImage(const std::string& fileName, const std::vector<rtTile>& tiles);
+	// crops: the pixels inside region as an image of their own, or the pixels of tiles written
+	// into an existing image of the full frame's size
+	bool OutputCroppedImage(const std::string& fileName, const rtTile& region);
+	bool OutputIntoImage(const std::string& fileName, const std::vector<rtTile>& tiles);
+
+	// runs every camera dependent setup step, from ComputeUV to ComputePixelGrid
+	bool PrepareFrame();
+	// new tracer sharing this one's parsed scene and textures
+	std::unique_ptr<rayTracer> CreateJobInstance() const;
+
+	// animation: move primitives, then update the acceleration structure once per frame.
+	// sphere and vertex indices are 0-based. UpdateAccelerationStructure refits in linear
+	// time and returns true if the refit tree got too poor and was rebuilt instead
+	bool SetSphereCenter(int sphereIndex, const rtPoint& center);
+	bool SetVertexPosition(int vertexIndex, const rtPoint& position);
+	bool UpdateAccelerationStructure();
+	// space the sphere, or the triangles sharing the vertex, take up now
+	rtAABB SphereBounds(int sphereIndex) const;
+	rtAABB VertexBounds(int vertexIndex) const;
+
+	const std::vector<std::vector<rtColor>>& GetPixels() const;
+	const rtCamera& GetCamera() const;
+	void SetCamera(const rtCamera& camera);
+	// pixels traced per frame, the camera's image size scaled by the quality's resolution
+	rtVector2<int> GetImageSize();
+
+	static std::string OutputFilePath(const std::string& outFolderName, const std::string& sceneFileName, const std::string& suffix = "");
 
 private:
 
-	std::unique_ptr<ObjFileReader> m_fileReader;
+	std::shared_ptr<ObjFileReader> m_fileReader;
+
+	rtCamera m_camera;
+	rtVector2<int> m_frameSize;
+	rtQualitySettings m_quality;
 
 	rtVector3 m_u;
 	rtVector3 m_v;
@@ -33,9 +163,56 @@ private:
 	rtPoint m_ll;
 	rtPoint m_lr;
 
-	std::map<rtVector2<int>, rtPoint> m_imgIndex2PointMap;
-	std::map<rtVector2<int>, rtRay> m_imgIndex2RayMap;
+	// one pixel across and down the render plane, and half of each
+	rtVector3 m_pixelStepH;
+	rtVector3 m_pixelStepV;
+	rtVector3 m_halfPixelH;
+	rtVector3 m_halfPixelV;
+	double m_pixelSpread = 0.0;
+
+	std::shared_ptr<const rtMaterialTable> m_materials;
+	std::string m_textureDir;
+	std::shared_ptr<rtAccelerator> m_accelerator;
+	eAcceleratorType m_acceleratorType = eAcceleratorType::kBVH2;
+	eAcceleratorType m_builtAcceleratorType = eAcceleratorType::kBVH2;
+	eBVHBuild m_bvhBuild = eBVHBuild::kMedian;
+	int m_bvhBuildThreads = 1;
+	double m_acceleratorBuildTime = 0.0;
+
+	void BuildLightStructure();
+	std::shared_ptr<const rtLightSet> m_lights;
+	double m_lightCutoff = 0.0;
+	int m_lightSamples = 0;
+
+	// the variants compile ComputeBlinnPhong for their instruction set
+	template <eInstructionSet Isa>
+	rtColor BlinnPhongShadingKernel(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection, const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin);
+	rtColor ComputeBlinnPhong(const rtMaterialRecord& material, const rtColor& ambient, const rtColor& diffuse, const rtPoint& intersection, const rtPrimitiveRef& prim, const rtVector3& normal, const rtPoint& newOrigin);
+	eInstructionSet m_isa = ActiveInstructionSet();
+
+	// tracer on a deep copy of the scene, material table, lights and a rebuilt acceleration
+	// structure, all allocated by the calling thread, with its own frame set up for m_camera
+	std::unique_ptr<rayTracer> CreateReplica() const;
+	eNumaPolicy m_numaPolicy = eNumaPolicy::kOff;
+	bool m_numaReport = false;
 
-	std::map<std::string, std::vector<rtColor>> m_textureData;
-	std::map<std::string, rtVector2<int>> m_textureSize;
+	void TraceTileCoherent(const rtTile& tile, const std::pmr::vector<rtVector2<int>>& pixels, const std::pmr::vector<rtRay>& rays, std::pmr::memory_resource* scratch);
+	// into the image, or the thread's tile buffer when rendering out of core
+	void StorePixel(const rtTile& tile, const rtVector2<int>& pixel, const rtColor& color);
+	rtColor DepthLimitColor(const rtPrimitiveRef& lastPrim) const;
+	// pixels, of m_frameSize, written at the camera's image size
+	bool WriteFullSizeImage(const std::string& fileName, const std::vector<std::vector<rtColor>>& pixels) const;
+	bool m_coherentRays = false;
+	eTraversalOrder m_pixelOrder = eTraversalOrder::kColumn;
+	eTextureFilter m_textureFilter = eTextureFilter::kNearest;
+	std::string m_checkpointFile;
+	double m_checkpointInterval = 0.0;
+	uint64_t m_checkpointFingerprint = 0;
+	std::vector<rtTile> m_checkpointTiles;   // finished, in m_pixels
+	std::string m_outOfCoreFile;
+	bool m_recordDependencies = false;
+	rtDependencyMap m_dependencies;
+	std::string m_progressiveFile;
+	int m_progressiveInterval = 0;
+	std::atomic<uint64_t> m_raysTraced{ 0 };
 };
\ No newline at end of file
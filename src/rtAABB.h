@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include "rtPoint.h"
+#include "rtRay.h"
+
+class rtAABB
+{
+public:
+	rtAABB()
+		: m_min(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()),
+		  m_max(-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()) {}
+	rtAABB(const rtPoint& _min, const rtPoint& _max)
+		: m_min(_min), m_max(_max) {}
+
+	void expand(const rtPoint& p)
+	{
+		m_min = rtPoint(std::min(m_min.m_x, p.m_x), std::min(m_min.m_y, p.m_y), std::min(m_min.m_z, p.m_z));
+		m_max = rtPoint(std::max(m_max.m_x, p.m_x), std::max(m_max.m_y, p.m_y), std::max(m_max.m_z, p.m_z));
+	}
+
+	void expand(const rtAABB& box)
+	{
+		expand(box.m_min);
+		expand(box.m_max);
+	}
+
+	bool contains(const rtPoint& p) const
+	{
+		return p.m_x >= m_min.m_x && p.m_x <= m_max.m_x && p.m_y >= m_min.m_y && p.m_y <= m_max.m_y && p.m_z >= m_min.m_z && p.m_z <= m_max.m_z;
+	}
+
+	rtAABB intersect(const rtAABB& box) const
+	{
+		return rtAABB(rtPoint(std::max(m_min.m_x, box.m_min.m_x), std::max(m_min.m_y, box.m_min.m_y), std::max(m_min.m_z, box.m_min.m_z)),
+			rtPoint(std::min(m_max.m_x, box.m_max.m_x), std::min(m_max.m_y, box.m_max.m_y), std::min(m_max.m_z, box.m_max.m_z)));
+	}
+
+	bool empty() const
+	{
+		return m_min.m_x > m_max.m_x || m_min.m_y > m_max.m_y || m_min.m_z > m_max.m_z;
+	}
+
+	rtPoint centroid() const
+	{
+		return rtPoint((m_min.m_x + m_max.m_x) * 0.5, (m_min.m_y + m_max.m_y) * 0.5, (m_min.m_z + m_max.m_z) * 0.5);
+	}
+
+	double extent(int axis) const
+	{
+		return axis == 0 ? m_max.m_x - m_min.m_x : (axis == 1 ? m_max.m_y - m_min.m_y : m_max.m_z - m_min.m_z);
+	}
+
+	int longestAxis() const
+	{
+		double x = extent(0), y = extent(1), z = extent(2);
+		return (x >= y && x >= z) ? 0 : (y >= z ? 1 : 2);
+	}
+
+	double surfaceArea() const
+	{
+		if (empty())
+		{
+			return 0.0;
+		}
+		double x = extent(0), y = extent(1), z = extent(2);
+		return 2.0 * (x * y + y * z + z * x);
+	}
+
+	rtPoint m_min;
+	rtPoint m_max;
+};
+
+inline double rtAxis(const rtPoint& p, int axis)
+{
+	return axis == 0 ? p.m_x : (axis == 1 ? p.m_y : p.m_z);
+}
+
+// slab test with the reciprocal direction computed once per ray
+class rtRayBoxTest
+{
+public:
+	rtRayBoxTest(const rtRay& ray)
+		: m_origin(ray.m_origin),
+		  m_invDir(1.0 / ray.m_direction.m_x, 1.0 / ray.m_direction.m_y, 1.0 / ray.m_direction.m_z) {}
+
+	bool hit(const rtAABB& box, double tMax, double& tEntry) const
+	{
+		double t0x = (box.m_min.m_x - m_origin.m_x) * m_invDir.m_x;
+		double t1x = (box.m_max.m_x - m_origin.m_x) * m_invDir.m_x;
+		double t0y = (box.m_min.m_y - m_origin.m_y) * m_invDir.m_y;
+		double t1y = (box.m_max.m_y - m_origin.m_y) * m_invDir.m_y;
+		double t0z = (box.m_min.m_z - m_origin.m_z) * m_invDir.m_z;
+		double t1z = (box.m_max.m_z - m_origin.m_z) * m_invDir.m_z;
+		double tNear = std::max(std::max(std::min(t0x, t1x), std::min(t0y, t1y)), std::max(std::min(t0z, t1z), 0.0));
+		double tFar = std::min(std::min(std::max(t0x, t1x), std::max(t0y, t1y)), std::min(std::max(t0z, t1z), tMax));
+		tEntry = tNear;
+		return tNear <= tFar;
+	}
+
+	rtPoint m_origin;
+	rtVector3 m_invDir;
+};
@@ -0,0 +1,83 @@
+#include "rtAccelerator.h"
+#include "rtBVHAccelerator.h"
+#include "rtGridAccelerator.h"
+
+static const char* const ACCELERATOR_NAMES[] = { "bvh2", "bvh4", "bvh8", "grid", "auto" };
+
+// a grid needs enough primitives to pay off its setup
+static constexpr size_t GRID_MIN_PRIMITIVES = 1024;
+// and the 95th percentile primitive no larger than this many typical ones
+static constexpr double GRID_MAX_SIZE_SPREAD = 4.0;
+
+bool ParseAcceleratorType(const std::string& name, eAcceleratorType& type)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(ACCELERATOR_NAMES) / sizeof(ACCELERATOR_NAMES[0])); i++)
+	{
+		if (name == ACCELERATOR_NAMES[i])
+		{
+			type = static_cast<eAcceleratorType>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* AcceleratorTypeName(eAcceleratorType type)
+{
+	return ACCELERATOR_NAMES[static_cast<int>(type)];
+}
+
+eAcceleratorType ChooseAcceleratorType(const ObjFileInfo& fileInfo)
+{
+	// instance boxes enclose whole meshes, their sizes say nothing about the scene's density
+	rtTriangleMeshView sceneMesh = TriangleMeshView(fileInfo);
+	size_t count = fileInfo.spheres.size() + sceneMesh.faceCount();
+	if (!fileInfo.instances.empty() || count < GRID_MIN_PRIMITIVES)
+	{
+		return eAcceleratorType::kBVH2;
+	}
+
+	std::vector<double> sizes;
+	sizes.reserve(count);
+	for (const rtSphere& sphere : fileInfo.spheres)
+	{
+		sizes.push_back(2.0 * sphere.m_radius);
+	}
+	for (int face = 0; face < sceneMesh.faceCount(); face++)
+	{
+		rtPoint p[3];
+		sceneMesh.positions(face, p);
+		rtAABB bounds;
+		for (int k = 0; k < 3; k++)
+		{
+			bounds.expand(p[k]);
+		}
+		sizes.push_back(std::max(bounds.extent(0), std::max(bounds.extent(1), bounds.extent(2))));
+	}
+
+	auto median = sizes.begin() + sizes.size() / 2;
+	std::nth_element(sizes.begin(), median, sizes.end());
+	double typical = *median;
+	auto large = sizes.begin() + sizes.size() * 95 / 100;
+	std::nth_element(sizes.begin(), large, sizes.end());
+	return *large <= GRID_MAX_SIZE_SPREAD * typical ? eAcceleratorType::kGrid : eAcceleratorType::kBVH2;
+}
+
+std::shared_ptr<rtAccelerator> CreateAccelerator(eAcceleratorType type, const std::shared_ptr<ObjFileInfo>& fileInfo, eBVHBuild method, int threads)
+{
+	if (type == eAcceleratorType::kAuto)
+	{
+		type = ChooseAcceleratorType(*fileInfo);
+	}
+	switch (type)
+	{
+	case eAcceleratorType::kBVH4:
+		return std::make_shared<rtBVHAccelerator>(fileInfo, 4, method, threads);
+	case eAcceleratorType::kBVH8:
+		return std::make_shared<rtBVHAccelerator>(fileInfo, 8, method, threads);
+	case eAcceleratorType::kGrid:
+		return std::make_shared<rtGridAccelerator>(fileInfo, method, threads);
+	default:
+		return std::make_shared<rtBVHAccelerator>(fileInfo, 2, method, threads);
+	}
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <limits>
+#include <memory>
+#include "ObjFileReader.h"
+#include "rtRay.h"
+#include "rtAABB.h"
+#include "rtBVH.h"
+
+// identifies a sphere, a triangle of the scene or a triangle of an instanced mesh
+struct rtPrimitiveRef
+{
+	rtPrimitiveRef() {}
+	rtPrimitiveRef(bool _isSphere, int _objIndex, int _instanceIndex = -1)
+		: m_isSphere(_isSphere), m_objIndex(_objIndex), m_instanceIndex(_instanceIndex) {}
+
+	bool operator == (const rtPrimitiveRef& p) const
+	{
+		return m_isSphere == p.m_isSphere && m_objIndex == p.m_objIndex && m_instanceIndex == p.m_instanceIndex;
+	}
+
+	bool m_isSphere = true;
+	int m_objIndex = -1;      // face index inside the mesh for instanced triangles
+	int m_instanceIndex = -1;
+};
+
+// the triangles of the scene or of one mesh, read from the full precision arrays or,
+// once the geometry is compacted, decoded from the compact encoding
+struct rtTriangleMeshView
+{
+	int faceCount() const
+	{
+		return compact ? compact->faceCount() : static_cast<int>(faces->size());
+	}
+
+	void positions(int face, rtPoint p[3]) const
+	{
+		if (compact)
+		{
+			compact->positions(face, p);
+			return;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			p[k] = (*verteices)[(*faces)[face][k][0] - 1];
+		}
+	}
+
+	// false if the face has no vertex normals, it is shaded flat
+	bool normals(int face, rtVector3 n[3]) const
+	{
+		if (compact)
+		{
+			return compact->normals(face, n);
+		}
+		if ((*faces)[face][0][2] == 0)
+		{
+			return false;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			n[k] = (*vertexNormals)[(*faces)[face][k][2] - 1];
+		}
+		return true;
+	}
+
+	void textureCoordinates(int face, rtVector2<double> uv[3]) const
+	{
+		if (compact)
+		{
+			compact->textureCoordinates(face, uv);
+			return;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			uv[k] = (*vertexTextureCoordinates)[(*faces)[face][k][1] - 1];
+		}
+	}
+
+	int materialIndex(int face) const
+	{
+		return compact ? compact->materialIndex(face) : (*faceMaterialIndexs)[face];
+	}
+
+	size_t byteSize() const
+	{
+		if (compact)
+		{
+			return compact->byteSize();
+		}
+		return verteices->size() * sizeof(rtPoint) + vertexNormals->size() * sizeof(rtVector3) + vertexTextureCoordinates->size() * sizeof(rtVector2<double>)
+			+ faces->size() * sizeof(rtFace) + faceMaterialIndexs->size() * sizeof(int);
+	}
+
+	const std::pmr::vector<rtPoint>* verteices;
+	const std::pmr::vector<rtVector3>* vertexNormals;
+	const std::pmr::vector<rtVector2<double>>* vertexTextureCoordinates;
+	const std::pmr::vector<rtFace>* faces;
+	const std::pmr::vector<int>* faceMaterialIndexs;
+	const rtCompactMesh* compact;
+};
+
+inline rtTriangleMeshView TriangleMeshView(const rtMesh& mesh)
+{
+	return { &mesh.verteices, &mesh.vertexNormals, &mesh.vertexTextureCoordinates, &mesh.faces, &mesh.faceMaterialIndexs, mesh.compact.get() };
+}
+
+// the scene's own triangles
+inline rtTriangleMeshView TriangleMeshView(const ObjFileInfo& fileInfo)
+{
+	return { &fileInfo.verteices, &fileInfo.vertexNormals, &fileInfo.vertexTextureCoordinates, &fileInfo.faces, &fileInfo.faceMaterialIndexs, fileInfo.compactFaces.get() };
+}
+
+inline rtTriangleMeshView TriangleMeshView(const ObjFileInfo& fileInfo, const rtPrimitiveRef& prim)
+{
+	if (prim.m_instanceIndex >= 0)
+	{
+		return TriangleMeshView(fileInfo.meshes[fileInfo.instances[prim.m_instanceIndex].meshIndex]);
+	}
+	return TriangleMeshView(fileInfo);
+}
+
+inline int PrimitiveMaterialIndex(const ObjFileInfo& fileInfo, const rtPrimitiveRef& prim)
+{
+	if (prim.m_isSphere)
+	{
+		return fileInfo.spheres[prim.m_objIndex].m_materialIndex;
+	}
+	if (prim.m_instanceIndex >= 0 && fileInfo.instances[prim.m_instanceIndex].materialIndex >= 0)
+	{
+		return fileInfo.instances[prim.m_instanceIndex].materialIndex;
+	}
+	return TriangleMeshView(fileInfo, prim).materialIndex(prim.m_objIndex);
+}
+
+struct rtHitRecord
+{
+	double m_t = std::numeric_limits<double>::infinity();
+	rtPrimitiveRef m_prim;
+
+	// barycentric coordinates of triangle hits
+	double m_alpha = 0.0;
+	double m_beta = 0.0;
+	double m_gamma = 0.0;
+};
+
+// ray queries against the spheres and triangles of a parsed scene
+class rtAccelerator
+{
+public:
+	rtAccelerator(const std::shared_ptr<ObjFileInfo>& fileInfo)
+		: m_fileInfo(fileInfo) {}
+	virtual ~rtAccelerator() {}
+
+	virtual void build() = 0;
+	// called after sphere centers or vertices moved, returns true if the structure had to be rebuilt
+	virtual bool update() = 0;
+
+	virtual bool closestHit(const rtRay& ray, rtHitRecord& hit) const = 0;
+	// product of (1 - alpha) of every primitive crossed in (0, maxT), ignoring the primitive the ray starts on
+	virtual double transmittance(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const = 0;
+	// box around every primitive, empty for an empty scene
+	virtual rtAABB bounds() const = 0;
+	// surface area heuristic cost of the top level structure, to compare build methods
+	virtual double sahCost() const = 0;
+
+protected:
+	std::shared_ptr<ObjFileInfo> m_fileInfo;
+};
+
+// kAuto picks kGrid or kBVH2 per scene with ChooseAcceleratorType
+enum class eAcceleratorType
+{
+	kBVH2,
+	kBVH4,
+	kBVH8,
+	kGrid,
+	kAuto,
+};
+
+bool ParseAcceleratorType(const std::string& name, eAcceleratorType& type);
+const char* AcceleratorTypeName(eAcceleratorType type);
+// the grid for many primitives of about the same size, whose cells each hold a few of them.
+// primitives much larger than the typical one would be listed in many cells, then a binary BVH
+eAcceleratorType ChooseAcceleratorType(const ObjFileInfo& fileInfo);
+// not built yet, call build(). trees are split by method, using up to threads threads
+std::shared_ptr<rtAccelerator> CreateAccelerator(eAcceleratorType type, const std::shared_ptr<ObjFileInfo>& fileInfo, eBVHBuild method = eBVHBuild::kMedian, int threads = 1);
@@ -0,0 +1,124 @@
+#include "rtAllocationCounter.h"
+
+#ifdef RT_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static std::atomic<size_t> g_tracingAllocations(0);
+static thread_local bool t_tracing = false;
+
+void* operator new(std::size_t size)
+{
+	if (t_tracing)
+	{
+		g_tracingAllocations++;
+	}
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+// std::pmr resources get their upstream blocks through the aligned forms
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (t_tracing)
+	{
+		g_tracingAllocations++;
+	}
+	size_t align = static_cast<size_t>(alignment);
+	size = (size + align - 1) / align * align;
+#ifdef _WIN32
+	void* p = _aligned_malloc(size ? size : align, align);
+#else
+	void* p = std::aligned_alloc(align, size ? size : align);
+#endif
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+bool rtAllocationCounter::enabled()
+{
+	return true;
+}
+
+void rtAllocationCounter::reset()
+{
+	g_tracingAllocations = 0;
+}
+
+size_t rtAllocationCounter::tracingAllocations()
+{
+	return g_tracingAllocations;
+}
+
+rtAllocationCounter::TracingScope::TracingScope()
+{
+	t_tracing = true;
+}
+
+rtAllocationCounter::TracingScope::~TracingScope()
+{
+	t_tracing = false;
+}
+
+#else
+
+bool rtAllocationCounter::enabled()
+{
+	return false;
+}
+
+void rtAllocationCounter::reset()
+{
+}
+
+size_t rtAllocationCounter::tracingAllocations()
+{
+	return 0;
+}
+
+rtAllocationCounter::TracingScope::TracingScope()
+{
+}
+
+rtAllocationCounter::TracingScope::~TracingScope()
+{
+}
+
+#endif
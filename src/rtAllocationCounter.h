@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+
+// counts heap allocations made by threads while they trace. the global operator new is only
+// replaced when built with RT_COUNT_ALLOCATIONS (cmake -DCPURAYTRACING_COUNT_ALLOCATIONS=ON),
+// otherwise every call here is a no-op and enabled() is false
+class rtAllocationCounter
+{
+public:
+	static bool enabled();
+	static void reset();
+	static size_t tracingAllocations();
+
+	// marks the calling thread as tracing for the scope's lifetime
+	class TracingScope
+	{
+	public:
+		TracingScope();
+		~TracingScope();
+	};
+};
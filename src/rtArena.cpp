@@ -0,0 +1,32 @@
+#include "rtArena.h"
+
+// large enough for the ray batches of a coherent 32x32 tile in refraction heavy scenes
+static constexpr size_t SCRATCH_BLOCK_SIZE = 1 << 21;
+
+rtArena::rtArena(size_t initialBlockSize)
+	: m_resource(initialBlockSize)
+{
+}
+
+void* rtArena::do_allocate(size_t bytes, size_t alignment)
+{
+	m_bytesAllocated += bytes;
+	return m_resource.allocate(bytes, alignment);
+}
+
+void rtArena::release()
+{
+	m_resource.release();
+	m_bytesAllocated = 0;
+}
+
+rtScratchArena::rtScratchArena(size_t blockSize)
+	: m_block(new std::byte[blockSize]), m_resource(m_block.get(), blockSize)
+{
+}
+
+rtScratchArena& rtScratchArena::forThisThread()
+{
+	thread_local rtScratchArena arena(SCRATCH_BLOCK_SIZE);
+	return arena;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <memory_resource>
+#include <memory>
+#include <cstddef>
+
+// monotonic arena for data that lives as long as the scene, nothing is freed
+// until the arena itself goes away, so loading costs a handful of large blocks
+class rtArena : public std::pmr::memory_resource
+{
+public:
+	explicit rtArena(size_t initialBlockSize = 1 << 16);
+	rtArena(const rtArena&) = delete;
+	rtArena& operator=(const rtArena&) = delete;
+
+	size_t bytesAllocated() const { return m_bytesAllocated; }
+	// everything allocated so far must be dead
+	void release();
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+	std::pmr::monotonic_buffer_resource m_resource;
+	size_t m_bytesAllocated = 0;
+};
+
+// per thread scratch memory for transient data of one tile, reset() hands everything back
+// at once. the first block is allocated up front so a steady state render never reaches malloc
+class rtScratchArena
+{
+public:
+	static rtScratchArena& forThisThread();
+
+	std::pmr::memory_resource* resource() { return &m_resource; }
+	void reset() { m_resource.release(); }
+
+private:
+	explicit rtScratchArena(size_t blockSize);
+
+	std::unique_ptr<std::byte[]> m_block;
+	std::pmr::monotonic_buffer_resource m_resource;
+};
@@ -0,0 +1,374 @@
+#include "rtBVH.h"
+#include "rtTraversalOrder.h"
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <limits>
+
+static constexpr int MAX_BVH_DEPTH = 60;
+static constexpr double SAH_TRAVERSAL_COST = 1.0;
+static constexpr double SAH_INTERSECTION_COST = 1.0;
+static constexpr int SAH_BIN_COUNT = 16;
+// below this many primitives a subtree is not worth a thread of its own
+static constexpr int PARALLEL_BUILD_MIN_PRIMS = 4096;
+
+static const char* const BUILD_NAMES[] = { "median", "sah", "lbvh" };
+
+bool ParseBVHBuild(const std::string& name, eBVHBuild& method)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(BUILD_NAMES) / sizeof(BUILD_NAMES[0])); i++)
+	{
+		if (name == BUILD_NAMES[i])
+		{
+			method = static_cast<eBVHBuild>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* BVHBuildName(eBVHBuild method)
+{
+	return BUILD_NAMES[static_cast<int>(method)];
+}
+
+// builds subtrees into node lists of their own, so the two halves of a split can be built on
+// different threads and appended to the parent's list afterwards. they partition disjoint
+// ranges of the shared primitive index list
+class rtBVHBuilder
+{
+public:
+	rtBVHBuilder(const std::vector<rtAABB>& primBounds, std::vector<int>& primIndices, int maxLeafSize, eBVHBuild method)
+		: m_primBounds(primBounds), m_primIndices(primIndices), m_maxLeafSize(maxLeafSize), m_method(method) {}
+
+	void prepare(int threads);
+	// returns the subtree root's index in nodes, spawnDepth more levels may split across threads
+	int build(std::vector<rtBVHNode>& nodes, int first, int count, int depth, int spawnDepth);
+
+private:
+	// reorders the range and returns the size of its left part, splitLBVH needs no bounds
+	int split(int first, int count, const rtAABB& bounds, const rtAABB& centroidBounds);
+	int splitMedian(int first, int count, int axis);
+	int splitSAH(int first, int count, const rtAABB& bounds, const rtAABB& centroidBounds);
+	int splitLBVH(int first, int count);
+	void sortByMortonCode(int threads);
+
+	const std::vector<rtAABB>& m_primBounds;
+	std::vector<int>& m_primIndices;
+	std::vector<rtPoint> m_centroids;
+	std::vector<uint32_t> m_mortonCodes;
+	int m_maxLeafSize;
+	eBVHBuild m_method;
+};
+
+void rtBVHBuilder::prepare(int threads)
+{
+	m_centroids.resize(m_primBounds.size());
+	for (size_t i = 0; i < m_primBounds.size(); i++)
+	{
+		m_primIndices[i] = static_cast<int>(i);
+		m_centroids[i] = m_primBounds[i].centroid();
+	}
+	if (m_method != eBVHBuild::kLBVH)
+	{
+		return;
+	}
+
+	rtAABB centroidBounds;
+	for (const rtPoint& c : m_centroids)
+	{
+		centroidBounds.expand(c);
+	}
+	m_mortonCodes.resize(m_centroids.size());
+	for (size_t i = 0; i < m_centroids.size(); i++)
+	{
+		uint32_t code = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double extent = centroidBounds.extent(axis);
+			double t = extent > 0.0 ? (rtAxis(m_centroids[i], axis) - rtAxis(centroidBounds.m_min, axis)) / extent : 0.0;
+			code |= SpreadBitsBy3(static_cast<uint32_t>(std::min(std::max(t, 0.0), 1.0) * 1023.0)) << (2 - axis);
+		}
+		m_mortonCodes[i] = code;
+	}
+	sortByMortonCode(threads);
+}
+
+void rtBVHBuilder::sortByMortonCode(int threads)
+{
+	// ties keep the input order, so the tree does not depend on the thread count
+	auto byCode = [this](int a, int b) { return m_mortonCodes[a] < m_mortonCodes[b] || (m_mortonCodes[a] == m_mortonCodes[b] && a < b); };
+	int count = static_cast<int>(m_primIndices.size());
+	int chunks = std::max(1, std::min(threads, count / PARALLEL_BUILD_MIN_PRIMS));
+
+	// sort equal chunks concurrently, then merge neighbors pairwise
+	std::vector<int> bounds(chunks + 1);
+	for (int c = 0; c <= chunks; c++)
+	{
+		bounds[c] = static_cast<int>(static_cast<int64_t>(count) * c / chunks);
+	}
+	std::vector<std::future<void>> sorts;
+	for (int c = 1; c < chunks; c++)
+	{
+		sorts.push_back(std::async(std::launch::async, [&, c]() { std::sort(m_primIndices.begin() + bounds[c], m_primIndices.begin() + bounds[c + 1], byCode); }));
+	}
+	std::sort(m_primIndices.begin(), m_primIndices.begin() + bounds[1], byCode);
+	for (std::future<void>& sort : sorts)
+	{
+		sort.get();
+	}
+	for (int width = 1; width < chunks; width *= 2)
+	{
+		for (int c = 0; c + width < chunks; c += 2 * width)
+		{
+			std::inplace_merge(m_primIndices.begin() + bounds[c], m_primIndices.begin() + bounds[c + width],
+				m_primIndices.begin() + bounds[std::min(c + 2 * width, chunks)], byCode);
+		}
+	}
+}
+
+int rtBVHBuilder::build(std::vector<rtBVHNode>& nodes, int first, int count, int depth, int spawnDepth)
+{
+	int nodeIndex = static_cast<int>(nodes.size());
+	nodes.push_back(rtBVHNode());
+
+	int leftCount = 0;
+	if (m_method == eBVHBuild::kLBVH)
+	{
+		// splits only need the codes, the bounds are refit bottom-up once the tree is done
+		if (count > m_maxLeafSize && depth < MAX_BVH_DEPTH)
+		{
+			leftCount = splitLBVH(first, count);
+		}
+	}
+	else
+	{
+		rtAABB bounds;
+		rtAABB centroidBounds;
+		for (int i = first; i < first + count; i++)
+		{
+			bounds.expand(m_primBounds[m_primIndices[i]]);
+			centroidBounds.expand(m_centroids[m_primIndices[i]]);
+		}
+		nodes[nodeIndex].m_bounds = bounds;
+		if (count > m_maxLeafSize && depth < MAX_BVH_DEPTH && centroidBounds.extent(centroidBounds.longestAxis()) > 0.0)
+		{
+			leftCount = split(first, count, bounds, centroidBounds);
+		}
+	}
+	if (leftCount == 0)
+	{
+		nodes[nodeIndex].m_firstPrim = first;
+		nodes[nodeIndex].m_primCount = count;
+		return nodeIndex;
+	}
+
+	int rightChild;
+	if (spawnDepth > 0 && count >= PARALLEL_BUILD_MIN_PRIMS)
+	{
+		std::vector<rtBVHNode> leftNodes;
+		std::vector<rtBVHNode> rightNodes;
+		std::future<int> left = std::async(std::launch::async, [&]() { return build(leftNodes, first, leftCount, depth + 1, spawnDepth - 1); });
+		build(rightNodes, first + leftCount, count - leftCount, depth + 1, spawnDepth - 1);
+		left.get();
+
+		// child links are relative to the subtree's own list
+		for (const std::vector<rtBVHNode>* subtree : { &leftNodes, &rightNodes })
+		{
+			int offset = static_cast<int>(nodes.size());
+			for (rtBVHNode node : *subtree)
+			{
+				if (node.m_primCount == 0)
+				{
+					node.m_rightChild += offset;
+				}
+				nodes.push_back(node);
+			}
+		}
+		rightChild = nodeIndex + 1 + static_cast<int>(leftNodes.size());
+	}
+	else
+	{
+		build(nodes, first, leftCount, depth + 1, spawnDepth);
+		rightChild = build(nodes, first + leftCount, count - leftCount, depth + 1, spawnDepth);
+	}
+	nodes[nodeIndex].m_rightChild = rightChild;
+	return nodeIndex;
+}
+
+int rtBVHBuilder::split(int first, int count, const rtAABB& bounds, const rtAABB& centroidBounds)
+{
+	int leftCount = m_method == eBVHBuild::kSAH ? splitSAH(first, count, bounds, centroidBounds) : 0;
+	// the median split always makes progress
+	return leftCount > 0 && leftCount < count ? leftCount : splitMedian(first, count, centroidBounds.longestAxis());
+}
+
+int rtBVHBuilder::splitMedian(int first, int count, int axis)
+{
+	int half = count / 2;
+	std::nth_element(m_primIndices.begin() + first, m_primIndices.begin() + first + half, m_primIndices.begin() + first + count,
+		[this, axis](int a, int b) { return rtAxis(m_centroids[a], axis) < rtAxis(m_centroids[b], axis); });
+	return half;
+}
+
+int rtBVHBuilder::splitSAH(int first, int count, const rtAABB& bounds, const rtAABB& centroidBounds)
+{
+	struct rtBin
+	{
+		rtAABB m_bounds;
+		int m_count = 0;
+	};
+
+	double bestCost = std::numeric_limits<double>::infinity();
+	int bestAxis = -1;
+	int bestBin = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double extent = centroidBounds.extent(axis);
+		if (extent <= 0.0)
+		{
+			continue;
+		}
+		double origin = rtAxis(centroidBounds.m_min, axis);
+		double scale = SAH_BIN_COUNT / extent;
+
+		rtBin bins[SAH_BIN_COUNT];
+		for (int i = first; i < first + count; i++)
+		{
+			int prim = m_primIndices[i];
+			int bin = std::min(SAH_BIN_COUNT - 1, static_cast<int>((rtAxis(m_centroids[prim], axis) - origin) * scale));
+			bins[bin].m_bounds.expand(m_primBounds[prim]);
+			bins[bin].m_count++;
+		}
+
+		// sweep from the right, then from the left scoring the plane after every bin
+		double rightCost[SAH_BIN_COUNT];
+		rtAABB right;
+		int rightCount = 0;
+		for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--)
+		{
+			right.expand(bins[bin].m_bounds);
+			rightCount += bins[bin].m_count;
+			rightCost[bin] = rightCount > 0 ? right.surfaceArea() * rightCount : 0.0;
+		}
+		rtAABB left;
+		int leftCount = 0;
+		for (int bin = 0; bin < SAH_BIN_COUNT - 1; bin++)
+		{
+			left.expand(bins[bin].m_bounds);
+			leftCount += bins[bin].m_count;
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+			double cost = left.surfaceArea() * leftCount + rightCost[bin + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	double area = bounds.surfaceArea();
+	if (bestAxis < 0 || area <= 0.0)
+	{
+		return 0;
+	}
+	double origin = rtAxis(centroidBounds.m_min, bestAxis);
+	double scale = SAH_BIN_COUNT / centroidBounds.extent(bestAxis);
+	auto middle = std::partition(m_primIndices.begin() + first, m_primIndices.begin() + first + count,
+		[&](int prim) { return std::min(SAH_BIN_COUNT - 1, static_cast<int>((rtAxis(m_centroids[prim], bestAxis) - origin) * scale)) <= bestBin; });
+	return static_cast<int>(middle - (m_primIndices.begin() + first));
+}
+
+int rtBVHBuilder::splitLBVH(int first, int count)
+{
+	// the range is sorted by code, split before the first code with the highest differing bit set
+	uint32_t firstCode = m_mortonCodes[m_primIndices[first]];
+	uint32_t lastCode = m_mortonCodes[m_primIndices[first + count - 1]];
+	if (firstCode == lastCode)
+	{
+		return count / 2;
+	}
+	int bit = 31;
+	while (((firstCode ^ lastCode) & (1u << bit)) == 0)
+	{
+		bit--;
+	}
+	auto middle = std::partition_point(m_primIndices.begin() + first, m_primIndices.begin() + first + count,
+		[this, bit](int prim) { return (m_mortonCodes[prim] & (1u << bit)) == 0; });
+	return static_cast<int>(middle - (m_primIndices.begin() + first));
+}
+
+void rtBVH::build(const std::vector<rtAABB>& primBounds, int maxLeafSize, eBVHBuild method, int threads)
+{
+	m_nodes.clear();
+	m_primIndices.resize(primBounds.size());
+	if (primBounds.empty())
+	{
+		return;
+	}
+
+	rtBVHBuilder builder(primBounds, m_primIndices, std::max(maxLeafSize, 1), method);
+	builder.prepare(threads);
+
+	// enough levels of concurrent halves to give every thread a subtree
+	int spawnDepth = 0;
+	while ((1 << spawnDepth) < threads)
+	{
+		spawnDepth++;
+	}
+	m_nodes.reserve(2 * primBounds.size() / std::max(maxLeafSize, 1) + 1);
+	builder.build(m_nodes, 0, static_cast<int>(primBounds.size()), 0, spawnDepth);
+	if (method == eBVHBuild::kLBVH)
+	{
+		refit(primBounds);
+	}
+}
+
+void rtBVH::refit(const std::vector<rtAABB>& primBounds)
+{
+	// children are stored after their parent, a reverse sweep sees them first
+	for (int nodeIndex = static_cast<int>(m_nodes.size()) - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		rtBVHNode& node = m_nodes[nodeIndex];
+		rtAABB bounds;
+		if (node.m_primCount > 0)
+		{
+			for (int i = node.m_firstPrim; i < node.m_firstPrim + node.m_primCount; i++)
+			{
+				bounds.expand(primBounds[m_primIndices[i]]);
+			}
+		}
+		else
+		{
+			bounds = m_nodes[nodeIndex + 1].m_bounds;
+			bounds.expand(m_nodes[node.m_rightChild].m_bounds);
+		}
+		node.m_bounds = bounds;
+	}
+}
+
+double rtBVH::sahCost() const
+{
+	if (m_nodes.empty())
+	{
+		return 0.0;
+	}
+
+	double rootArea = m_nodes[0].m_bounds.surfaceArea();
+	if (rootArea <= 0.0)
+	{
+		return 0.0;
+	}
+
+	double cost = 0.0;
+	for (const rtBVHNode& node : m_nodes)
+	{
+		double probability = node.m_bounds.surfaceArea() / rootArea;
+		cost += probability * (node.m_primCount > 0 ? SAH_INTERSECTION_COST * node.m_primCount : SAH_TRAVERSAL_COST);
+	}
+	return cost;
+}
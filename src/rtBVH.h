@@ -0,0 +1,167 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rtAABB.h"
+
+// how rtBVH::build splits nodes. median halves the widest centroid axis, sah picks the cheapest
+// of binned candidate planes by surface area heuristic, lbvh sorts the primitives along a
+// Morton curve and splits where the codes first differ: the fastest build and the loosest tree
+enum class eBVHBuild
+{
+	kMedian,
+	kSAH,
+	kLBVH,
+};
+
+bool ParseBVHBuild(const std::string& name, eBVHBuild& method);
+const char* BVHBuildName(eBVHBuild method);
+
+struct rtBVHNode
+{
+	rtAABB m_bounds;
+	int m_rightChild = -1; // interior nodes, the left child always follows its parent
+	int m_firstPrim = 0;
+	int m_primCount = 0;   // 0 for interior nodes
+};
+
+// binary bounding volume hierarchy over an indexed list of primitive bounds.
+// nodes are stored depth first, so children always come after their parent
+class rtBVH
+{
+public:
+	// with several threads the two halves of the upper splits are built concurrently
+	void build(const std::vector<rtAABB>& primBounds, int maxLeafSize = 4, eBVHBuild method = eBVHBuild::kMedian, int threads = 1);
+	// recomputes every node's bounds bottom-up from moved primitives, keeps the topology
+	void refit(const std::vector<rtAABB>& primBounds);
+	// surface area heuristic cost of the tree, used to judge the quality after refits
+	double sahCost() const;
+
+	bool empty() const { return m_nodes.empty(); }
+	const rtAABB& bounds() const { return m_nodes[0].m_bounds; }
+	const std::vector<rtBVHNode>& getNodes() const { return m_nodes; }
+	const std::vector<int>& getPrimIndices() const { return m_primIndices; }
+
+	// calls visitor(primIndex, tMax) for the primitives of every leaf the ray reaches before tMax,
+	// nearer subtrees first. the visitor may shrink tMax, returning false ends the traversal
+	template <typename Visitor>
+	void traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const;
+
+	// calls visitor(primIndex) for the primitives of every leaf whose bounds contain p
+	template <typename Visitor>
+	void query(const rtPoint& p, Visitor&& visitor) const;
+
+private:
+	std::vector<rtBVHNode> m_nodes;
+	std::vector<int> m_primIndices;
+};
+
+template <typename Visitor>
+void rtBVH::traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const
+{
+	static constexpr int kStackSize = 64;
+
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	rtRayBoxTest boxTest(ray);
+	double tEntry;
+	if (!boxTest.hit(m_nodes[0].m_bounds, tMax, tEntry))
+	{
+		return;
+	}
+
+	int stack[kStackSize];
+	double stackEntry[kStackSize];
+	int stackSize = 0;
+	int nodeIndex = 0;
+
+	while (true)
+	{
+		const rtBVHNode& node = m_nodes[nodeIndex];
+		if (node.m_primCount > 0)
+		{
+			for (int i = 0; i < node.m_primCount; i++)
+			{
+				if (!visitor(m_primIndices[node.m_firstPrim + i], tMax))
+				{
+					return;
+				}
+			}
+		}
+		else
+		{
+			int nearChild = nodeIndex + 1;
+			int farChild = node.m_rightChild;
+			double tNear, tFar;
+			bool hitNear = boxTest.hit(m_nodes[nearChild].m_bounds, tMax, tNear);
+			bool hitFar = boxTest.hit(m_nodes[farChild].m_bounds, tMax, tFar);
+			if (hitNear && hitFar)
+			{
+				if (tFar < tNear)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(tNear, tFar);
+				}
+				stack[stackSize] = farChild;
+				stackEntry[stackSize] = tFar;
+				stackSize++;
+				nodeIndex = nearChild;
+				continue;
+			}
+			if (hitNear || hitFar)
+			{
+				nodeIndex = hitNear ? nearChild : farChild;
+				continue;
+			}
+		}
+
+		// skip subtrees that start behind a hit found meanwhile
+		do
+		{
+			if (stackSize == 0)
+			{
+				return;
+			}
+			stackSize--;
+		} while (stackEntry[stackSize] > tMax);
+		nodeIndex = stack[stackSize];
+	}
+}
+
+template <typename Visitor>
+void rtBVH::query(const rtPoint& p, Visitor&& visitor) const
+{
+	static constexpr int kStackSize = 64;
+
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	int stack[kStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		int nodeIndex = stack[--stackSize];
+		const rtBVHNode& node = m_nodes[nodeIndex];
+		if (!node.m_bounds.contains(p))
+		{
+			continue;
+		}
+		if (node.m_primCount > 0)
+		{
+			for (int i = 0; i < node.m_primCount; i++)
+			{
+				visitor(m_primIndices[node.m_firstPrim + i]);
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.m_rightChild;
+			stack[stackSize++] = nodeIndex + 1;
+		}
+	}
+}
@@ -0,0 +1,402 @@
+#include "rtBVHAccelerator.h"
+#include "rtIntersect.h"
+#include "rtGrid.h"
+
+// refitting stretches boxes, past this cost ratio a full rebuild pays off
+static constexpr double REBUILD_SAH_RATIO = 1.5;
+
+static rtAABB TriangleBounds(const rtTriangleMeshView& mesh, int face)
+{
+	rtPoint p[3];
+	mesh.positions(face, p);
+	rtAABB bounds;
+	for (int k = 0; k < 3; k++)
+	{
+		bounds.expand(p[k]);
+	}
+	return bounds;
+}
+
+static void PadBounds(std::vector<rtAABB>& primBounds)
+{
+	// pad flat boxes so axis aligned triangles are not lost to rounding in the slab test
+	for (rtAABB& bounds : primBounds)
+	{
+		double pad = EPSILON * (1.0 + std::max(bounds.extent(0), std::max(bounds.extent(1), bounds.extent(2))));
+		rtVector3 padding(pad, pad, pad);
+		bounds = rtAABB(rtPoint::add(bounds.m_min, padding.scale(-1.0)), rtPoint::add(bounds.m_max, padding));
+	}
+}
+
+static rtRay ToMeshSpace(const rtRay& ray, const rtInstance& instance)
+{
+	// the direction is not renormalised so hit distances stay comparable with world space
+	rtRay local;
+	local.m_origin = instance.inverse.transformPoint(ray.m_origin);
+	local.m_direction = instance.inverse.transformVector(ray.m_direction);
+	return local;
+}
+
+// binary trees and grids test their nodes one at a time, only wide trees have vector paths
+template <eInstructionSet Isa, typename Tree, typename Visitor>
+static void Traverse(const Tree& tree, const rtRay& ray, double& tMax, Visitor&& visitor)
+{
+	tree.traverse(ray, tMax, std::forward<Visitor>(visitor));
+}
+
+template <eInstructionSet Isa, int N, typename Visitor>
+static void Traverse(const rtWideBVH<N>& tree, const rtRay& ray, double& tMax, Visitor&& visitor)
+{
+	tree.template traverse<Isa>(ray, tMax, std::forward<Visitor>(visitor));
+}
+
+void rtBVHAccelerator::computePrimBounds(std::vector<rtAABB>& primBounds) const
+{
+	const ObjFileInfo& fileInfo = *m_fileInfo;
+	rtTriangleMeshView sceneMesh = TriangleMeshView(fileInfo);
+	size_t faceCount = sceneMesh.faceCount();
+	primBounds.resize(fileInfo.spheres.size() + faceCount + fileInfo.instances.size());
+	for (size_t i = 0; i < fileInfo.spheres.size(); i++)
+	{
+		const rtSphere& sphere = fileInfo.spheres[i];
+		rtVector3 r(sphere.m_radius, sphere.m_radius, sphere.m_radius);
+		primBounds[i] = rtAABB(rtPoint::add(sphere.m_center, r.scale(-1.0)), rtPoint::add(sphere.m_center, r));
+	}
+	for (size_t i = 0; i < faceCount; i++)
+	{
+		primBounds[fileInfo.spheres.size() + i] = TriangleBounds(sceneMesh, static_cast<int>(i));
+	}
+	for (size_t i = 0; i < fileInfo.instances.size(); i++)
+	{
+		const rtInstance& instance = fileInfo.instances[i];
+		const rtBVH& meshBVH = m_meshBVHs[instance.meshIndex];
+		rtAABB bounds;
+		if (!meshBVH.empty())
+		{
+			const rtAABB& local = meshBVH.bounds();
+			for (int corner = 0; corner < 8; corner++)
+			{
+				rtPoint p((corner & 1) ? local.m_max.m_x : local.m_min.m_x, (corner & 2) ? local.m_max.m_y : local.m_min.m_y, (corner & 4) ? local.m_max.m_z : local.m_min.m_z);
+				bounds.expand(instance.transform.transformPoint(p));
+			}
+		}
+		primBounds[fileInfo.spheres.size() + faceCount + i] = bounds;
+	}
+	PadBounds(primBounds);
+}
+
+void rtBVHAccelerator::buildMeshes()
+{
+	m_meshBVHs.resize(m_fileInfo->meshes.size());
+	for (size_t m = 0; m < m_fileInfo->meshes.size(); m++)
+	{
+		rtTriangleMeshView mesh = TriangleMeshView(m_fileInfo->meshes[m]);
+		std::vector<rtAABB> primBounds(mesh.faceCount());
+		for (int i = 0; i < mesh.faceCount(); i++)
+		{
+			primBounds[i] = TriangleBounds(mesh, i);
+		}
+		PadBounds(primBounds);
+		m_meshBVHs[m].build(primBounds, 4, m_method, m_threads);
+	}
+}
+
+void rtBVHAccelerator::build()
+{
+	m_isa = ActiveInstructionSet();
+	buildMeshes();
+	std::vector<rtAABB> primBounds;
+	computePrimBounds(primBounds);
+	m_sphereCount = static_cast<int>(m_fileInfo->spheres.size());
+	m_triangleCount = TriangleMeshView(*m_fileInfo).faceCount();
+	m_bvh.build(primBounds, 4, m_method, m_threads);
+	m_builtSahCost = m_bvh.sahCost();
+	buildWide();
+}
+
+void rtBVHAccelerator::buildWide()
+{
+	if (m_width == 4)
+	{
+		m_bvh4.build(m_bvh);
+		m_meshBVH4s.resize(m_meshBVHs.size());
+		for (size_t m = 0; m < m_meshBVHs.size(); m++)
+		{
+			m_meshBVH4s[m].build(m_meshBVHs[m]);
+		}
+	}
+	else if (m_width == 8)
+	{
+		m_bvh8.build(m_bvh);
+		m_meshBVH8s.resize(m_meshBVHs.size());
+		for (size_t m = 0; m < m_meshBVHs.size(); m++)
+		{
+			m_meshBVH8s[m].build(m_meshBVHs[m]);
+		}
+	}
+}
+
+bool rtBVHAccelerator::update()
+{
+	std::vector<rtAABB> primBounds;
+	computePrimBounds(primBounds);
+	if (primBounds.size() != m_bvh.getPrimIndices().size())
+	{
+		build();
+		return true;
+	}
+
+	m_bvh.refit(primBounds);
+	bool rebuilt = m_bvh.sahCost() > m_builtSahCost * REBUILD_SAH_RATIO;
+	if (rebuilt)
+	{
+		m_bvh.build(primBounds, 4, m_method, m_threads);
+		m_builtSahCost = m_bvh.sahCost();
+	}
+	// collapsing is linear too, the wide trees are redone from the refit binary ones
+	buildWide();
+	return rebuilt;
+}
+
+rtAABB rtBVHAccelerator::bounds() const
+{
+	return m_bvh.empty() ? rtAABB() : m_bvh.bounds();
+}
+
+double rtBVHAccelerator::sahCost() const
+{
+	return m_bvh.sahCost();
+}
+
+// the variants share one body, the target attributes recompile it with everything it calls
+// inlined for their instruction set
+template <>
+bool rtBVHAccelerator::closestHitKernel<eInstructionSet::kGeneric>(const rtRay& ray, rtHitRecord& hit) const
+{
+	return closestHitTop<eInstructionSet::kGeneric>(ray, hit);
+}
+
+template <>
+RT_TARGET_SSE4 bool rtBVHAccelerator::closestHitKernel<eInstructionSet::kSSE4>(const rtRay& ray, rtHitRecord& hit) const
+{
+	return closestHitTop<eInstructionSet::kSSE4>(ray, hit);
+}
+
+template <>
+RT_TARGET_AVX2 bool rtBVHAccelerator::closestHitKernel<eInstructionSet::kAVX2>(const rtRay& ray, rtHitRecord& hit) const
+{
+	return closestHitTop<eInstructionSet::kAVX2>(ray, hit);
+}
+
+template <>
+RT_TARGET_AVX512 bool rtBVHAccelerator::closestHitKernel<eInstructionSet::kAVX512>(const rtRay& ray, rtHitRecord& hit) const
+{
+	return closestHitTop<eInstructionSet::kAVX512>(ray, hit);
+}
+
+template <>
+double rtBVHAccelerator::transmittanceKernel<eInstructionSet::kGeneric>(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	return transmittanceTop<eInstructionSet::kGeneric>(ray, maxT, skip);
+}
+
+template <>
+RT_TARGET_SSE4 double rtBVHAccelerator::transmittanceKernel<eInstructionSet::kSSE4>(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	return transmittanceTop<eInstructionSet::kSSE4>(ray, maxT, skip);
+}
+
+template <>
+RT_TARGET_AVX2 double rtBVHAccelerator::transmittanceKernel<eInstructionSet::kAVX2>(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	return transmittanceTop<eInstructionSet::kAVX2>(ray, maxT, skip);
+}
+
+template <>
+RT_TARGET_AVX512 double rtBVHAccelerator::transmittanceKernel<eInstructionSet::kAVX512>(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	return transmittanceTop<eInstructionSet::kAVX512>(ray, maxT, skip);
+}
+
+bool rtBVHAccelerator::closestHit(const rtRay& ray, rtHitRecord& hit) const
+{
+	switch (m_isa)
+	{
+	case eInstructionSet::kSSE4:
+		return closestHitKernel<eInstructionSet::kSSE4>(ray, hit);
+	case eInstructionSet::kAVX2:
+		return closestHitKernel<eInstructionSet::kAVX2>(ray, hit);
+	case eInstructionSet::kAVX512:
+		return closestHitKernel<eInstructionSet::kAVX512>(ray, hit);
+	default:
+		return closestHitKernel<eInstructionSet::kGeneric>(ray, hit);
+	}
+}
+
+double rtBVHAccelerator::transmittance(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	switch (m_isa)
+	{
+	case eInstructionSet::kSSE4:
+		return transmittanceKernel<eInstructionSet::kSSE4>(ray, maxT, skip);
+	case eInstructionSet::kAVX2:
+		return transmittanceKernel<eInstructionSet::kAVX2>(ray, maxT, skip);
+	case eInstructionSet::kAVX512:
+		return transmittanceKernel<eInstructionSet::kAVX512>(ray, maxT, skip);
+	default:
+		return transmittanceKernel<eInstructionSet::kGeneric>(ray, maxT, skip);
+	}
+}
+
+template <eInstructionSet Isa>
+bool rtBVHAccelerator::closestHitTop(const rtRay& ray, rtHitRecord& hit) const
+{
+	if (m_grid)
+	{
+		return closestHitIn<Isa>(*m_grid, m_meshBVHs, ray, hit);
+	}
+	if (m_width == 4)
+	{
+		return closestHitIn<Isa>(m_bvh4, m_meshBVH4s, ray, hit);
+	}
+	if (m_width == 8)
+	{
+		return closestHitIn<Isa>(m_bvh8, m_meshBVH8s, ray, hit);
+	}
+	return closestHitIn<Isa>(m_bvh, m_meshBVHs, ray, hit);
+}
+
+template <eInstructionSet Isa>
+double rtBVHAccelerator::transmittanceTop(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	if (m_grid)
+	{
+		return transmittanceIn<Isa>(*m_grid, m_meshBVHs, ray, maxT, skip);
+	}
+	if (m_width == 4)
+	{
+		return transmittanceIn<Isa>(m_bvh4, m_meshBVH4s, ray, maxT, skip);
+	}
+	if (m_width == 8)
+	{
+		return transmittanceIn<Isa>(m_bvh8, m_meshBVH8s, ray, maxT, skip);
+	}
+	return transmittanceIn<Isa>(m_bvh, m_meshBVHs, ray, maxT, skip);
+}
+
+template <eInstructionSet Isa, typename Top, typename Mesh>
+bool rtBVHAccelerator::closestHitIn(const Top& top, const std::vector<Mesh>& meshes, const rtRay& ray, rtHitRecord& hit) const
+{
+	const ObjFileInfo& fileInfo = *m_fileInfo;
+
+	rtTriangleMeshView sceneMesh = TriangleMeshView(fileInfo);
+
+	auto intersectTriangle = [&](const rtTriangleMeshView& mesh, int face, const rtRay& triRay, double& tClosest, const rtPrimitiveRef& prim)
+	{
+		double t, alpha, beta, gamma;
+		rtVector3 normal;
+		rtPoint p[3];
+		mesh.positions(face, p);
+		if (IntersectTriangle(p[0], p[1], p[2], triRay, tClosest, t, alpha, beta, gamma, normal))
+		{
+			tClosest = t;
+			hit.m_prim = prim;
+			hit.m_alpha = alpha;
+			hit.m_beta = beta;
+			hit.m_gamma = gamma;
+		}
+	};
+
+	double tMax = std::numeric_limits<double>::infinity();
+	Traverse<Isa>(top, ray, tMax, [&](int primIndex, double& tClosest)
+	{
+		if (primIndex < m_sphereCount)
+		{
+			double t;
+			if (IntersectSphere(fileInfo.spheres[primIndex], ray, tClosest, t))
+			{
+				tClosest = t;
+				hit.m_prim = rtPrimitiveRef(true, primIndex);
+			}
+		}
+		else if (primIndex < m_sphereCount + m_triangleCount)
+		{
+			int triIndex = primIndex - m_sphereCount;
+			intersectTriangle(sceneMesh, triIndex, ray, tClosest, rtPrimitiveRef(false, triIndex));
+		}
+		else
+		{
+			int instanceIndex = primIndex - m_sphereCount - m_triangleCount;
+			const rtInstance& instance = fileInfo.instances[instanceIndex];
+			rtTriangleMeshView mesh = TriangleMeshView(fileInfo.meshes[instance.meshIndex]);
+			rtRay local = ToMeshSpace(ray, instance);
+			Traverse<Isa>(meshes[instance.meshIndex], local, tClosest, [&](int triIndex, double& tLocal)
+			{
+				intersectTriangle(mesh, triIndex, local, tLocal, rtPrimitiveRef(false, triIndex, instanceIndex));
+				return true;
+			});
+		}
+		return true;
+	});
+	hit.m_t = tMax;
+	return hit.m_prim.m_objIndex != -1;
+}
+
+template <eInstructionSet Isa, typename Top, typename Mesh>
+double rtBVHAccelerator::transmittanceIn(const Top& top, const std::vector<Mesh>& meshes, const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const
+{
+	const ObjFileInfo& fileInfo = *m_fileInfo;
+	double shadowMask = 1.0;
+
+	rtTriangleMeshView sceneMesh = TriangleMeshView(fileInfo);
+
+	auto occludeTriangle = [&](const rtTriangleMeshView& mesh, int face, const rtRay& triRay, const rtPrimitiveRef& prim)
+	{
+		if (prim == skip)
+		{
+			return;
+		}
+		double t, alpha, beta, gamma;
+		rtVector3 normal;
+		rtPoint p[3];
+		mesh.positions(face, p);
+		if (IntersectTriangle(p[0], p[1], p[2], triRay, maxT, t, alpha, beta, gamma, normal) && t > 0 && t < maxT)
+		{
+			shadowMask = shadowMask * (1.0 - fileInfo.materials[PrimitiveMaterialIndex(fileInfo, prim)].m_alpha);
+		}
+	};
+
+	double tMax = maxT;
+	Traverse<Isa>(top, ray, tMax, [&](int primIndex, double&)
+	{
+		if (primIndex < m_sphereCount)
+		{
+			if (!(skip.m_isSphere && primIndex == skip.m_objIndex) && SphereBlocksSegment(fileInfo.spheres[primIndex], ray, maxT))
+			{
+				shadowMask = shadowMask * (1.0 - fileInfo.materials[fileInfo.spheres[primIndex].m_materialIndex].m_alpha);
+			}
+		}
+		else if (primIndex < m_sphereCount + m_triangleCount)
+		{
+			int triIndex = primIndex - m_sphereCount;
+			occludeTriangle(sceneMesh, triIndex, ray, rtPrimitiveRef(false, triIndex));
+		}
+		else
+		{
+			int instanceIndex = primIndex - m_sphereCount - m_triangleCount;
+			const rtInstance& instance = fileInfo.instances[instanceIndex];
+			rtTriangleMeshView mesh = TriangleMeshView(fileInfo.meshes[instance.meshIndex]);
+			rtRay local = ToMeshSpace(ray, instance);
+			double tLocalMax = maxT;
+			Traverse<Isa>(meshes[instance.meshIndex], local, tLocalMax, [&](int triIndex, double&)
+			{
+				occludeTriangle(mesh, triIndex, local, rtPrimitiveRef(false, triIndex, instanceIndex));
+				return shadowMask != 0.0;
+			});
+		}
+		// an opaque occluder already blocks the light completely
+		return shadowMask != 0.0;
+	});
+	return shadowMask;
+}
+
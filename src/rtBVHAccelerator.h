@@ -0,0 +1,66 @@
+#pragma once
+#include "rtAccelerator.h"
+#include "rtBVH.h"
+#include "rtWideBVH.h"
+#include "rtInstructionSet.h"
+
+class rtGrid;
+
+// two level hierarchy: the top rtBVH holds the spheres, then the scene's triangles, then the
+// mesh instances. every mesh has one bottom rtBVH shared by all of its instances, instance
+// leaves move the ray into mesh space and continue in that tree.
+// with width 4 or 8 the binary trees are built and refit as usual, then collapsed into
+// rtWideBVHs that answer the queries. the queries run in the kernel variant of the instruction
+// set active when the structure was built
+class rtBVHAccelerator : public rtAccelerator
+{
+public:
+	rtBVHAccelerator(const std::shared_ptr<ObjFileInfo>& fileInfo, int width = 2, eBVHBuild method = eBVHBuild::kMedian, int threads = 1)
+		: rtAccelerator(fileInfo), m_width(width), m_method(method), m_threads(threads) {}
+
+	void build() override;
+	bool update() override;
+
+	bool closestHit(const rtRay& ray, rtHitRecord& hit) const override;
+	double transmittance(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const override;
+	rtAABB bounds() const override;
+	double sahCost() const override;
+
+protected:
+	void computePrimBounds(std::vector<rtAABB>& primBounds) const;
+	void buildMeshes();
+	void buildWide();
+
+	// one compiled variant per instruction set, each picks the structure to walk
+	template <eInstructionSet Isa>
+	bool closestHitKernel(const rtRay& ray, rtHitRecord& hit) const;
+	template <eInstructionSet Isa>
+	double transmittanceKernel(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const;
+	template <eInstructionSet Isa>
+	bool closestHitTop(const rtRay& ray, rtHitRecord& hit) const;
+	template <eInstructionSet Isa>
+	double transmittanceTop(const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const;
+
+	// Top answers the scene level query, Mesh the queries of instanced meshes. both follow
+	// rtBVH::traverse's contract
+	template <eInstructionSet Isa, typename Top, typename Mesh>
+	bool closestHitIn(const Top& top, const std::vector<Mesh>& meshes, const rtRay& ray, rtHitRecord& hit) const;
+	template <eInstructionSet Isa, typename Top, typename Mesh>
+	double transmittanceIn(const Top& top, const std::vector<Mesh>& meshes, const rtRay& ray, double maxT, const rtPrimitiveRef& skip) const;
+
+	int m_width = 2;
+	eBVHBuild m_method = eBVHBuild::kMedian;
+	int m_threads = 1;
+	rtBVH m_bvh;
+	std::vector<rtBVH> m_meshBVHs;
+	rtWideBVH<4> m_bvh4;
+	std::vector<rtWideBVH<4>> m_meshBVH4s;
+	rtWideBVH<8> m_bvh8;
+	std::vector<rtWideBVH<8>> m_meshBVH8s;
+	int m_sphereCount = 0;
+	int m_triangleCount = 0;
+	double m_builtSahCost = 0.0;
+	eInstructionSet m_isa = eInstructionSet::kGeneric;
+	// set by rtGridAccelerator, replaces the top level tree
+	const rtGrid* m_grid = nullptr;
+};
@@ -0,0 +1,91 @@
+#include "rtBatchRenderer.h"
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <iostream>
+
+rtBatchRenderer::rtBatchRenderer(rayTracer& scene, const rtRenderOptions& options)
+	: m_scene(scene), m_options(options)
+{
+}
+
+bool rtBatchRenderer::Run(const std::vector<rtCamera>& frames, const std::vector<std::vector<rtPrimitiveMove>>& moves)
+{
+	bool ok = true;
+	std::future<bool> pendingWrite;
+	std::shared_ptr<const rayTracer> previous;
+
+	for (size_t f = 0; f < frames.size(); f++)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// the writer of the previous frame only reads pixels, the scene can be moved meanwhile
+		rtSceneEdit edit;
+		if (f < moves.size() && !moves[f].empty())
+		{
+			for (const rtPrimitiveMove& move : moves[f])
+			{
+				edit.m_bounds.push_back(move.m_isSphere ? m_scene.SphereBounds(move.m_index) : m_scene.VertexBounds(move.m_index));
+				bool moved = move.m_isSphere ? m_scene.SetSphereCenter(move.m_index, move.m_position) : m_scene.SetVertexPosition(move.m_index, move.m_position);
+				if (!moved)
+				{
+					std::cout << "Frame " << f << ": no " << (move.m_isSphere ? "sphere " : "vertex ") << move.m_index + 1 << std::endl;
+				}
+				edit.m_bounds.push_back(move.m_isSphere ? m_scene.SphereBounds(move.m_index) : m_scene.VertexBounds(move.m_index));
+			}
+			if (m_scene.UpdateAccelerationStructure())
+			{
+				std::cout << "Frame " << f << ": acceleration structure rebuilt" << std::endl;
+			}
+		}
+
+		std::shared_ptr<rayTracer> frame = m_scene.CreateJobInstance();
+		frame->SetCamera(frames[f]);
+		frame->SetDependencyRecording(m_options.m_incremental);
+		if (!frame->PrepareFrame())
+		{
+			std::cout << "Frame " << f << ": invalid camera" << std::endl;
+			ok = false;
+			previous.reset();
+			continue;
+		}
+
+		// incremental: a frame with the previous camera keeps the tiles the moves can't change
+		std::vector<rtTile> tiles = m_options.m_shard.buildTiles(frame->GetImageSize());
+		size_t tileCount = tiles.size();
+		if (m_options.m_incremental && previous && frame->ReusePreviousFrame(*previous))
+		{
+			tiles = frame->TilesToUpdate(tiles, edit);
+		}
+		frame->ComputePixelColor(tiles, m_options.m_threads);
+
+		// the previous frame has been writing while this one was traced
+		if (pendingWrite.valid())
+		{
+			ok = pendingWrite.get() && ok;
+		}
+
+		char suffix[16];
+		std::snprintf(suffix, sizeof(suffix), "_%04d", static_cast<int>(f));
+		std::string fileName = rayTracer::OutputFilePath(m_options.m_outFolder, m_options.m_sceneFile, suffix);
+		pendingWrite = std::async(std::launch::async, [frame, fileName]()
+		{
+			return frame->OutputImage(fileName);
+		});
+		previous = frame;
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		std::cout << "Frame " << f + 1 << "/" << frames.size() << " traced in " << elapsed.count() << "ms";
+		if (m_options.m_incremental)
+		{
+			std::cout << ", " << tiles.size() << " of " << tileCount << " tiles";
+		}
+		std::cout << std::endl;
+	}
+
+	if (pendingWrite.valid())
+	{
+		ok = pendingWrite.get() && ok;
+	}
+	return ok;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+#include "rayTracer.h"
+#include "rtCameraPath.h"
+#include "rtRenderOptions.h"
+
+// renders a sequence of cameras over one loaded scene, writing frame N while frame N + 1 is traced.
+// primitives moved between frames only refit the acceleration structure. incremental batches
+// re-trace only the tiles of a frame the moves can change, when the camera stayed where it was
+class rtBatchRenderer
+{
+public:
+	rtBatchRenderer(rayTracer& scene, const rtRenderOptions& options);
+	bool Run(const std::vector<rtCamera>& frames, const std::vector<std::vector<rtPrimitiveMove>>& moves);
+
+private:
+	rayTracer& m_scene;
+	rtRenderOptions m_options;
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include "rtPoint.h"
+#include "rtVector.h"
+
+// everything a frame needs to know about the viewer, initialised from the scene file
+// and overridable per render job
+struct rtCamera
+{
+	rtPoint m_eye;
+	rtVector3 m_viewDir;
+	rtVector3 m_upDir;
+	double m_vFov = 0.0;
+	rtVector2<int> m_imageSize;
+};
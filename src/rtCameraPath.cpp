@@ -0,0 +1,171 @@
+#include "rtCameraPath.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool ReadDoubles(std::istringstream& iss, double* values, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (!(iss >> values[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static double Lerp(double a, double b, double t)
+{
+	return a + (b - a) * t;
+}
+
+static rtVector3 Lerp(const rtVector3& a, const rtVector3& b, double t)
+{
+	return rtVector3(Lerp(a.m_x, b.m_x, t), Lerp(a.m_y, b.m_y, t), Lerp(a.m_z, b.m_z, t));
+}
+
+bool rtCameraPath::load(const std::string& fileName, const rtCamera& baseCamera)
+{
+	std::ifstream inFile(fileName);
+	if (inFile.fail())
+	{
+		std::cout << "Can't find this file: " << fileName << std::endl;
+		return false;
+	}
+
+	std::vector<rtCamera> cameras;
+	std::vector<std::vector<rtPrimitiveMove>> moves;
+	std::vector<int> keyframeNumbers;
+	bool hasFrames = false;
+
+	std::string line;
+	while (std::getline(inFile, line))
+	{
+		std::istringstream iss(line);
+		std::string block;
+		while (iss >> block)
+		{
+			if (block[0] == '#')
+			{
+				break;
+			}
+
+			double values[3];
+			if (block == "frame" || block == "keyframe")
+			{
+				cameras.push_back(cameras.empty() ? baseCamera : cameras.back());
+				moves.push_back(std::vector<rtPrimitiveMove>());
+				if (block == "keyframe")
+				{
+					int number = 0;
+					if (!(iss >> number) || (!keyframeNumbers.empty() && number <= keyframeNumbers.back()))
+					{
+						std::cout << "Camera path: keyframe numbers must be increasing" << std::endl;
+						return false;
+					}
+					keyframeNumbers.push_back(number);
+				}
+				else
+				{
+					hasFrames = true;
+				}
+				continue;
+			}
+
+			if (cameras.empty())
+			{
+				std::cout << "Camera path: " << block << " outside of a frame" << std::endl;
+				return false;
+			}
+
+			rtCamera& camera = cameras.back();
+			if (block == "eye" && ReadDoubles(iss, values, 3))
+			{
+				camera.m_eye = rtPoint(values[0], values[1], values[2]);
+			}
+			else if (block == "viewdir" && ReadDoubles(iss, values, 3))
+			{
+				camera.m_viewDir = rtVector3(values[0], values[1], values[2]);
+			}
+			else if (block == "updir" && ReadDoubles(iss, values, 3))
+			{
+				camera.m_upDir = rtVector3(values[0], values[1], values[2]);
+			}
+			else if (block == "vfov" && ReadDoubles(iss, values, 1))
+			{
+				camera.m_vFov = values[0];
+			}
+			else if ((block == "sphere" || block == "v") && ReadDoubles(iss, values, 1) && values[0] >= 1)
+			{
+				rtPrimitiveMove move;
+				move.m_isSphere = block == "sphere";
+				move.m_index = static_cast<int>(values[0]) - 1;
+				if (!ReadDoubles(iss, values, 3))
+				{
+					std::cout << "Camera path: " << block << " requires an index and 3 doubles" << std::endl;
+					return false;
+				}
+				move.m_position = rtPoint(values[0], values[1], values[2]);
+				moves.back().push_back(move);
+			}
+			else
+			{
+				std::cout << "Camera path: can't parse " << block << std::endl;
+				return false;
+			}
+		}
+	}
+
+	if (hasFrames && !keyframeNumbers.empty())
+	{
+		std::cout << "Camera path: frame and keyframe can't be mixed" << std::endl;
+		return false;
+	}
+
+	if (hasFrames || cameras.size() <= 1)
+	{
+		m_frames = cameras;
+		m_moves = moves;
+		return !m_frames.empty();
+	}
+
+	// keyframes: linear interpolation, directions are renormalised by ComputeUV.
+	// a primitive moved in two consecutive keyframes travels linearly between them
+	m_frames.clear();
+	m_moves.clear();
+	for (size_t k = 0; k + 1 < cameras.size(); k++)
+	{
+		int span = keyframeNumbers[k + 1] - keyframeNumbers[k];
+		for (int f = 0; f < span; f++)
+		{
+			double t = static_cast<double>(f) / span;
+			rtCamera camera = cameras[k];
+			rtVector3 eye = Lerp(cameras[k].m_eye.subtract(rtPoint()), cameras[k + 1].m_eye.subtract(rtPoint()), t);
+			camera.m_eye = rtPoint(eye.m_x, eye.m_y, eye.m_z);
+			camera.m_viewDir = Lerp(cameras[k].m_viewDir, cameras[k + 1].m_viewDir, t);
+			camera.m_upDir = Lerp(cameras[k].m_upDir, cameras[k + 1].m_upDir, t);
+			camera.m_vFov = Lerp(cameras[k].m_vFov, cameras[k + 1].m_vFov, t);
+			m_frames.push_back(camera);
+
+			std::vector<rtPrimitiveMove> frameMoves;
+			for (const rtPrimitiveMove& move : moves[k])
+			{
+				rtPrimitiveMove frameMove = move;
+				for (const rtPrimitiveMove& next : moves[k + 1])
+				{
+					if (next.m_isSphere == move.m_isSphere && next.m_index == move.m_index)
+					{
+						rtVector3 position = Lerp(move.m_position.subtract(rtPoint()), next.m_position.subtract(rtPoint()), t);
+						frameMove.m_position = rtPoint(position.m_x, position.m_y, position.m_z);
+					}
+				}
+				frameMoves.push_back(frameMove);
+			}
+			m_moves.push_back(frameMoves);
+		}
+	}
+	m_frames.push_back(cameras.back());
+	m_moves.push_back(moves.back());
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rtCamera.h"
+
+// camera per frame for batch rendering, read from a text file in the scene file syntax
+//
+//   frame                  starts a frame that copies the previous frame's camera
+//   keyframe <n>           starts a keyframe at frame n, frames between keyframes are interpolated
+//   eye x y z / viewdir x y z / updir x y z / vfov degrees
+//   sphere <n> x y z / v <n> x y z     moves the n-th sphere / vertex (1-based), moves persist
+//
+// a file may use either frames or keyframes, lines starting with # are ignored
+struct rtPrimitiveMove
+{
+	bool m_isSphere = true;
+	int m_index = 0;
+	rtPoint m_position;
+};
+
+class rtCameraPath
+{
+public:
+	bool load(const std::string& fileName, const rtCamera& baseCamera);
+
+	const std::vector<rtCamera>& getFrames() const { return m_frames; }
+	// primitives to move before each frame, indices are 0-based
+	const std::vector<std::vector<rtPrimitiveMove>>& getMoves() const { return m_moves; }
+
+private:
+	std::vector<rtCamera> m_frames;
+	std::vector<std::vector<rtPrimitiveMove>> m_moves;
+};
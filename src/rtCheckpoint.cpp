@@ -0,0 +1,144 @@
+#include "rtCheckpoint.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static const char CHECKPOINT_MAGIC[6] = { 'R', 'T', 'C', 'K', 'P', 'T' };
+static constexpr uint32_t CHECKPOINT_VERSION = 1;
+
+template <typename T>
+static void WriteValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream& file, T& value)
+{
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static uint64_t HashBytes(uint64_t hash, const char* bytes, size_t count)
+{
+	// FNV-1a
+	for (size_t i = 0; i < count; i++)
+	{
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+uint64_t rtCheckpoint::fingerprint(const std::string& sceneFile, const std::string& settings)
+{
+	std::ifstream file(sceneFile, std::ios::binary);
+	std::string scene((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	uint64_t hash = HashBytes(0xcbf29ce484222325ull, scene.data(), scene.size());
+	return HashBytes(hash, settings.data(), settings.size());
+}
+
+bool rtCheckpoint::write(const std::string& fileName, uint64_t fingerprint, const rtVector2<int>& imageSize, const std::vector<rtTile>& tiles, const std::vector<std::vector<rtColor>>& pixels)
+{
+	std::string tempName = fileName + ".tmp";
+	{
+		std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+		if (file.fail())
+		{
+			std::cout << "Can't write checkpoint: " << tempName << std::endl;
+			return false;
+		}
+		file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+		WriteValue(file, CHECKPOINT_VERSION);
+		WriteValue(file, fingerprint);
+		WriteValue(file, static_cast<int32_t>(imageSize.m_x));
+		WriteValue(file, static_cast<int32_t>(imageSize.m_y));
+		WriteValue(file, static_cast<uint32_t>(tiles.size()));
+		for (const rtTile& tile : tiles)
+		{
+			int32_t rect[4] = { tile.m_x0, tile.m_y0, tile.m_x1, tile.m_y1 };
+			WriteValue(file, rect);
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
+			{
+				for (int j = tile.m_y0; j < tile.m_y1; j++)
+				{
+					double rgb[3] = { pixels[i][j].m_r, pixels[i][j].m_g, pixels[i][j].m_b };
+					WriteValue(file, rgb);
+				}
+			}
+		}
+		file.close();
+		if (file.fail())
+		{
+			std::cout << "Can't write checkpoint: " << tempName << std::endl;
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempName, fileName, error);
+	if (error)
+	{
+		std::cout << "Can't replace checkpoint: " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool rtCheckpoint::read(const std::string& fileName, uint64_t fingerprint, const rtVector2<int>& imageSize, std::vector<rtTile>& tiles, std::vector<std::vector<rtColor>>& pixels)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (file.fail())
+	{
+		std::cout << "No checkpoint to resume: " << fileName << std::endl;
+		return false;
+	}
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	uint32_t version = 0;
+	uint64_t storedFingerprint = 0;
+	int32_t width = 0, height = 0;
+	uint32_t tileCount = 0;
+	file.read(magic, sizeof(magic));
+	if (!file || !std::equal(magic, magic + sizeof(magic), CHECKPOINT_MAGIC) || !ReadValue(file, version) || version != CHECKPOINT_VERSION)
+	{
+		std::cout << "Not a checkpoint: " << fileName << std::endl;
+		return false;
+	}
+	if (!ReadValue(file, storedFingerprint) || !ReadValue(file, width) || !ReadValue(file, height) || !ReadValue(file, tileCount))
+	{
+		std::cout << "Corrupted checkpoint: " << fileName << std::endl;
+		return false;
+	}
+	if (storedFingerprint != fingerprint || width != imageSize.m_x || height != imageSize.m_y)
+	{
+		std::cout << "Checkpoint belongs to another scene or other settings: " << fileName << std::endl;
+		return false;
+	}
+
+	tiles.clear();
+	for (uint32_t t = 0; t < tileCount; t++)
+	{
+		int32_t rect[4];
+		if (!ReadValue(file, rect) || rect[0] < 0 || rect[1] < 0 || rect[2] > width || rect[3] > height)
+		{
+			std::cout << "Corrupted checkpoint: " << fileName << std::endl;
+			return false;
+		}
+		rtTile tile(rect[0], rect[1], rect[2], rect[3]);
+		for (int i = tile.m_x0; i < tile.m_x1; i++)
+		{
+			for (int j = tile.m_y0; j < tile.m_y1; j++)
+			{
+				double rgb[3];
+				if (!ReadValue(file, rgb))
+				{
+					std::cout << "Corrupted checkpoint: " << fileName << std::endl;
+					return false;
+				}
+				pixels[i][j] = rtColor(rgb[0], rgb[1], rgb[2]);
+			}
+		}
+		tiles.push_back(tile);
+	}
+	return true;
+}
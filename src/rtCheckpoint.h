@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "rtColor.h"
+#include "rtTile.h"
+
+// finished tiles of a render in progress, so a preempted render can be resumed. binary, in
+// the machine's byte order:
+//
+// "RTCKPT", uint32 version, uint64 fingerprint, int32 image width and height, uint32 tile count
+// then per tile: int32 x0 y0 x1 y1 followed by its pixels column by column, r g b as doubles
+//
+// each pixel is traced once, so the colors are the whole accumulated state and a resumed
+// render writes the same image as an uninterrupted one
+class rtCheckpoint
+{
+public:
+	// identifies a scene file and the settings that change its pixels, a checkpoint of
+	// another fingerprint is not resumed
+	static uint64_t fingerprint(const std::string& sceneFile, const std::string& settings);
+
+	// written next to fileName and renamed over it, an interrupted write keeps the old checkpoint
+	static bool write(const std::string& fileName, uint64_t fingerprint, const rtVector2<int>& imageSize, const std::vector<rtTile>& tiles, const std::vector<std::vector<rtColor>>& pixels);
+	// tiles receives the finished tiles, their pixels are stored into pixels
+	static bool read(const std::string& fileName, uint64_t fingerprint, const rtVector2<int>& imageSize, std::vector<rtTile>& tiles, std::vector<std::vector<rtColor>>& pixels);
+};
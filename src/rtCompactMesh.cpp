@@ -0,0 +1,311 @@
+#include "rtCompactMesh.h"
+#include "ObjFileReader.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+static constexpr double MAX_GRID_COORD = 2147483000.0;
+
+static int BitsFor(uint32_t value)
+{
+	int bits = 0;
+	while (bits < 32 && (value >> bits) != 0)
+	{
+		bits++;
+	}
+	return bits;
+}
+
+static uint32_t ZigZag(int32_t value)
+{
+	return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static uint16_t QuantizeUnit(double value, double minValue, double range)
+{
+	double q = range > 0.0 ? (value - minValue) / range * 65535.0 : 0.0;
+	return static_cast<uint16_t>(std::min(65535.0, std::max(0.0, std::round(q))));
+}
+
+static uint32_t OctahedronEncode(rtVector3 n)
+{
+	double sum = std::abs(n.m_x) + std::abs(n.m_y) + std::abs(n.m_z);
+	if (sum == 0.0)
+	{
+		return 0;
+	}
+	double u = n.m_x / sum;
+	double v = n.m_y / sum;
+	if (n.m_z < 0.0)
+	{
+		// fold the lower hemisphere over the diagonals
+		double fu = (1.0 - std::abs(v)) * (u >= 0.0 ? 1.0 : -1.0);
+		double fv = (1.0 - std::abs(u)) * (v >= 0.0 ? 1.0 : -1.0);
+		u = fu;
+		v = fv;
+	}
+	auto snorm = [](double x) { return static_cast<uint16_t>(static_cast<int16_t>(std::round(std::min(1.0, std::max(-1.0, x)) * 32767.0))); };
+	return static_cast<uint32_t>(snorm(u)) | (static_cast<uint32_t>(snorm(v)) << 16);
+}
+
+static rtVector3 OctahedronDecode(uint32_t code)
+{
+	double u = static_cast<int16_t>(code & 0xffff) / 32767.0;
+	double v = static_cast<int16_t>(code >> 16) / 32767.0;
+	rtVector3 n(u, v, 1.0 - std::abs(u) - std::abs(v));
+	double t = std::max(-n.m_z, 0.0);
+	n.m_x += n.m_x >= 0.0 ? -t : t;
+	n.m_y += n.m_y >= 0.0 ? -t : t;
+	return n.getTwoNorm();
+}
+
+bool rtCompactMesh::encode(const std::pmr::vector<rtPoint>& verteices, const std::pmr::vector<rtVector3>& vertexNormals,
+	const std::pmr::vector<rtVector2<double>>& vertexTextureCoordinates, const std::pmr::vector<rtFace>& faces,
+	const std::pmr::vector<int>& faceMaterialIndexs)
+{
+	*this = rtCompactMesh();
+	m_faceCount = static_cast<int>(faces.size());
+	if (faces.empty())
+	{
+		return true;
+	}
+
+	// faces may name texture coordinates or normals the file never defines, they are only
+	// looked up when shading needs them, so treat those as absent
+	auto hasTexcoord = [&](const int* corner) { return corner[1] > 0 && corner[1] <= static_cast<int>(vertexTextureCoordinates.size()); };
+	auto hasNormal = [&](const int* corner) { return corner[2] > 0 && corner[2] <= static_cast<int>(vertexNormals.size()); };
+	bool hasNormals = false;
+	bool hasTexcoords = false;
+	for (const rtFace& face : faces)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			hasNormals = hasNormals || hasNormal(face[k]);
+			hasTexcoords = hasTexcoords || hasTexcoord(face[k]);
+		}
+	}
+
+	// one grid for the whole mesh, fine enough for 16 bit offsets to span the largest cluster
+	rtPoint sceneMin(verteices[0].m_x, verteices[0].m_y, verteices[0].m_z);
+	rtPoint sceneMax = sceneMin;
+	for (const rtPoint& p : verteices)
+	{
+		sceneMin = rtPoint(std::min(sceneMin.m_x, p.m_x), std::min(sceneMin.m_y, p.m_y), std::min(sceneMin.m_z, p.m_z));
+		sceneMax = rtPoint(std::max(sceneMax.m_x, p.m_x), std::max(sceneMax.m_y, p.m_y), std::max(sceneMax.m_z, p.m_z));
+	}
+	double clusterExtent = 0.0;
+	for (size_t first = 0; first < faces.size(); first += CLUSTER_SIZE)
+	{
+		double lo[3] = { INFINITY, INFINITY, INFINITY };
+		double hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+		for (size_t f = first; f < std::min(faces.size(), first + CLUSTER_SIZE); f++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const rtPoint& p = verteices[faces[f][k][0] - 1];
+				double c[3] = { p.m_x, p.m_y, p.m_z };
+				for (int axis = 0; axis < 3; axis++)
+				{
+					lo[axis] = std::min(lo[axis], c[axis]);
+					hi[axis] = std::max(hi[axis], c[axis]);
+				}
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			clusterExtent = std::max(clusterExtent, hi[axis] - lo[axis]);
+		}
+	}
+	double sceneExtent = std::max(sceneMax.m_x - sceneMin.m_x, std::max(sceneMax.m_y - sceneMin.m_y, sceneMax.m_z - sceneMin.m_z));
+	m_gridOrigin = sceneMin;
+	m_gridStep = std::max(clusterExtent / 65534.0, sceneExtent / MAX_GRID_COORD);
+	if (m_gridStep <= 0.0)
+	{
+		m_gridStep = 1.0;
+	}
+
+	std::vector<int32_t> grid(verteices.size() * 3);
+	for (size_t i = 0; i < verteices.size(); i++)
+	{
+		double c[3] = { verteices[i].m_x - sceneMin.m_x, verteices[i].m_y - sceneMin.m_y, verteices[i].m_z - sceneMin.m_z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			grid[3 * i + axis] = static_cast<int32_t>(std::llround(c[axis] / m_gridStep));
+			m_maxPositionError = std::max(m_maxPositionError, std::abs(grid[3 * i + axis] * m_gridStep - c[axis]));
+		}
+	}
+
+	std::map<std::tuple<int, int, int>, uint32_t> localCorners;
+	std::vector<std::vector<uint32_t>> clusterFaces;
+	size_t totalBits = 0;
+	for (size_t first = 0; first < faces.size(); first += CLUSTER_SIZE)
+	{
+		size_t last = std::min(faces.size(), first + CLUSTER_SIZE);
+		rtCluster cluster;
+		cluster.m_firstCorner = static_cast<uint32_t>(m_positions.size() / 3);
+
+		// distinct v/vt/vn corners in order of first use, so a face's corners sit close together
+		localCorners.clear();
+		std::vector<const int*> corners;
+		std::vector<uint32_t> local((last - first) * 3);
+		for (size_t f = first; f < last; f++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const int* corner = faces[f][k];
+				auto inserted = localCorners.emplace(std::make_tuple(corner[0], corner[1], corner[2]), static_cast<uint32_t>(corners.size()));
+				if (inserted.second)
+				{
+					corners.push_back(corner);
+				}
+				local[(f - first) * 3 + k] = inserted.first->second;
+			}
+		}
+
+		int32_t lo[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+		double uvLo[2] = { INFINITY, INFINITY };
+		double uvHi[2] = { -INFINITY, -INFINITY };
+		for (const int* corner : corners)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				lo[axis] = std::min(lo[axis], grid[3 * static_cast<size_t>(corner[0] - 1) + axis]);
+			}
+			if (hasTexcoord(corner))
+			{
+				const rtVector2<double>& uv = vertexTextureCoordinates[corner[1] - 1];
+				uvLo[0] = std::min(uvLo[0], uv.m_x);
+				uvLo[1] = std::min(uvLo[1], uv.m_y);
+				uvHi[0] = std::max(uvHi[0], uv.m_x);
+				uvHi[1] = std::max(uvHi[1], uv.m_y);
+			}
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			cluster.m_origin[axis] = lo[axis];
+		}
+		if (uvLo[0] > uvHi[0])
+		{
+			uvLo[0] = uvLo[1] = uvHi[0] = uvHi[1] = 0.0;
+		}
+		for (int axis = 0; axis < 2; axis++)
+		{
+			cluster.m_uvMin[axis] = static_cast<float>(uvLo[axis]);
+			cluster.m_uvScale[axis] = static_cast<float>((uvHi[axis] - uvLo[axis]) / 65535.0);
+		}
+
+		for (const int* corner : corners)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				m_positions.push_back(static_cast<uint16_t>(grid[3 * static_cast<size_t>(corner[0] - 1) + axis] - lo[axis]));
+			}
+			if (hasNormals)
+			{
+				m_normals.push_back(hasNormal(corner) ? OctahedronEncode(vertexNormals[corner[2] - 1]) : 0);
+			}
+			if (hasTexcoords)
+			{
+				rtVector2<double> uv = hasTexcoord(corner) ? vertexTextureCoordinates[corner[1] - 1] : rtVector2<double>(uvLo[0], uvLo[1]);
+				m_texcoords.push_back(QuantizeUnit(uv.m_x, uvLo[0], uvHi[0] - uvLo[0]));
+				m_texcoords.push_back(QuantizeUnit(uv.m_y, uvLo[1], uvHi[1] - uvLo[1]));
+			}
+		}
+
+		uint32_t maxZigzag = 0;
+		for (size_t f = 0; f < last - first; f++)
+		{
+			for (int k = 1; k < 3; k++)
+			{
+				int32_t delta = static_cast<int32_t>(local[f * 3 + k]) - static_cast<int32_t>(local[f * 3]);
+				maxZigzag = std::max(maxZigzag, ZigZag(delta));
+			}
+		}
+		cluster.m_indexBits = static_cast<uint8_t>(BitsFor(static_cast<uint32_t>(corners.size() - 1)));
+		cluster.m_deltaBits = static_cast<uint8_t>(BitsFor(maxZigzag));
+		cluster.m_bitOffset = static_cast<uint32_t>(totalBits);
+		totalBits += (last - first) * (1 + cluster.m_indexBits + 2 * cluster.m_deltaBits);
+		m_clusters.push_back(cluster);
+		clusterFaces.push_back(std::move(local));
+	}
+
+	// pad so the five byte read of the last face stays inside the buffer
+	m_faceBits.assign((totalBits + 7) / 8 + 8, 0);
+	auto writeBits = [&](size_t& bit, uint32_t value, int count)
+	{
+		for (int b = 0; b < count; b++, bit++)
+		{
+			if ((value >> b) & 1)
+			{
+				m_faceBits[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+			}
+		}
+	};
+	for (size_t c = 0; c < m_clusters.size(); c++)
+	{
+		const rtCluster& cluster = m_clusters[c];
+		const std::vector<uint32_t>& local = clusterFaces[c];
+		size_t bit = cluster.m_bitOffset;
+		for (size_t f = 0; f < local.size() / 3; f++)
+		{
+			size_t face = c * CLUSTER_SIZE + f;
+			writeBits(bit, faces[face][0][2] == 0 ? 1 : 0, 1);
+			writeBits(bit, local[f * 3], cluster.m_indexBits);
+			for (int k = 1; k < 3; k++)
+			{
+				int32_t delta = static_cast<int32_t>(local[f * 3 + k]) - static_cast<int32_t>(local[f * 3]);
+				writeBits(bit, ZigZag(delta), cluster.m_deltaBits);
+			}
+		}
+	}
+
+	m_materialIndices.reserve(faceMaterialIndexs.size());
+	for (int materialIndex : faceMaterialIndexs)
+	{
+		if (materialIndex < 0 || materialIndex > 65535)
+		{
+			return false;
+		}
+		m_materialIndices.push_back(static_cast<uint16_t>(materialIndex));
+	}
+	return true;
+}
+
+size_t rtCompactMesh::byteSize() const
+{
+	return m_clusters.size() * sizeof(rtCluster) + m_positions.size() * sizeof(uint16_t) + m_normals.size() * sizeof(uint32_t)
+		+ m_texcoords.size() * sizeof(uint16_t) + m_faceBits.size() + m_materialIndices.size() * sizeof(uint16_t);
+}
+
+bool rtCompactMesh::normals(int face, rtVector3 n[3]) const
+{
+	uint32_t corners[3];
+	if (decodeFace(face, corners) || m_normals.empty())
+	{
+		return false;
+	}
+	for (int k = 0; k < 3; k++)
+	{
+		n[k] = OctahedronDecode(m_normals[corners[k]]);
+	}
+	return true;
+}
+
+void rtCompactMesh::textureCoordinates(int face, rtVector2<double> uv[3]) const
+{
+	uint32_t corners[3];
+	decodeFace(face, corners);
+	const rtCluster& cluster = m_clusters[face / CLUSTER_SIZE];
+	for (int k = 0; k < 3; k++)
+	{
+		if (m_texcoords.empty())
+		{
+			uv[k] = rtVector2<double>();
+			continue;
+		}
+		const uint16_t* q = &m_texcoords[2 * static_cast<size_t>(corners[k])];
+		uv[k] = rtVector2<double>(cluster.m_uvMin[0] + q[0] * static_cast<double>(cluster.m_uvScale[0]),
+			cluster.m_uvMin[1] + q[1] * static_cast<double>(cluster.m_uvScale[1]));
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <memory_resource>
+#include "rtVector.h"
+#include "rtPoint.h"
+
+struct rtFace;
+
+// lossy triangle storage for scenes that don't fit in memory at full precision.
+// faces are grouped into clusters of CLUSTER_SIZE consecutive faces, and every cluster keeps
+// a table of the distinct v/vt/vn corners its faces use:
+// - positions are 16 bit offsets from the cluster origin on a grid shared by the whole mesh,
+//   so a vertex used by two clusters decodes to the same point and no cracks open up
+// - normals are octahedron encoded into two 16 bit values
+// - texture coordinates are 16 bit values between the cluster's uv bounds
+// - a face is a flat shading bit, the local index of its first corner and the zigzag deltas
+//   of the other two, packed at a bit width fixed per cluster so any face decodes on its own
+class rtCompactMesh
+{
+public:
+	static constexpr int CLUSTER_SIZE = 64;
+
+	// false if the faces can't be encoded (material index outside 0..65535)
+	bool encode(const std::pmr::vector<rtPoint>& verteices, const std::pmr::vector<rtVector3>& vertexNormals,
+		const std::pmr::vector<rtVector2<double>>& vertexTextureCoordinates, const std::pmr::vector<rtFace>& faces,
+		const std::pmr::vector<int>& faceMaterialIndexs);
+
+	int faceCount() const { return m_faceCount; }
+	size_t byteSize() const;
+	double maxPositionError() const { return m_maxPositionError; }
+
+	void positions(int face, rtPoint p[3]) const;
+	// false for flat shaded faces
+	bool normals(int face, rtVector3 n[3]) const;
+	void textureCoordinates(int face, rtVector2<double> uv[3]) const;
+	int materialIndex(int face) const { return m_materialIndices[face]; }
+
+private:
+	struct rtCluster
+	{
+		int32_t m_origin[3] = {};
+		uint32_t m_firstCorner = 0;
+		uint32_t m_bitOffset = 0;
+		float m_uvMin[2] = {};
+		float m_uvScale[2] = {};
+		uint8_t m_indexBits = 0;
+		uint8_t m_deltaBits = 0;
+	};
+
+	// returns the flat bit, corners receives indices into the per corner arrays
+	bool decodeFace(int face, uint32_t corners[3]) const;
+
+	int m_faceCount = 0;
+	rtPoint m_gridOrigin;
+	double m_gridStep = 1.0;
+	double m_maxPositionError = 0.0;
+	std::vector<rtCluster> m_clusters;
+	std::vector<uint16_t> m_positions;   // 3 per corner
+	std::vector<uint32_t> m_normals;     // empty if no face has vertex normals
+	std::vector<uint16_t> m_texcoords;   // 2 per corner, empty if no face has texture coordinates
+	std::vector<uint8_t> m_faceBits;
+	std::vector<uint16_t> m_materialIndices;
+};
+
+inline bool rtCompactMesh::decodeFace(int face, uint32_t corners[3]) const
+{
+	uint32_t index = static_cast<uint32_t>(face);
+	const rtCluster& cluster = m_clusters[index / CLUSTER_SIZE];
+	uint32_t faceBits = 1 + cluster.m_indexBits + 2 * cluster.m_deltaBits;
+	size_t bit = cluster.m_bitOffset + static_cast<size_t>(index % CLUSTER_SIZE) * faceBits;
+
+	// a face is at most 1 + 8 + 2 * 9 bits, five bytes always cover it
+	const uint8_t* bytes = &m_faceBits[bit >> 3];
+	uint64_t word = static_cast<uint64_t>(bytes[0]) | (static_cast<uint64_t>(bytes[1]) << 8) | (static_cast<uint64_t>(bytes[2]) << 16)
+		| (static_cast<uint64_t>(bytes[3]) << 24) | (static_cast<uint64_t>(bytes[4]) << 32);
+	word >>= (bit & 7);
+
+	bool flat = word & 1;
+	uint32_t first = static_cast<uint32_t>(word >> 1) & ((1u << cluster.m_indexBits) - 1);
+	uint32_t deltaMask = (1u << cluster.m_deltaBits) - 1;
+	uint32_t zigzag1 = static_cast<uint32_t>(word >> (1 + cluster.m_indexBits)) & deltaMask;
+	uint32_t zigzag2 = static_cast<uint32_t>(word >> (1 + cluster.m_indexBits + cluster.m_deltaBits)) & deltaMask;
+	corners[0] = cluster.m_firstCorner + first;
+	corners[1] = corners[0] + ((zigzag1 >> 1) ^ (0u - (zigzag1 & 1)));
+	corners[2] = corners[0] + ((zigzag2 >> 1) ^ (0u - (zigzag2 & 1)));
+	return flat;
+}
+
+inline void rtCompactMesh::positions(int face, rtPoint p[3]) const
+{
+	uint32_t corners[3];
+	decodeFace(face, corners);
+	const rtCluster& cluster = m_clusters[static_cast<uint32_t>(face) / CLUSTER_SIZE];
+	for (int k = 0; k < 3; k++)
+	{
+		const uint16_t* q = &m_positions[3 * static_cast<size_t>(corners[k])];
+		p[k] = rtPoint(m_gridOrigin.m_x + (cluster.m_origin[0] + q[0]) * m_gridStep,
+			m_gridOrigin.m_y + (cluster.m_origin[1] + q[1]) * m_gridStep,
+			m_gridOrigin.m_z + (cluster.m_origin[2] + q[2]) * m_gridStep);
+	}
+}
@@ -0,0 +1,148 @@
+#include "rtCoordinator.h"
+#include "rtPartialImage.h"
+#include "rayTracer.h"
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+static std::string Quote(const std::string& arg)
+{
+	return "\"" + arg + "\"";
+}
+
+rtCoordinator::rtCoordinator(const rtRenderOptions& options)
+	: m_options(options)
+{
+}
+
+std::string rtCoordinator::BuildWorkerCommand(int shardIndex, int shardCount, const std::string& partialFile) const
+{
+	std::string command = Quote(m_options.m_executable) + " " + Quote(m_options.m_sceneFile) + " " + Quote(m_options.m_outFolder) + " " + Quote(m_options.m_textureDir);
+	command += " --shard " + std::to_string(shardIndex) + "/" + std::to_string(shardCount);
+	command += " --tile-size " + std::to_string(m_options.m_shard.m_tileSize);
+	command += " --threads " + std::to_string(m_options.m_threads);
+	command += " --partial " + Quote(partialFile);
+	if (m_options.m_compactGeometry)
+	{
+		command += " --compact-geometry";
+	}
+	if (m_options.m_lightCutoff > 0.0)
+	{
+		std::ostringstream cutoff;
+		cutoff << std::setprecision(17) << m_options.m_lightCutoff;
+		command += " --light-cutoff " + cutoff.str();
+	}
+	if (m_options.m_lightSamples > 0)
+	{
+		command += " --light-samples " + std::to_string(m_options.m_lightSamples);
+	}
+	if (m_options.m_coherentRays)
+	{
+		command += " --coherent-rays";
+	}
+	command += std::string(" --accel ") + AcceleratorTypeName(m_options.m_accelerator);
+	command += std::string(" --bvh-build ") + BVHBuildName(m_options.m_bvhBuild);
+	if (!m_options.m_detectInstructionSet)
+	{
+		command += std::string(" --isa ") + InstructionSetName(m_options.m_instructionSet);
+	}
+	if (m_options.m_overrideShadows)
+	{
+		command += std::string(" --shadows ") + ShadowModeName(m_options.m_shadows);
+	}
+	command += std::string(" --texture-filter ") + TextureFilterName(m_options.m_textureFilter);
+	command += std::string(" --tile-order ") + TraversalOrderName(m_options.m_shard.m_tileOrder);
+	command += std::string(" --pixel-order ") + TraversalOrderName(m_options.m_pixelOrder);
+	if (!m_options.m_checkpointFile.empty())
+	{
+		std::ostringstream interval;
+		interval << std::setprecision(17) << m_options.m_checkpointInterval;
+		command += " --checkpoint " + Quote(ShardCheckpointFile(shardIndex)) + " --checkpoint-interval " + interval.str();
+		if (m_options.m_resume)
+		{
+			command += " --resume";
+		}
+	}
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes of the whole command line
+	command = "\"" + command + "\"";
+#endif
+	return command;
+}
+
+std::string rtCoordinator::ShardCheckpointFile(int shardIndex) const
+{
+	return m_options.m_checkpointFile + ".shard" + std::to_string(shardIndex);
+}
+
+bool rtCoordinator::Run()
+{
+	int workerCount = m_options.m_workers;
+	int shardCount = m_options.m_shardCount > 0 ? m_options.m_shardCount : workerCount * 4;
+
+	std::string stem = std::filesystem::path(m_options.m_sceneFile).stem().string();
+	std::vector<std::string> partialFiles(shardCount);
+	for (int k = 0; k < shardCount; k++)
+	{
+		partialFiles[k] = (std::filesystem::path(m_options.m_outFolder) / (stem + ".shard" + std::to_string(k) + ".rtpart")).string();
+	}
+
+	// shards are pulled by whichever worker slot becomes free first
+	std::atomic<int> nextShard(0);
+	std::atomic<bool> failed(false);
+	std::mutex logMutex;
+	auto workerSlot = [&]()
+	{
+		for (int k = nextShard++; k < shardCount && !failed; k = nextShard++)
+		{
+			// a worker removes its checkpoint only after the partial is written, so a
+			// partial without one is a shard an interrupted run finished
+			if (m_options.m_resume && std::filesystem::exists(partialFiles[k]) && !std::filesystem::exists(ShardCheckpointFile(k)))
+			{
+				std::lock_guard<std::mutex> lock(logMutex);
+				std::cout << "Shard " << k + 1 << "/" << shardCount << " resumed" << std::endl;
+				continue;
+			}
+			int ret = std::system(BuildWorkerCommand(k, shardCount, partialFiles[k]).c_str());
+			std::lock_guard<std::mutex> lock(logMutex);
+			if (ret != 0 || !std::filesystem::exists(partialFiles[k]))
+			{
+				std::cout << "Shard " << k << " failed" << std::endl;
+				failed = true;
+			}
+			else
+			{
+				std::cout << "Shard " << k + 1 << "/" << shardCount << " done" << std::endl;
+			}
+		}
+	};
+
+	std::vector<std::thread> slots;
+	for (int w = 0; w < workerCount; w++)
+	{
+		slots.emplace_back(workerSlot);
+	}
+	for (auto& slot : slots)
+	{
+		slot.join();
+	}
+
+	bool ok = !failed && rtPartialImage::merge(rayTracer::OutputFilePath(m_options.m_outFolder, m_options.m_sceneFile), partialFiles);
+	if (!ok && !m_options.m_checkpointFile.empty())
+	{
+		// finished shards are kept for --resume
+		return false;
+	}
+
+	std::error_code ec;
+	for (const std::string& partialFile : partialFiles)
+	{
+		std::filesystem::remove(partialFile, ec);
+	}
+	return ok;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rtRenderOptions.h"
+
+// renders one image with several local worker processes: the image is cut into
+// interleaved shards which are handed out to the workers as they become idle,
+// every worker writes a partial image and the partials are merged at the end
+class rtCoordinator
+{
+public:
+	rtCoordinator(const rtRenderOptions& options);
+	bool Run();
+
+private:
+	std::string BuildWorkerCommand(int shardIndex, int shardCount, const std::string& partialFile) const;
+	// every shard checkpoints into a file of its own
+	std::string ShardCheckpointFile(int shardIndex) const;
+
+	rtRenderOptions m_options;
+};
@@ -0,0 +1,205 @@
+#include "rtDependencyMap.h"
+#include <cmath>
+
+static constexpr int CELL_COUNT = rtDependencyMap::kResolution * rtDependencyMap::kResolution * rtDependencyMap::kResolution;
+
+void rtDependencyMap::reset(const rtAABB& bounds, int materialCount)
+{
+	m_tiles.clear();
+	m_materialCount = materialCount;
+	m_bounds = bounds;
+	if (bounds.empty())
+	{
+		return;
+	}
+	// padded so rays along the scene's outer faces still cross cells
+	double pad = 1e-3 * std::max(1.0, std::max(bounds.extent(0), std::max(bounds.extent(1), bounds.extent(2))));
+	rtVector3 padding(pad, pad, pad);
+	m_bounds = rtAABB(rtPoint::add(bounds.m_min, padding.scale(-1.0)), rtPoint::add(bounds.m_max, padding));
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_cellSize[axis] = m_bounds.extent(axis) / kResolution;
+	}
+}
+
+int rtDependencyMap::cellCoordinate(double p, int axis) const
+{
+	double offset = (p - rtAxis(m_bounds.m_min, axis)) / m_cellSize[axis];
+	if (!(offset > 0.0))
+	{
+		return 0;
+	}
+	return offset < kResolution ? static_cast<int>(offset) : kResolution - 1;
+}
+
+void rtDependencyMap::begin(rtTileDependencies& record, const rtTile& tile) const
+{
+	record.m_tile = tile;
+	record.m_cells.assign(CELL_COUNT / 64, 0);
+	record.m_materials.assign((m_materialCount + 63) / 64, 0);
+	record.m_background = false;
+	record.m_shaded = false;
+}
+
+void rtDependencyMap::addSegment(rtTileDependencies& record, const rtRay& ray, double tMax) const
+{
+	if (m_bounds.empty())
+	{
+		return;
+	}
+	const double origin[3] = { ray.m_origin.m_x, ray.m_origin.m_y, ray.m_origin.m_z };
+	const double direction[3] = { ray.m_direction.m_x, ray.m_direction.m_y, ray.m_direction.m_z };
+
+	// clip to the bounds
+	double tNear = 0.0;
+	double tFar = tMax;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double lo = rtAxis(m_bounds.m_min, axis);
+		double hi = rtAxis(m_bounds.m_max, axis);
+		if (direction[axis] == 0.0)
+		{
+			if (origin[axis] < lo || origin[axis] > hi)
+			{
+				return;
+			}
+			continue;
+		}
+		double t0 = (lo - origin[axis]) / direction[axis];
+		double t1 = (hi - origin[axis]) / direction[axis];
+		tNear = std::max(tNear, std::min(t0, t1));
+		tFar = std::min(tFar, std::max(t0, t1));
+	}
+	if (!(tNear <= tFar))
+	{
+		return;
+	}
+
+	// 3D-DDA from the entry to the end of the segment, as rtGrid walks its cells
+	int cell[3];
+	int step[3];
+	double tNext[3];
+	double tDelta[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = cellCoordinate(origin[axis] + direction[axis] * tNear, axis);
+		double cellMin = rtAxis(m_bounds.m_min, axis) + cell[axis] * m_cellSize[axis];
+		if (direction[axis] > 0.0)
+		{
+			step[axis] = 1;
+			tNext[axis] = (cellMin + m_cellSize[axis] - origin[axis]) / direction[axis];
+			tDelta[axis] = m_cellSize[axis] / direction[axis];
+		}
+		else if (direction[axis] < 0.0)
+		{
+			step[axis] = -1;
+			tNext[axis] = (cellMin - origin[axis]) / direction[axis];
+			tDelta[axis] = -m_cellSize[axis] / direction[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			tNext[axis] = std::numeric_limits<double>::infinity();
+			tDelta[axis] = std::numeric_limits<double>::infinity();
+		}
+	}
+	while (true)
+	{
+		int cellIndex = (cell[2] * kResolution + cell[1]) * kResolution + cell[0];
+		record.m_cells[cellIndex / 64] |= 1ull << (cellIndex % 64);
+
+		int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+		if (!(tNext[axis] <= tFar))
+		{
+			return;
+		}
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= kResolution)
+		{
+			return;
+		}
+		tNext[axis] += tDelta[axis];
+	}
+}
+
+void rtDependencyMap::addMaterial(rtTileDependencies& record, int material) const
+{
+	record.m_shaded = true;
+	if (material >= 0 && material < m_materialCount)
+	{
+		record.m_materials[material / 64] |= 1ull << (material % 64);
+	}
+}
+
+void rtDependencyMap::store(const rtTileDependencies& record)
+{
+	m_tiles[std::make_pair(record.m_tile.m_x0, record.m_tile.m_y0)] = record;
+}
+
+bool rtDependencyMap::affects(const rtTileDependencies& record, const rtSceneEdit& edit) const
+{
+	if ((edit.m_lights && record.m_shaded) || (edit.m_background && record.m_background))
+	{
+		return true;
+	}
+	for (int material : edit.m_materials)
+	{
+		if (material < 0 || material >= m_materialCount || (record.m_materials[material / 64] >> (material % 64)) & 1ull)
+		{
+			return true;
+		}
+	}
+	for (const rtAABB& bounds : edit.m_bounds)
+	{
+		if (bounds.empty())
+		{
+			continue;
+		}
+		int lo[3], hi[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			lo[axis] = cellCoordinate(rtAxis(bounds.m_min, axis), axis);
+			hi[axis] = cellCoordinate(rtAxis(bounds.m_max, axis), axis);
+		}
+		for (int z = lo[2]; z <= hi[2]; z++)
+		{
+			for (int y = lo[1]; y <= hi[1]; y++)
+			{
+				for (int x = lo[0]; x <= hi[0]; x++)
+				{
+					int cellIndex = (z * kResolution + y) * kResolution + x;
+					if ((record.m_cells[cellIndex / 64] >> (cellIndex % 64)) & 1ull)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+std::vector<rtTile> rtDependencyMap::affectedTiles(const std::vector<rtTile>& tiles, const rtSceneEdit& edit) const
+{
+	bool everything = edit.m_everything || m_bounds.empty();
+	for (const rtAABB& bounds : edit.m_bounds)
+	{
+		everything = everything || (!bounds.empty() && !(m_bounds.contains(bounds.m_min) && m_bounds.contains(bounds.m_max)));
+	}
+	if (everything)
+	{
+		return tiles;
+	}
+
+	std::vector<rtTile> affected;
+	for (const rtTile& tile : tiles)
+	{
+		auto record = m_tiles.find(std::make_pair(tile.m_x0, tile.m_y0));
+		bool recorded = record != m_tiles.end() && record->second.m_tile.m_x1 == tile.m_x1 && record->second.m_tile.m_y1 == tile.m_y1;
+		if (!recorded || affects(record->second, edit))
+		{
+			affected.push_back(tile);
+		}
+	}
+	return affected;
+}
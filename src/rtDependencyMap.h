@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include "rtAABB.h"
+#include "rtTile.h"
+
+// a change to a scene that has been rendered
+struct rtSceneEdit
+{
+	// space moved geometry took before and after the move
+	std::vector<rtAABB> m_bounds;
+	// material indices whose colors or textures changed
+	std::vector<int> m_materials;
+	bool m_lights = false;
+	bool m_background = false;
+	// anything the records can't tell apart, the camera for one
+	bool m_everything = false;
+
+	bool empty() const { return m_bounds.empty() && m_materials.empty() && !m_lights && !m_background && !m_everything; }
+};
+
+// what one tile's rays touched: the coarse cells its primary, secondary and shadow rays
+// crossed, the materials its hits were shaded with, and whether it shows background
+struct rtTileDependencies
+{
+	rtTile m_tile;
+	std::vector<uint64_t> m_cells;
+	std::vector<uint64_t> m_materials;
+	bool m_background = false;
+	bool m_shaded = false;
+};
+
+// per tile records of a frame, for re-tracing only the tiles a scene edit can change.
+// the scene bounds are split into 32^3 cells. a ray crossing a cell doesn't mean it hit
+// anything there, so edits are found conservatively: moving geometry re-traces every tile
+// with a ray through the space it left or entered, including tiles it newly shadows
+class rtDependencyMap
+{
+public:
+	static constexpr int kResolution = 32;
+
+	void reset(const rtAABB& bounds, int materialCount);
+	bool empty() const { return m_tiles.empty(); }
+
+	// clears record for tracing tile
+	void begin(rtTileDependencies& record, const rtTile& tile) const;
+	// the part of the ray from 0 to tMax
+	void addSegment(rtTileDependencies& record, const rtRay& ray, double tMax) const;
+	void addMaterial(rtTileDependencies& record, int material) const;
+	// replaces the record of the same tile
+	void store(const rtTileDependencies& record);
+
+	// the tiles edit may change, tiles that were never recorded included. all of them if
+	// moved geometry reaches outside the recorded bounds, where rays weren't followed
+	std::vector<rtTile> affectedTiles(const std::vector<rtTile>& tiles, const rtSceneEdit& edit) const;
+
+private:
+	int cellCoordinate(double p, int axis) const;
+	bool affects(const rtTileDependencies& record, const rtSceneEdit& edit) const;
+
+	rtAABB m_bounds;
+	double m_cellSize[3] = { 1.0, 1.0, 1.0 };
+	int m_materialCount = 0;
+	std::map<std::pair<int, int>, rtTileDependencies> m_tiles;   // by top left corner
+};
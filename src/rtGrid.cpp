@@ -0,0 +1,100 @@
+#include "rtGrid.h"
+
+static constexpr double CELLS_PER_PRIMITIVE = 2.0;
+static constexpr int MAX_GRID_RESOLUTION = 512;
+static constexpr int MAX_GRID_CELLS = 1 << 24;
+
+int rtGrid::cellCoordinate(double p, int axis) const
+{
+	double offset = (p - rtAxis(m_bounds.m_min, axis)) / m_cellSize[axis];
+	// NaN and rounding past either face land in the border cells
+	if (!(offset > 0.0))
+	{
+		return 0;
+	}
+	return offset < m_resolution[axis] ? static_cast<int>(offset) : m_resolution[axis] - 1;
+}
+
+void rtGrid::build(const std::vector<rtAABB>& primBounds)
+{
+	m_bounds = rtAABB();
+	m_cellStart.clear();
+	m_cellPrims.clear();
+	m_primRanges.assign(primBounds.size(), rtCellRange());
+	for (const rtAABB& bounds : primBounds)
+	{
+		if (!bounds.empty())
+		{
+			m_bounds.expand(bounds);
+		}
+	}
+	if (m_bounds.empty())
+	{
+		return;
+	}
+
+	// cubic cells, flat scenes keep a thin slab of cells on their flat axis
+	double maxExtent = std::max(m_bounds.extent(0), std::max(m_bounds.extent(1), m_bounds.extent(2)));
+	double volume = 1.0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		volume *= std::max(m_bounds.extent(axis), maxExtent / MAX_GRID_RESOLUTION);
+	}
+	double targetCells = std::min(CELLS_PER_PRIMITIVE * primBounds.size(), static_cast<double>(MAX_GRID_CELLS));
+	double cellSize = std::cbrt(volume / targetCells);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int resolution = cellSize > 0.0 ? static_cast<int>(m_bounds.extent(axis) / cellSize) : 1;
+		m_resolution[axis] = std::min(std::max(resolution, 1), MAX_GRID_RESOLUTION);
+		m_cellSize[axis] = m_bounds.extent(axis) > 0.0 ? m_bounds.extent(axis) / m_resolution[axis] : 1.0;
+	}
+
+	// count the references of every cell, turn the counts into starts, then fill
+	m_cellStart.assign(cellCount() + 1, 0);
+	for (size_t i = 0; i < primBounds.size(); i++)
+	{
+		if (primBounds[i].empty())
+		{
+			// an inverted range, no cell ever lists it
+			m_primRanges[i] = { { 1, 1, 1 }, { 0, 0, 0 } };
+			continue;
+		}
+		rtCellRange& range = m_primRanges[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			range.m_min[axis] = static_cast<uint16_t>(cellCoordinate(rtAxis(primBounds[i].m_min, axis), axis));
+			range.m_max[axis] = static_cast<uint16_t>(cellCoordinate(rtAxis(primBounds[i].m_max, axis), axis));
+		}
+		for (int z = range.m_min[2]; z <= range.m_max[2]; z++)
+		{
+			for (int y = range.m_min[1]; y <= range.m_max[1]; y++)
+			{
+				for (int x = range.m_min[0]; x <= range.m_max[0]; x++)
+				{
+					m_cellStart[(z * m_resolution[1] + y) * m_resolution[0] + x + 1]++;
+				}
+			}
+		}
+	}
+	for (int c = 0; c < cellCount(); c++)
+	{
+		m_cellStart[c + 1] += m_cellStart[c];
+	}
+
+	m_cellPrims.resize(m_cellStart[cellCount()]);
+	std::vector<int> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (size_t i = 0; i < primBounds.size(); i++)
+	{
+		const rtCellRange& range = m_primRanges[i];
+		for (int z = range.m_min[2]; z <= range.m_max[2]; z++)
+		{
+			for (int y = range.m_min[1]; y <= range.m_max[1]; y++)
+			{
+				for (int x = range.m_min[0]; x <= range.m_max[0]; x++)
+				{
+					m_cellPrims[fill[(z * m_resolution[1] + y) * m_resolution[0] + x]++] = static_cast<int>(i);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "rtAABB.h"
+
+// uniform grid over an indexed list of primitive bounds, walked with a 3D-DDA. cells list
+// their primitives in one compressed array: cell c owns m_cellPrims[m_cellStart[c] ..
+// m_cellStart[c + 1]). the resolution follows the primitive count, about two cells each
+class rtGrid
+{
+public:
+	void build(const std::vector<rtAABB>& primBounds);
+
+	bool empty() const { return m_cellPrims.empty(); }
+	const rtAABB& bounds() const { return m_bounds; }
+	int cellCount() const { return m_resolution[0] * m_resolution[1] * m_resolution[2]; }
+	size_t referenceCount() const { return m_cellPrims.size(); }
+
+	// same contract as rtBVH::traverse. cells are visited front to back and a primitive that
+	// spans several of them is reported only in the first
+	template <typename Visitor>
+	void traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const;
+
+private:
+	// cells a primitive's bounds overlap, inclusive
+	struct rtCellRange
+	{
+		uint16_t m_min[3];
+		uint16_t m_max[3];
+	};
+
+	int cellCoordinate(double p, int axis) const;
+
+	rtAABB m_bounds;
+	int m_resolution[3] = { 0, 0, 0 };
+	double m_cellSize[3] = { 0.0, 0.0, 0.0 };
+	std::vector<int> m_cellStart;
+	std::vector<int> m_cellPrims;
+	std::vector<rtCellRange> m_primRanges;
+};
+
+template <typename Visitor>
+void rtGrid::traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const
+{
+	if (m_cellPrims.empty())
+	{
+		return;
+	}
+
+	const double origin[3] = { ray.m_origin.m_x, ray.m_origin.m_y, ray.m_origin.m_z };
+	const double direction[3] = { ray.m_direction.m_x, ray.m_direction.m_y, ray.m_direction.m_z };
+
+	// clip the ray to the grid, as rtRayBoxTest does
+	rtRayBoxTest boxTest(ray);
+	double tEntry;
+	if (!boxTest.hit(m_bounds, tMax, tEntry))
+	{
+		return;
+	}
+
+	int cell[3];
+	int step[3];
+	double tNext[3];
+	double tDelta[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = cellCoordinate(origin[axis] + direction[axis] * tEntry, axis);
+		double cellMin = rtAxis(m_bounds.m_min, axis) + cell[axis] * m_cellSize[axis];
+		if (direction[axis] > 0.0)
+		{
+			step[axis] = 1;
+			tNext[axis] = (cellMin + m_cellSize[axis] - origin[axis]) / direction[axis];
+			tDelta[axis] = m_cellSize[axis] / direction[axis];
+		}
+		else if (direction[axis] < 0.0)
+		{
+			step[axis] = -1;
+			tNext[axis] = (cellMin - origin[axis]) / direction[axis];
+			tDelta[axis] = -m_cellSize[axis] / direction[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			tNext[axis] = std::numeric_limits<double>::infinity();
+			tDelta[axis] = std::numeric_limits<double>::infinity();
+		}
+	}
+
+	int previous[3] = { -1, -1, -1 };
+	while (true)
+	{
+		int cellIndex = (cell[2] * m_resolution[1] + cell[1]) * m_resolution[0] + cell[0];
+		for (int i = m_cellStart[cellIndex]; i < m_cellStart[cellIndex + 1]; i++)
+		{
+			int primIndex = m_cellPrims[i];
+			// the cells along a ray that overlap a box are consecutive, so a primitive
+			// that was in the previous cell has been reported already
+			const rtCellRange& range = m_primRanges[primIndex];
+			if (previous[0] >= range.m_min[0] && previous[0] <= range.m_max[0] && previous[1] >= range.m_min[1] && previous[1] <= range.m_max[1]
+				&& previous[2] >= range.m_min[2] && previous[2] <= range.m_max[2])
+			{
+				continue;
+			}
+			if (!visitor(primIndex, tMax))
+			{
+				return;
+			}
+		}
+
+		int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+		// the next cell starts behind the closest hit, or the ray leaves the grid
+		if (tNext[axis] > tMax)
+		{
+			return;
+		}
+		previous[0] = cell[0];
+		previous[1] = cell[1];
+		previous[2] = cell[2];
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= m_resolution[axis])
+		{
+			return;
+		}
+		tNext[axis] += tDelta[axis];
+	}
+}
@@ -0,0 +1,29 @@
+#include "rtGridAccelerator.h"
+
+void rtGridAccelerator::build()
+{
+	m_isa = ActiveInstructionSet();
+	buildMeshes();
+	std::vector<rtAABB> primBounds;
+	computePrimBounds(primBounds);
+	m_sphereCount = static_cast<int>(m_fileInfo->spheres.size());
+	m_triangleCount = TriangleMeshView(*m_fileInfo).faceCount();
+	m_gridCells.build(primBounds);
+}
+
+bool rtGridAccelerator::update()
+{
+	// filling the grid is linear, it is rebuilt every time rather than refit
+	build();
+	return false;
+}
+
+rtAABB rtGridAccelerator::bounds() const
+{
+	return m_gridCells.bounds();
+}
+
+double rtGridAccelerator::sahCost() const
+{
+	return 0.0;
+}
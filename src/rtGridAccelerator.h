@@ -0,0 +1,26 @@
+#pragma once
+#include "rtBVHAccelerator.h"
+#include "rtGrid.h"
+
+// uniform grid over the spheres, the scene's triangles and the mesh instance boxes, for scenes
+// of many evenly spread primitives of similar size. instanced meshes keep their bottom rtBVHs
+class rtGridAccelerator : public rtBVHAccelerator
+{
+public:
+	rtGridAccelerator(const std::shared_ptr<ObjFileInfo>& fileInfo, eBVHBuild method = eBVHBuild::kMedian, int threads = 1)
+		: rtBVHAccelerator(fileInfo, 2, method, threads)
+	{
+		// the queries walk the grid in place of the top level tree
+		m_grid = &m_gridCells;
+	}
+
+	void build() override;
+	bool update() override;
+
+	rtAABB bounds() const override;
+	// 0, a grid has no tree cost
+	double sahCost() const override;
+
+private:
+	rtGrid m_gridCells;
+};
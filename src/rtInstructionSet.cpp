@@ -0,0 +1,116 @@
+#include "rtInstructionSet.h"
+#include <atomic>
+#include <cstdint>
+#if RT_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#elif RT_X86
+#include <cpuid.h>
+#endif
+
+static const char* const SET_NAMES[] = { "generic", "sse4", "avx2", "avx512" };
+
+// -1 until detected or set
+static std::atomic<int> s_activeSet{ -1 };
+
+bool ParseInstructionSet(const std::string& name, eInstructionSet& set)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(SET_NAMES) / sizeof(SET_NAMES[0])); i++)
+	{
+		if (name == SET_NAMES[i])
+		{
+			set = static_cast<eInstructionSet>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* InstructionSetName(eInstructionSet set)
+{
+	return SET_NAMES[static_cast<int>(set)];
+}
+
+#if RT_X86
+static void Cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (int i = 0; i < 4; i++)
+	{
+		regs[i] = static_cast<unsigned>(info[i]);
+	}
+#else
+	if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	}
+#endif
+}
+
+// register state the operating system saves on context switches
+static uint64_t EnabledStateMask()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+#endif
+
+eInstructionSet DetectInstructionSet()
+{
+#if RT_X86
+	unsigned regs[4];
+	Cpuid(0, 0, regs);
+	unsigned maxLeaf = regs[0];
+	Cpuid(1, 0, regs);
+	unsigned features = regs[2];
+	bool sse4 = (features & (1u << 19)) && (features & (1u << 20));
+	if (!sse4)
+	{
+		return eInstructionSet::kGeneric;
+	}
+	// ymm state needs osxsave and the os enabling xmm and ymm saving
+	bool osAvx = (features & (1u << 27)) && (features & (1u << 28)) && (EnabledStateMask() & 0x6) == 0x6;
+	if (!osAvx || maxLeaf < 7)
+	{
+		return eInstructionSet::kSSE4;
+	}
+	Cpuid(7, 0, regs);
+	unsigned extended = regs[1];
+	if (!(extended & (1u << 5)))
+	{
+		return eInstructionSet::kSSE4;
+	}
+	// zmm state adds the opmask and upper zmm registers
+	bool avx512 = (extended & (1u << 16)) && (EnabledStateMask() & 0xe6) == 0xe6;
+	return avx512 ? eInstructionSet::kAVX512 : eInstructionSet::kAVX2;
+#else
+	return eInstructionSet::kGeneric;
+#endif
+}
+
+bool InstructionSetSupported(eInstructionSet set)
+{
+	return static_cast<int>(set) <= static_cast<int>(DetectInstructionSet());
+}
+
+eInstructionSet ActiveInstructionSet()
+{
+	int set = s_activeSet.load();
+	if (set < 0)
+	{
+		set = static_cast<int>(DetectInstructionSet());
+		s_activeSet = set;
+	}
+	return static_cast<eInstructionSet>(set);
+}
+
+void SetActiveInstructionSet(eInstructionSet set)
+{
+	s_activeSet = static_cast<int>(set);
+}
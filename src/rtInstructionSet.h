@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+
+// instruction sets the hot kernels are compiled for, each a superset of the one before
+enum class eInstructionSet
+{
+	kGeneric,
+	kSSE4,
+	kAVX2,
+	kAVX512,
+};
+
+bool ParseInstructionSet(const std::string& name, eInstructionSet& set);
+const char* InstructionSetName(eInstructionSet set);
+
+// the best set the cpu and the operating system support, asked with cpuid once
+eInstructionSet DetectInstructionSet();
+bool InstructionSetSupported(eInstructionSet set);
+// the set the kernels dispatch to, detected unless set before the scene is built
+eInstructionSet ActiveInstructionSet();
+void SetActiveInstructionSet(eInstructionSet set);
+
+// marks a kernel entry point to be compiled for one set. flatten inlines everything the entry
+// calls, so the whole kernel is compiled for that set while the rest of the binary stays generic.
+// the build turns fp contraction off so every variant rounds alike. MSVC compiles every variant
+// the same and only the explicit vector paths differ
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_X86 1
+#define RT_TARGET_SSE4 __attribute__((target("sse4.2"), flatten))
+#define RT_TARGET_AVX2 __attribute__((target("avx2"), flatten))
+#define RT_TARGET_AVX512 __attribute__((target("avx512f"), flatten))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define RT_X86 1
+#define RT_TARGET_SSE4
+#define RT_TARGET_AVX2
+#define RT_TARGET_AVX512
+#else
+#define RT_X86 0
+#define RT_TARGET_SSE4
+#define RT_TARGET_AVX2
+#define RT_TARGET_AVX512
+#endif
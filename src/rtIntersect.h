@@ -0,0 +1,112 @@
+#pragma once
+#include <cmath>
+#include "rtRay.h"
+#include "rtSphere.h"
+
+static constexpr double EPSILON = 0.00000005;
+
+// nearest root of the ray/sphere quadratic in (0, tMax), the ray direction is expected to be normalised
+inline bool IntersectSphere(const rtSphere& sphere, const rtRay& ray, double tMax, double& t)
+{
+	double distanceX = ray.m_origin.m_x - sphere.m_center.m_x;
+	double distanceY = ray.m_origin.m_y - sphere.m_center.m_y;
+	double distanceZ = ray.m_origin.m_z - sphere.m_center.m_z;
+
+	double B = 2.0 * (ray.m_direction.m_x * distanceX + ray.m_direction.m_y * distanceY + ray.m_direction.m_z * distanceZ);
+	double C = distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ - sphere.m_radius * sphere.m_radius;
+	double delta = B * B - 4.0 * C;
+
+	if (delta == 0.0)
+	{
+		double tempT = (-B) / 2.0;
+		if (tempT < tMax && tempT > 0)
+		{
+			t = tempT;
+			return true;
+		}
+		return false;
+	}
+
+	if (delta < 0.0)
+	{
+		return false;
+	}
+
+	double tempT1 = (std::sqrt(delta) - B) / 2.0;
+	double tempT2 = (-std::sqrt(delta) - B) / 2.0;
+	bool isHit = false;
+	if (tempT1 < tMax && tempT1 > 0)
+	{
+		tMax = tempT1;
+		isHit = true;
+	}
+	if (tempT2 < tMax && tempT2 > 0)
+	{
+		tMax = tempT2;
+		isHit = true;
+	}
+	t = tMax;
+	return isHit;
+}
+
+// true if the sphere is crossed anywhere in (0, maxT), tangent rays don't cast shadows
+inline bool SphereBlocksSegment(const rtSphere& sphere, const rtRay& ray, double maxT)
+{
+	double distanceX = ray.m_origin.m_x - sphere.m_center.m_x;
+	double distanceY = ray.m_origin.m_y - sphere.m_center.m_y;
+	double distanceZ = ray.m_origin.m_z - sphere.m_center.m_z;
+
+	double B = 2.0 * (ray.m_direction.m_x * distanceX + ray.m_direction.m_y * distanceY + ray.m_direction.m_z * distanceZ);
+	double C = distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ - sphere.m_radius * sphere.m_radius;
+	double delta = B * B - 4.0 * C;
+	if (delta <= 0.0)
+	{
+		return false;
+	}
+
+	double tempT1 = (std::sqrt(delta) - B) / 2.0;
+	double tempT2 = (-std::sqrt(delta) - B) / 2.0;
+	return (tempT1 > 0 && tempT1 < maxT) || (tempT2 > 0 && tempT2 < maxT);
+}
+
+// plane hit in [0, tMax] followed by the barycentric area test,
+// normal is the unnormalised geometric normal used for flat shading
+inline bool IntersectTriangle(const rtPoint& firstVertex, const rtPoint& secondVertex, const rtPoint& thirdVertex, const rtRay& ray, double tMax,
+							  double& t, double& alpha, double& beta, double& gamma, rtVector3& normal)
+{
+	rtVector3 e1 = secondVertex.subtract(firstVertex);
+	rtVector3 e2 = thirdVertex.subtract(firstVertex);
+	normal = rtVector3::crossProduct(e1, e2);
+	double A = normal.m_x;
+	double B = normal.m_y;
+	double C = normal.m_z;
+	double D = -(firstVertex.m_x * A + firstVertex.m_y * B + firstVertex.m_z * C);
+	double deterimint = A * ray.m_direction.m_x + B * ray.m_direction.m_y + C * ray.m_direction.m_z;
+
+	// check if the ray is parallel to the surface
+	if (deterimint <= EPSILON && deterimint >= -EPSILON)
+	{
+		return false;
+	}
+	double tTri = -(A * ray.m_origin.m_x + B * ray.m_origin.m_y + C * ray.m_origin.m_z + D) / deterimint;
+	if (tTri < 0.0 || tTri > tMax)
+	{
+		return false;
+	}
+
+	rtPoint hitPoint = rtPoint::add(ray.m_origin, ray.m_direction.scale(tTri));
+	rtVector3 e3 = hitPoint.subtract(secondVertex);
+	rtVector3 e4 = hitPoint.subtract(thirdVertex);
+	double totalArea = rtVector3::area(e1, e2);
+	alpha = rtVector3::area(e3, e4) / totalArea;
+	beta = rtVector3::area(e4, e2) / totalArea;
+	gamma = rtVector3::area(e1, e3) / totalArea;
+
+	// determine Barycentric coordinates
+	if (alpha < 1 && alpha > 0 && beta < 1 && beta > 0 && gamma > 0 && gamma < 1 && alpha + beta + gamma - 1 < EPSILON)
+	{
+		t = tTri;
+		return true;
+	}
+	return false;
+}
@@ -46,7 +46,7 @@ public:
 		m_vec3.m_z = v.m_z;
 	}
 
-	eLightType getType()
+	eLightType getType() const
 	{
 		return m_type;
 	}
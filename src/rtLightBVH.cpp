@@ -0,0 +1,138 @@
+#include "rtLightBVH.h"
+#include <algorithm>
+#include <cmath>
+#include <corecrt_math_defines.h>
+
+// cones this wide are bounded like a sphere
+static constexpr double MAX_BOXED_CONE_DEGREES = 80.0;
+static constexpr double CONE_SLACK = 1e-9;
+
+// distance past which 1 / (c1 + c2 d + c3 d^2) stays below cutoff, infinity if it never does.
+// shading scales a material's response by the attenuation, so the light then leaves less than
+// cutoff of any material's response
+static double AttenuationRadius(const rtLight& light, double cutoff)
+{
+	if (cutoff <= 0.0 || light.m_c2 < 0.0 || light.m_c3 < 0.0)
+	{
+		return INFINITY;
+	}
+	double a = 1.0 / cutoff - light.m_c1;
+	if (a <= 0.0)
+	{
+		return 0.0;
+	}
+	if (light.m_c3 > 0.0)
+	{
+		return (-light.m_c2 + std::sqrt(light.m_c2 * light.m_c2 + 4.0 * light.m_c3 * a)) / (2.0 * light.m_c3);
+	}
+	if (light.m_c2 > 0.0)
+	{
+		return a / light.m_c2;
+	}
+	return INFINITY;
+}
+
+static double FarthestCornerDistance(const rtPoint& p, const rtAABB& box)
+{
+	double dx = std::max(std::abs(p.m_x - box.m_min.m_x), std::abs(p.m_x - box.m_max.m_x));
+	double dy = std::max(std::abs(p.m_y - box.m_min.m_y), std::abs(p.m_y - box.m_max.m_y));
+	double dz = std::max(std::abs(p.m_z - box.m_min.m_z), std::abs(p.m_z - box.m_max.m_z));
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void rtLightBVH::build(const std::vector<rtLight>& lights, const rtAABB& sceneBounds, double cutoff)
+{
+	m_lightCount = static_cast<int>(lights.size());
+	m_unboundedLights.clear();
+	m_bounded.clear();
+
+	// hit points are rounded onto the surfaces, give the scene box some slack
+	double pad = 1e-6 * (1.0 + std::max(sceneBounds.extent(0), std::max(sceneBounds.extent(1), sceneBounds.extent(2))));
+	rtAABB scene(rtPoint(sceneBounds.m_min.m_x - pad, sceneBounds.m_min.m_y - pad, sceneBounds.m_min.m_z - pad),
+		rtPoint(sceneBounds.m_max.m_x + pad, sceneBounds.m_max.m_y + pad, sceneBounds.m_max.m_z + pad));
+
+	std::vector<rtAABB> influence;
+	for (int i = 0; i < m_lightCount; i++)
+	{
+		const rtLight& light = lights[i];
+		eLightType type = light.getType();
+		bool isSpot = type == eLightType::kSpotlight || type == eLightType::kAttSpotlight;
+		bool isPoint = type == eLightType::kPointLight || type == eLightType::kAttPointLight;
+		if (!isSpot && !isPoint)
+		{
+			m_unboundedLights.push_back(i);
+			continue;
+		}
+
+		double radius = AttenuationRadius(light, cutoff);
+		if (!isSpot && std::isinf(radius))
+		{
+			m_unboundedLights.push_back(i);
+			continue;
+		}
+		if (scene.empty())
+		{
+			continue;
+		}
+
+		rtBoundedLight bounded;
+		bounded.m_lightIndex = i;
+		bounded.m_center = light.m_center;
+		bounded.m_radiusSquared = radius * radius;
+
+		double reach = std::min(radius, FarthestCornerDistance(light.m_center, scene));
+		rtVector3 r(reach, reach, reach);
+		rtAABB box(rtPoint::add(light.m_center, r.scale(-1.0)), rtPoint::add(light.m_center, r));
+		if (isSpot)
+		{
+			bounded.m_axis = light.m_vec3.getTwoNorm();
+			bounded.m_cosCone = std::cos(light.m_theta * M_PI / 180.0) - CONE_SLACK;
+			if (light.m_theta < MAX_BOXED_CONE_DEGREES)
+			{
+				// apex plus the cap disc at the reach along the axis
+				double capRadius = reach * std::tan(light.m_theta * M_PI / 180.0);
+				rtPoint capCenter = rtPoint::add(light.m_center, bounded.m_axis.scale(reach));
+				const rtVector3& d = bounded.m_axis;
+				rtVector3 e(capRadius * std::sqrt(std::max(0.0, 1.0 - d.m_x * d.m_x)), capRadius * std::sqrt(std::max(0.0, 1.0 - d.m_y * d.m_y)), capRadius * std::sqrt(std::max(0.0, 1.0 - d.m_z * d.m_z)));
+				rtAABB cone(rtPoint::add(capCenter, e.scale(-1.0)), rtPoint::add(capCenter, e));
+				cone.expand(light.m_center);
+				box = box.intersect(cone);
+			}
+		}
+		box = box.intersect(scene);
+		if (box.empty() || radius <= 0.0)
+		{
+			// never reaches anything in the scene
+			continue;
+		}
+		m_bounded.push_back(bounded);
+		influence.push_back(box);
+	}
+	m_bvh.build(influence);
+}
+
+void rtLightBVH::gather(const rtPoint& p, std::vector<int>& lights) const
+{
+	lights.assign(m_unboundedLights.begin(), m_unboundedLights.end());
+	size_t unbounded = lights.size();
+	m_bvh.query(p, [&](int boundedIndex)
+	{
+		const rtBoundedLight& light = m_bounded[boundedIndex];
+		rtVector3 toPoint = p.subtract(light.m_center);
+		double distanceSquared = rtVector3::dotProduct(toPoint, toPoint);
+		if (distanceSquared > light.m_radiusSquared)
+		{
+			return;
+		}
+		if (light.m_cosCone > -1.0 && rtVector3::dotProduct(light.m_axis, toPoint) < light.m_cosCone * std::sqrt(distanceSquared))
+		{
+			return;
+		}
+		lights.push_back(light.m_lightIndex);
+	});
+	if (lights.size() > unbounded)
+	{
+		// shading sums the lights in scene order, keep results independent of the tree layout
+		std::sort(lights.begin(), lights.end());
+	}
+}
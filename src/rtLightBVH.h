@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "rtBVH.h"
+#include "rtLight.h"
+
+// culls lights that can't reach a shading point before any shadow ray is cast.
+// a light's influence is its spotlight cone, cut off at the distance where attenuation leaves
+// less than cutoff of a material's response, and clipped to the scene bounds.
+// lights without a bounded influence are candidates everywhere, the others sit in a bvh
+class rtLightBVH
+{
+public:
+	// cutoff is a fraction (0..1) of the response, 0 never culls by distance
+	void build(const std::vector<rtLight>& lights, const rtAABB& sceneBounds, double cutoff);
+
+	// replaces lights with the indices of the lights that may reach p, in ascending order
+	void gather(const rtPoint& p, std::vector<int>& lights) const;
+
+	int lightCount() const { return m_lightCount; }
+	int unboundedCount() const { return static_cast<int>(m_unboundedLights.size()); }
+	int boundedCount() const { return static_cast<int>(m_bounded.size()); }
+
+private:
+	struct rtBoundedLight
+	{
+		int m_lightIndex = -1;
+		rtPoint m_center;
+		double m_radiusSquared = 0.0;
+		rtVector3 m_axis;          // unit cone axis, zero for point lights
+		double m_cosCone = -1.0;   // loosened a little so the cull never disagrees with shading
+	};
+
+	int m_lightCount = 0;
+	std::vector<int> m_unboundedLights;
+	std::vector<rtBoundedLight> m_bounded;
+	rtBVH m_bvh;
+};
@@ -0,0 +1,75 @@
+#include "rtLightSet.h"
+#include <cmath>
+#include <corecrt_math_defines.h>
+
+void rtLightCandidates::reserve(size_t count)
+{
+	for (std::vector<int>& indices : m_byType)
+	{
+		indices.reserve(count);
+	}
+	m_sceneIndices.reserve(count);
+}
+
+void rtLightSet::build(const std::vector<rtLight>& lights, const rtAABB& sceneBounds, double cutoff)
+{
+	m_directional.clear();
+	m_point.clear();
+	m_attPoint.clear();
+	m_spot.clear();
+	m_attSpot.clear();
+	m_slots.assign(lights.size(), rtLightSlot());
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const rtLight& light = lights[i];
+		rtLightSlot& slot = m_slots[i];
+		slot.m_type = light.getType();
+		switch (light.getType())
+		{
+		case eLightType::kDirectionalLight:
+			slot.m_index = static_cast<int>(m_directional.size());
+			m_directional.push_back({ rtVector3(-light.m_vec3.m_x, -light.m_vec3.m_y, -light.m_vec3.m_z).getTwoNorm() });
+			break;
+		case eLightType::kPointLight:
+			slot.m_index = static_cast<int>(m_point.size());
+			m_point.push_back({ light.m_center });
+			break;
+		case eLightType::kAttPointLight:
+			slot.m_index = static_cast<int>(m_attPoint.size());
+			m_attPoint.push_back({ light.m_center, light.m_c1, light.m_c2, light.m_c3 });
+			break;
+		case eLightType::kSpotlight:
+			slot.m_index = static_cast<int>(m_spot.size());
+			m_spot.push_back({ light.m_center, light.m_vec3.getTwoNorm(), std::cos(light.m_theta * M_PI / 180.0) });
+			break;
+		case eLightType::kAttSpotlight:
+			slot.m_index = static_cast<int>(m_attSpot.size());
+			m_attSpot.push_back({ light.m_center, light.m_vec3.getTwoNorm(), std::cos(light.m_theta * M_PI / 180.0), light.m_c1, light.m_c2, light.m_c3 });
+			break;
+		default:
+			// lights of unknown type never lit anything
+			break;
+		}
+	}
+
+	m_culling.build(lights, sceneBounds, cutoff);
+}
+
+void rtLightSet::gather(const rtPoint& p, rtLightCandidates& candidates) const
+{
+	for (std::vector<int>& indices : candidates.m_byType)
+	{
+		indices.clear();
+	}
+
+	m_culling.gather(p, candidates.m_sceneIndices);
+	for (int lightIndex : candidates.m_sceneIndices)
+	{
+		const rtLightSlot& slot = m_slots[lightIndex];
+		if (slot.m_index >= 0)
+		{
+			candidates.m_byType[static_cast<int>(slot.m_type)].push_back(slot.m_index);
+		}
+	}
+}
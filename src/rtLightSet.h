@@ -0,0 +1,142 @@
+#pragma once
+#include <limits>
+#include <vector>
+#include "rtLight.h"
+#include "rtLightBVH.h"
+
+// lights preprocessed once per scene: every type keeps its own array with the constants
+// shading needs already derived, so shading runs one kernel per type without a switch
+template <eLightType Type> struct rtLightData;
+
+template <> struct rtLightData<eLightType::kDirectionalLight>
+{
+	rtVector3 m_toLight;     // unit vector against the light's direction
+};
+
+template <> struct rtLightData<eLightType::kPointLight>
+{
+	rtPoint m_center;
+};
+
+template <> struct rtLightData<eLightType::kAttPointLight>
+{
+	rtPoint m_center;
+	double m_c1, m_c2, m_c3;
+};
+
+template <> struct rtLightData<eLightType::kSpotlight>
+{
+	rtPoint m_center;
+	rtVector3 m_axis;        // unit
+	double m_cosTheta;
+};
+
+template <> struct rtLightData<eLightType::kAttSpotlight>
+{
+	rtPoint m_center;
+	rtVector3 m_axis;
+	double m_cosTheta;
+	double m_c1, m_c2, m_c3;
+};
+
+// direction to the light from p, the distance a shadow ray has to clear and the attenuation.
+// false if p is outside the light
+template <eLightType Type>
+bool Illuminate(const rtLightData<Type>& light, const rtPoint& p, rtVector3& lightDir, double& maxT, double& fatt);
+
+template <>
+inline bool Illuminate(const rtLightData<eLightType::kDirectionalLight>& light, const rtPoint&, rtVector3& lightDir, double& maxT, double& fatt)
+{
+	lightDir = light.m_toLight;
+	maxT = std::numeric_limits<double>::infinity();
+	fatt = 1.0;
+	return true;
+}
+
+template <>
+inline bool Illuminate(const rtLightData<eLightType::kPointLight>& light, const rtPoint& p, rtVector3& lightDir, double& maxT, double& fatt)
+{
+	lightDir = light.m_center.subtract(p);
+	maxT = lightDir.length();
+	lightDir.twoNorm();
+	fatt = 1.0;
+	return true;
+}
+
+template <>
+inline bool Illuminate(const rtLightData<eLightType::kAttPointLight>& light, const rtPoint& p, rtVector3& lightDir, double& maxT, double& fatt)
+{
+	lightDir = light.m_center.subtract(p);
+	maxT = lightDir.length();
+	lightDir.twoNorm();
+	fatt = 1.0 / (light.m_c1 + light.m_c2 * maxT + light.m_c3 * maxT * maxT);
+	return true;
+}
+
+template <>
+inline bool Illuminate(const rtLightData<eLightType::kSpotlight>& light, const rtPoint& p, rtVector3& lightDir, double& maxT, double& fatt)
+{
+	lightDir = light.m_center.subtract(p);
+	maxT = lightDir.length();
+	lightDir.twoNorm();
+	// the unit vector from the light to p is -lightDir
+	if (-rtVector3::dotProduct(light.m_axis, lightDir) < light.m_cosTheta)
+	{
+		return false;
+	}
+	fatt = 1.0;
+	return true;
+}
+
+template <>
+inline bool Illuminate(const rtLightData<eLightType::kAttSpotlight>& light, const rtPoint& p, rtVector3& lightDir, double& maxT, double& fatt)
+{
+	lightDir = light.m_center.subtract(p);
+	maxT = lightDir.length();
+	lightDir.twoNorm();
+	if (-rtVector3::dotProduct(light.m_axis, lightDir) < light.m_cosTheta)
+	{
+		return false;
+	}
+	fatt = 1.0 / (light.m_c1 + light.m_c2 * maxT + light.m_c3 * maxT * maxT);
+	return true;
+}
+
+static constexpr int LIGHT_TYPE_COUNT = static_cast<int>(eLightType::kUndefined);
+
+// per type indices of the lights that may reach a shading point
+struct rtLightCandidates
+{
+	void reserve(size_t count);
+	const std::vector<int>& ofType(eLightType type) const { return m_byType[static_cast<int>(type)]; }
+
+	std::vector<int> m_byType[LIGHT_TYPE_COUNT];
+	std::vector<int> m_sceneIndices;
+};
+
+class rtLightSet
+{
+public:
+	void build(const std::vector<rtLight>& lights, const rtAABB& sceneBounds, double cutoff);
+
+	// lights that may reach p, each type in scene order
+	void gather(const rtPoint& p, rtLightCandidates& candidates) const;
+
+	const rtLightBVH& culling() const { return m_culling; }
+
+	std::vector<rtLightData<eLightType::kDirectionalLight>> m_directional;
+	std::vector<rtLightData<eLightType::kPointLight>> m_point;
+	std::vector<rtLightData<eLightType::kAttPointLight>> m_attPoint;
+	std::vector<rtLightData<eLightType::kSpotlight>> m_spot;
+	std::vector<rtLightData<eLightType::kAttSpotlight>> m_attSpot;
+
+private:
+	struct rtLightSlot
+	{
+		eLightType m_type = eLightType::kUndefined;
+		int m_index = -1;
+	};
+
+	std::vector<rtLightSlot> m_slots;
+	rtLightBVH m_culling;
+};
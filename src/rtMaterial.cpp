@@ -24,7 +24,7 @@ void rtMaterial::setMtlProperties(double _odr, double _odg, double _odb, double
 	m_eta = _eta;
 }
 
-std::string rtMaterial::getTextureFile()
+const std::string& rtMaterial::getTextureFile() const
 {
 	return m_textureFilePath;
 }
\ No newline at end of file
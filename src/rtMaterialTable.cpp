@@ -0,0 +1,71 @@
+#include "rtMaterialTable.h"
+#include "PpmFileReader.h"
+#include <filesystem>
+#include <map>
+#include <memory>
+
+rtTexture rtMaterialTable::loadTexture(const std::string& textureDir, const std::string& fileName)
+{
+	auto fullPath = (std::filesystem::path(textureDir) / fileName).string();
+	std::unique_ptr<ppmFileReader> ppmFileReaderInstance = std::make_unique<ppmFileReader>(fullPath);
+	std::vector<rtColor> texture;
+	rtVector2<int> size;
+	ppmFileReaderInstance->getTextureArray(texture, size);
+	return rtTexture(texture, size);
+}
+
+std::shared_ptr<rtMaterialTable> rtMaterialTable::replicate() const
+{
+	auto replica = std::make_shared<rtMaterialTable>();
+	replica->m_records = m_records;
+	for (const std::shared_ptr<const rtTexture>& texture : m_textures)
+	{
+		replica->m_textures.push_back(std::make_shared<const rtTexture>(*texture));
+	}
+	return replica;
+}
+
+void rtMaterialTable::build(const std::vector<rtMaterial>& materials, const std::string& textureDir, const rtDecodedTextures& decoded)
+{
+	std::map<std::string, int> handles;
+	m_records.assign(materials.size(), rtMaterialRecord());
+	m_textures.clear();
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		const rtMaterial& material = materials[i];
+		rtMaterialRecord& record = m_records[i];
+
+		record.m_ambient = rtColor(material.m_ka * material.m_odr, material.m_ka * material.m_odg, material.m_ka * material.m_odb);
+		record.m_diffuse = rtColor(material.m_kd * material.m_odr, material.m_kd * material.m_odg, material.m_kd * material.m_odb);
+		record.m_specular = rtColor(material.m_ks * material.m_osr, material.m_ks * material.m_osg, material.m_ks * material.m_osb);
+		record.m_ka = material.m_ka;
+		record.m_kd = material.m_kd;
+		record.m_falloff = material.m_falloff;
+		record.m_alpha = material.m_alpha;
+		record.m_eta = material.m_eta;
+
+		if (material.m_alpha == 1.0)
+		{
+			record.m_flags |= rtMaterialRecord::kOpaque;
+		}
+		if (record.m_specular.m_r != 0.0 || record.m_specular.m_g != 0.0 || record.m_specular.m_b != 0.0)
+		{
+			record.m_flags |= rtMaterialRecord::kSpecular;
+		}
+
+		const std::string& texName = material.getTextureFile();
+		if (texName.empty())
+		{
+			continue;
+		}
+		auto found = handles.find(texName);
+		if (found == handles.end())
+		{
+			found = handles.emplace(texName, static_cast<int>(m_textures.size())).first;
+			auto ready = decoded.find(texName);
+			m_textures.push_back(ready != decoded.end() ? ready->second : std::make_shared<const rtTexture>(loadTexture(textureDir, texName)));
+		}
+		record.m_texture = found->second;
+		record.m_flags |= rtMaterialRecord::kTextured;
+	}
+}
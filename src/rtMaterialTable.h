@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rtMaterial.h"
+#include "rtTexture.h"
+
+// a material as shading reads it: the products of the coefficients with the colors are
+// taken once per scene, and one record spans exactly two cache lines
+struct alignas(64) rtMaterialRecord
+{
+	enum eFlags : uint32_t
+	{
+		kOpaque = 1,     // alpha is 1, no light passes through, no transmission ray is needed
+		kSpecular = 2,   // has a specular highlight, otherwise the falloff power is never taken
+		kTextured = 4,   // the diffuse color comes from m_texture
+	};
+
+	bool is(eFlags flag) const { return (m_flags & flag) != 0; }
+
+	rtColor m_ambient;      // ka * od
+	rtColor m_diffuse;      // kd * od
+	rtColor m_specular;     // ks * os
+	double m_ka;            // to weigh texels, which replace od
+	double m_kd;
+	double m_falloff;
+	double m_alpha;
+	double m_eta;
+	int m_texture = -1;
+	uint32_t m_flags = 0;
+};
+static_assert(sizeof(rtMaterialRecord) == 128, "a material record should fill two cache lines");
+
+// decoded textures by file name. tables built from the same map share them
+using rtDecodedTextures = std::map<std::string, std::shared_ptr<const rtTexture>>;
+
+// read-only after build, shared by every thread and job instance
+class rtMaterialTable
+{
+public:
+	// loads every texture once, materials sharing a texture file share the handle. textures
+	// already in decoded, by file name, are taken from there
+	void build(const std::vector<rtMaterial>& materials, const std::string& textureDir, const rtDecodedTextures& decoded = {});
+	// empty if the file can't be read
+	static rtTexture loadTexture(const std::string& textureDir, const std::string& fileName);
+	// a copy that owns copies of the textures too, in memory the calling thread touches first
+	std::shared_ptr<rtMaterialTable> replicate() const;
+
+	const rtMaterialRecord& operator[](int index) const { return m_records[index]; }
+	const rtTexture& texture(int handle) const { return *m_textures[handle]; }
+	const std::shared_ptr<const rtTexture>& sharedTexture(int handle) const { return m_textures[handle]; }
+	size_t size() const { return m_records.size(); }
+
+private:
+	std::vector<rtMaterialRecord> m_records;
+	std::vector<std::shared_ptr<const rtTexture>> m_textures;
+};
@@ -0,0 +1,130 @@
+#include "rtNumaTopology.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+static const char* const POLICY_NAMES[] = { "off", "pin", "replicate" };
+
+bool ParseNumaPolicy(const std::string& name, eNumaPolicy& policy)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0])); i++)
+	{
+		if (name == POLICY_NAMES[i])
+		{
+			policy = static_cast<eNumaPolicy>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* NumaPolicyName(eNumaPolicy policy)
+{
+	return POLICY_NAMES[static_cast<int>(policy)];
+}
+
+#ifdef __linux__
+// "0-3,8,10-11" as sysfs writes cpu lists
+static std::vector<int> ParseCpuList(const std::string& list)
+{
+	std::vector<int> cpus;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ','))
+	{
+		int first = 0, last = 0;
+		size_t dash = range.find('-');
+		try
+		{
+			first = std::stoi(range.substr(0, dash));
+			last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		}
+		catch (...)
+		{
+			continue;
+		}
+		for (int cpu = first; cpu <= last; cpu++)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+#endif
+
+rtNumaTopology rtNumaTopology::detect()
+{
+	rtNumaTopology topology;
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool haveAllowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+	{
+		std::string name = entry.path().filename().string();
+		if (name.compare(0, 4, "node") != 0 || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+		{
+			continue;
+		}
+		std::ifstream file(entry.path() / "cpulist");
+		std::string list;
+		std::getline(file, list);
+
+		rtNumaNode node;
+		node.m_id = std::stoi(name.substr(4));
+		for (int cpu : ParseCpuList(list))
+		{
+			if (!haveAllowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+			{
+				node.m_cpus.push_back(cpu);
+			}
+		}
+		// memory only nodes and nodes outside the affinity mask run no threads
+		if (!node.m_cpus.empty())
+		{
+			topology.m_nodes.push_back(node);
+		}
+	}
+	std::sort(topology.m_nodes.begin(), topology.m_nodes.end(), [](const rtNumaNode& a, const rtNumaNode& b) { return a.m_id < b.m_id; });
+#endif
+	if (topology.m_nodes.empty())
+	{
+		topology.m_nodes.push_back(rtNumaNode());
+	}
+	return topology;
+}
+
+std::vector<rtThreadPlacement> rtNumaTopology::place(int threadCount) const
+{
+	std::vector<rtThreadPlacement> placement(threadCount);
+	int nodeCount = static_cast<int>(m_nodes.size());
+	for (int i = 0; i < threadCount; i++)
+	{
+		const rtNumaNode& node = m_nodes[i % nodeCount];
+		placement[i].m_node = i % nodeCount;
+		placement[i].m_cpu = node.m_cpus.empty() ? -1 : node.m_cpus[(i / nodeCount) % node.m_cpus.size()];
+	}
+	return placement;
+}
+
+bool rtNumaTopology::pinThisThread(int cpu)
+{
+#ifdef __linux__
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+	{
+		return false;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// how render threads use a machine with several memory nodes. pin spreads the threads over
+// the nodes and binds each to one cpu, replicate also gives every node its own copy of the
+// read-only scene, allocated by a thread on that node so its pages are local
+enum class eNumaPolicy
+{
+	kOff,
+	kPin,
+	kReplicate,
+};
+
+bool ParseNumaPolicy(const std::string& name, eNumaPolicy& policy);
+const char* NumaPolicyName(eNumaPolicy policy);
+
+struct rtNumaNode
+{
+	int m_id = 0;
+	std::vector<int> m_cpus;   // only cpus this process may run on
+};
+
+// node (index into rtNumaTopology::nodes()) and cpu of one render thread
+struct rtThreadPlacement
+{
+	int m_node = 0;
+	int m_cpu = -1;
+};
+
+class rtNumaTopology
+{
+public:
+	// the memory nodes of /sys/devices/system/node on Linux. elsewhere, or without that
+	// directory, a single node whose cpus are unknown
+	static rtNumaTopology detect();
+
+	const std::vector<rtNumaNode>& nodes() const { return m_nodes; }
+	// threads are dealt to the nodes in turn, so any thread count uses every node, and to the
+	// cpus of a node in order. cpus are shared once there are more threads than cpus
+	std::vector<rtThreadPlacement> place(int threadCount) const;
+
+	// binds the calling thread to cpu, false where that is not supported
+	static bool pinThisThread(int cpu);
+
+private:
+	std::vector<rtNumaNode> m_nodes;
+};
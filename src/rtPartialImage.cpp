@@ -0,0 +1,114 @@
+#include "rtPartialImage.h"
+#include "PpmFileWriter.h"
+#include <fstream>
+#include <iostream>
+
+static const char* PARTIAL_MAGIC = "RTPART";
+static constexpr int PARTIAL_VERSION = 1;
+
+bool rtPartialImage::write(const std::string& fileName, const rtVector2<int>& imageSize, const std::vector<rtTile>& tiles, const std::vector<std::vector<rtColor>>& pixels)
+{
+	std::ofstream outfile(fileName);
+	if (outfile.fail())
+	{
+		std::cout << "Can't write partial image: " << fileName << std::endl;
+		return false;
+	}
+
+	outfile << PARTIAL_MAGIC << ' ' << PARTIAL_VERSION << '\n';
+	outfile << imageSize.m_x << ' ' << imageSize.m_y << '\n';
+	outfile << tiles.size() << '\n';
+	for (const rtTile& tile : tiles)
+	{
+		outfile << tile.m_x0 << ' ' << tile.m_y0 << ' ' << tile.m_x1 << ' ' << tile.m_y1 << '\n';
+		for (int j = tile.m_y0; j < tile.m_y1; j++)
+		{
+			for (int i = tile.m_x0; i < tile.m_x1; i++)
+			{
+				rtColor pixel = pixels[i][j];
+				outfile << pixel.rtoi() << ' ' << pixel.gtoi() << ' ' << pixel.btoi() << ' ';
+			}
+			outfile << '\n';
+		}
+	}
+	outfile.close();
+	return !outfile.fail();
+}
+
+bool rtPartialImage::merge(const std::string& outFileName, const std::vector<std::string>& partialFileNames)
+{
+	rtVector2<int> imageSize(-1, -1);
+	std::vector<int> rgb;
+	std::vector<bool> covered;
+
+	for (const std::string& partialFileName : partialFileNames)
+	{
+		std::ifstream inFile(partialFileName);
+		std::string magic;
+		int version = 0;
+		rtVector2<int> size;
+		size_t tileCount = 0;
+		inFile >> magic >> version >> size.m_x >> size.m_y >> tileCount;
+		if (inFile.fail() || magic != PARTIAL_MAGIC || version != PARTIAL_VERSION)
+		{
+			std::cout << "Not a partial image: " << partialFileName << std::endl;
+			return false;
+		}
+
+		if (imageSize.m_x < 0)
+		{
+			imageSize = size;
+			rgb.assign(static_cast<size_t>(size.m_x) * size.m_y * 3, 0);
+			covered.assign(static_cast<size_t>(size.m_x) * size.m_y, false);
+		}
+		else if (imageSize.m_x != size.m_x || imageSize.m_y != size.m_y)
+		{
+			std::cout << "Partial image size mismatch: " << partialFileName << std::endl;
+			return false;
+		}
+
+		for (size_t t = 0; t < tileCount; t++)
+		{
+			rtTile tile;
+			inFile >> tile.m_x0 >> tile.m_y0 >> tile.m_x1 >> tile.m_y1;
+			if (inFile.fail() || tile.m_x0 < 0 || tile.m_y0 < 0 || tile.m_x1 > size.m_x || tile.m_y1 > size.m_y)
+			{
+				std::cout << "Corrupted partial image: " << partialFileName << std::endl;
+				return false;
+			}
+			for (int j = tile.m_y0; j < tile.m_y1; j++)
+			{
+				for (int i = tile.m_x0; i < tile.m_x1; i++)
+				{
+					size_t index = static_cast<size_t>(j) * size.m_x + i;
+					inFile >> rgb[index * 3] >> rgb[index * 3 + 1] >> rgb[index * 3 + 2];
+					covered[index] = true;
+				}
+			}
+			if (inFile.fail())
+			{
+				std::cout << "Corrupted partial image: " << partialFileName << std::endl;
+				return false;
+			}
+		}
+	}
+
+	if (imageSize.m_x < 0)
+	{
+		std::cout << "No partial images to merge" << std::endl;
+		return false;
+	}
+
+	size_t missing = 0;
+	for (bool c : covered)
+	{
+		missing += c ? 0 : 1;
+	}
+	if (missing != 0)
+	{
+		std::cout << "Warning: " << missing << " pixels are not covered by any partial image" << std::endl;
+	}
+
+	ppmFileWriter writer(outFileName);
+	return writer.writeImage(rgb, imageSize);
+}
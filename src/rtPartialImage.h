@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rtColor.h"
+#include "rtTile.h"
+
+// partial framebuffer produced by a single shard, see rtShardSpec
+//
+// RTPART 1
+// <image width> <image height>
+// <tile count>
+// then per tile: "x0 y0 x1 y1" followed by its pixels (row-major, 0..255 rgb)
+class rtPartialImage
+{
+public:
+	static bool write(const std::string& fileName, const rtVector2<int>& imageSize, const std::vector<rtTile>& tiles, const std::vector<std::vector<rtColor>>& pixels);
+	static bool merge(const std::string& outFileName, const std::vector<std::string>& partialFileNames);
+};
@@ -0,0 +1,62 @@
+#include "rtQuality.h"
+
+static const char* const QUALITY_NAMES[] = { "preview", "draft", "final" };
+static const char* const SHADOW_MODE_NAMES[] = { "all", "one", "off" };
+
+bool ParseQuality(const std::string& name, eQuality& quality)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(QUALITY_NAMES) / sizeof(QUALITY_NAMES[0])); i++)
+	{
+		if (name == QUALITY_NAMES[i])
+		{
+			quality = static_cast<eQuality>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* QualityName(eQuality quality)
+{
+	return QUALITY_NAMES[static_cast<int>(quality)];
+}
+
+bool ParseShadowMode(const std::string& name, eShadowMode& mode)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(SHADOW_MODE_NAMES) / sizeof(SHADOW_MODE_NAMES[0])); i++)
+	{
+		if (name == SHADOW_MODE_NAMES[i])
+		{
+			mode = static_cast<eShadowMode>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* ShadowModeName(eShadowMode mode)
+{
+	return SHADOW_MODE_NAMES[static_cast<int>(mode)];
+}
+
+rtQualitySettings QualitySettings(eQuality quality)
+{
+	rtQualitySettings settings;
+	switch (quality)
+	{
+	case eQuality::kPreview:
+		settings.m_resolutionScale = 0.25;
+		settings.m_maxDepth = 2;
+		settings.m_shadows = eShadowMode::kOne;
+		settings.m_textureLevel = 3;
+		break;
+	case eQuality::kDraft:
+		settings.m_resolutionScale = 0.5;
+		settings.m_maxDepth = 4;
+		settings.m_textureLevel = 1;
+		break;
+	default:
+		break;
+	}
+	return settings;
+}
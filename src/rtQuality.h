@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+
+// render quality presets. preview traces a quarter of the pixels across, two bounces, one
+// shadow ray per hit and coarse textures, draft sits in between, final is the full render.
+// every level runs the same tracer, only these settings differ
+enum class eQuality
+{
+	kPreview,
+	kDraft,
+	kFinal,
+};
+
+bool ParseQuality(const std::string& name, eQuality& quality);
+const char* QualityName(eQuality quality);
+
+// all lights cast shadow rays, only the strongest one does and its visibility stands for
+// the rest, or none do and every light reaches the hit
+enum class eShadowMode
+{
+	kAll,
+	kOne,
+	kOff,
+};
+
+bool ParseShadowMode(const std::string& name, eShadowMode& mode);
+const char* ShadowModeName(eShadowMode mode);
+
+struct rtQualitySettings
+{
+	// fraction of the image size traced, the image is upscaled to the full size on output
+	double m_resolutionScale = 1.0;
+	// rays deeper than this return the last hit's diffuse color
+	int m_maxDepth = 7;
+	eShadowMode m_shadows = eShadowMode::kAll;
+	// mip level textures are read from at least, 0 is the full resolution
+	int m_textureLevel = 0;
+};
+
+rtQualitySettings QualitySettings(eQuality quality);
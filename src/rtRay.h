@@ -8,5 +8,9 @@ public:
 
 	rtPoint m_origin;
 	rtVector3 m_direction;
+	// ray cone for texture filtering: the footprint's width at the origin and its growth per
+	// unit of distance. secondary rays continue the cone, surface curvature is ignored
+	double m_coneWidth = 0.0;
+	double m_coneSpread = 0.0;
 
 };
\ No newline at end of file
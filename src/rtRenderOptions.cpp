@@ -0,0 +1,374 @@
+#include "rtRenderOptions.h"
+#include <cstdlib>
+#include <iostream>
+
+static bool ReadInt(int argc, char* argv[], int& i, int& value)
+{
+	if (i + 1 >= argc)
+	{
+		return false;
+	}
+	try
+	{
+		value = std::stoi(argv[++i]);
+	}
+	catch (...)
+	{
+		return false;
+	}
+	return true;
+}
+
+bool rtRenderOptions::parse(int argc, char* argv[])
+{
+	m_executable = argc > 0 ? argv[0] : "";
+
+	if (argc >= 2 && std::string(argv[1]) == "--merge")
+	{
+		if (argc < 4)
+		{
+			return false;
+		}
+		m_mergeOutput = argv[2];
+		for (int i = 3; i < argc; i++)
+		{
+			m_mergeInputs.push_back(argv[i]);
+		}
+		return true;
+	}
+
+	if (argc < 4)
+	{
+		return false;
+	}
+
+	m_sceneFile = argv[1];
+	m_outFolder = argv[2];
+	m_textureDir = argv[3];
+
+	for (int i = 4; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool ok = true;
+		if (arg == "--threads")
+		{
+			ok = ReadInt(argc, argv, i, m_threads) && m_threads > 0;
+		}
+		else if (arg == "--tile-size")
+		{
+			ok = ReadInt(argc, argv, i, m_shard.m_tileSize) && m_shard.m_tileSize > 0;
+		}
+		else if (arg == "--region")
+		{
+			m_shard.m_mode = eShardMode::kRect;
+			ok = ReadInt(argc, argv, i, m_shard.m_rect.m_x0) && ReadInt(argc, argv, i, m_shard.m_rect.m_y0)
+				&& ReadInt(argc, argv, i, m_shard.m_rect.m_x1) && ReadInt(argc, argv, i, m_shard.m_rect.m_y1);
+		}
+		else if (arg == "--crop")
+		{
+			m_crop = true;
+			m_shard.m_mode = eShardMode::kRect;
+			ok = ReadInt(argc, argv, i, m_shard.m_rect.m_x0) && ReadInt(argc, argv, i, m_shard.m_rect.m_y0)
+				&& ReadInt(argc, argv, i, m_shard.m_rect.m_x1) && ReadInt(argc, argv, i, m_shard.m_rect.m_y1);
+		}
+		else if (arg == "--crop-into")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_cropInto = argv[++i];
+			}
+		}
+		else if (arg == "--shard")
+		{
+			// k/N, k in [0, N)
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				std::string value = argv[++i];
+				size_t slash = value.find('/');
+				ok = slash != std::string::npos;
+				if (ok)
+				{
+					try
+					{
+						m_shard.m_mode = eShardMode::kInterleaved;
+						m_shard.m_index = std::stoi(value.substr(0, slash));
+						m_shard.m_count = std::stoi(value.substr(slash + 1));
+					}
+					catch (...)
+					{
+						ok = false;
+					}
+				}
+				ok = ok && m_shard.m_count > 0 && m_shard.m_index >= 0 && m_shard.m_index < m_shard.m_count;
+			}
+		}
+		else if (arg == "--partial")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_partialFile = argv[++i];
+			}
+		}
+		else if (arg == "--workers")
+		{
+			ok = ReadInt(argc, argv, i, m_workers) && m_workers > 0;
+		}
+		else if (arg == "--shards")
+		{
+			ok = ReadInt(argc, argv, i, m_shardCount) && m_shardCount > 0;
+		}
+		else if (arg == "--server")
+		{
+			m_server = true;
+		}
+		else if (arg == "--camera-path")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_cameraPath = argv[++i];
+			}
+		}
+		else if (arg == "--watch")
+		{
+			m_watch = true;
+		}
+		else if (arg == "--incremental")
+		{
+			m_incremental = true;
+		}
+		else if (arg == "--compact-geometry")
+		{
+			m_compactGeometry = true;
+		}
+		else if (arg == "--geometry-report")
+		{
+			m_geometryReport = true;
+		}
+		else if (arg == "--light-cutoff")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_lightCutoff = std::atof(argv[++i]);
+				ok = m_lightCutoff >= 0.0 && m_lightCutoff < 1.0;
+			}
+		}
+		else if (arg == "--light-samples")
+		{
+			ok = ReadInt(argc, argv, i, m_lightSamples) && m_lightSamples > 0;
+		}
+		else if (arg == "--accel")
+		{
+			ok = i + 1 < argc && ParseAcceleratorType(argv[++i], m_accelerator);
+		}
+		else if (arg == "--bench-accel")
+		{
+			m_benchAccelerators = true;
+		}
+		else if (arg == "--bvh-build")
+		{
+			ok = i + 1 < argc && ParseBVHBuild(argv[++i], m_bvhBuild);
+		}
+		else if (arg == "--build-report")
+		{
+			m_buildReport = true;
+		}
+		else if (arg == "--startup-report")
+		{
+			m_startupReport = true;
+		}
+		else if (arg == "--numa")
+		{
+			ok = i + 1 < argc && ParseNumaPolicy(argv[++i], m_numaPolicy);
+		}
+		else if (arg == "--numa-report")
+		{
+			m_numaReport = true;
+		}
+		else if (arg == "--bench-numa")
+		{
+			m_benchNuma = true;
+		}
+		else if (arg == "--isa")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				std::string name = argv[++i];
+				m_detectInstructionSet = name == "auto";
+				ok = m_detectInstructionSet || ParseInstructionSet(name, m_instructionSet);
+				if (ok && !m_detectInstructionSet && !InstructionSetSupported(m_instructionSet))
+				{
+					std::cout << "This CPU does not support " << name << ", the best it supports is " << InstructionSetName(DetectInstructionSet()) << std::endl;
+					return false;
+				}
+			}
+		}
+		else if (arg == "--out-of-core")
+		{
+			m_outOfCore = true;
+		}
+		else if (arg == "--checkpoint")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_checkpointFile = argv[++i];
+			}
+		}
+		else if (arg == "--checkpoint-interval")
+		{
+			ok = i + 1 < argc;
+			if (ok)
+			{
+				m_checkpointInterval = std::atof(argv[++i]);
+				ok = m_checkpointInterval >= 0.0;
+			}
+		}
+		else if (arg == "--resume")
+		{
+			m_resume = true;
+		}
+		else if (arg == "--quality")
+		{
+			ok = i + 1 < argc && ParseQuality(argv[++i], m_quality);
+		}
+		else if (arg == "--shadows")
+		{
+			m_overrideShadows = true;
+			ok = i + 1 < argc && ParseShadowMode(argv[++i], m_shadows);
+		}
+		else if (arg == "--texture-filter")
+		{
+			ok = i + 1 < argc && ParseTextureFilter(argv[++i], m_textureFilter);
+		}
+		else if (arg == "--coherent-rays")
+		{
+			m_coherentRays = true;
+		}
+		else if (arg == "--ray-stats")
+		{
+			m_rayStats = true;
+		}
+		else if (arg == "--tile-order" || arg == "--pixel-order")
+		{
+			ok = i + 1 < argc && ParseTraversalOrder(argv[++i], arg == "--tile-order" ? m_shard.m_tileOrder : m_pixelOrder);
+		}
+		else if (arg == "--progressive")
+		{
+			ok = ReadInt(argc, argv, i, m_progressiveInterval) && m_progressiveInterval > 0;
+		}
+		else if (arg == "--jobs")
+		{
+			ok = ReadInt(argc, argv, i, m_maxConcurrentJobs) && m_maxConcurrentJobs > 0;
+		}
+		else
+		{
+			std::cout << "Unknown option: " << arg << std::endl;
+			return false;
+		}
+
+		if (!ok)
+		{
+			std::cout << "Invalid value for option: " << arg << std::endl;
+			return false;
+		}
+	}
+	if (!m_cropInto.empty() && !m_crop)
+	{
+		std::cout << "--crop-into needs --crop" << std::endl;
+		return false;
+	}
+	if (m_workers > 0 && (!m_cameraPath.empty() || m_server))
+	{
+		std::cout << "--workers splits one frame over worker processes, it can't be combined with --camera-path or --server" << std::endl;
+		return false;
+	}
+	if (m_server && m_shard.m_mode != eShardMode::kFull)
+	{
+		std::cout << "--server renders whole frames, it can't be combined with --region or --shard" << std::endl;
+		return false;
+	}
+	if (m_crop && (m_shard.m_mode != eShardMode::kRect || m_workers > 0 || m_server || !m_cameraPath.empty()))
+	{
+		std::cout << "--crop renders one rectangle of a single frame, it can't be combined with shards, servers or camera paths" << std::endl;
+		return false;
+	}
+	if (m_outOfCore && (m_server || !m_cameraPath.empty() || m_workers > 0 || m_shard.m_mode != eShardMode::kFull || m_progressiveInterval > 0
+		|| !m_checkpointFile.empty() || m_benchAccelerators || m_benchNuma))
+	{
+		std::cout << "--out-of-core renders one whole frame, it can't be combined with servers, camera paths, shards, --progressive, --checkpoint or benchmarks" << std::endl;
+		return false;
+	}
+	if (m_quality != eQuality::kFinal && (m_workers > 0 || m_shard.m_mode != eShardMode::kFull || m_outOfCore || !m_checkpointFile.empty()))
+	{
+		std::cout << "--quality " << QualityName(m_quality) << " renders whole frames at a reduced size, it can't be combined with shards, regions, crops, --out-of-core or --checkpoint" << std::endl;
+		return false;
+	}
+	if (m_watch && (m_server || !m_cameraPath.empty() || m_workers > 0 || m_shard.m_mode != eShardMode::kFull || m_outOfCore
+		|| !m_checkpointFile.empty() || m_benchAccelerators || m_benchNuma))
+	{
+		std::cout << "--watch re-renders one whole frame, it can't be combined with servers, camera paths, shards, crops, --out-of-core, --checkpoint or benchmarks" << std::endl;
+		return false;
+	}
+	if (m_incremental && m_cameraPath.empty())
+	{
+		std::cout << "--incremental needs --camera-path" << std::endl;
+		return false;
+	}
+	if (m_resume && m_checkpointFile.empty())
+	{
+		std::cout << "--resume needs --checkpoint" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void rtRenderOptions::printUsage()
+{
+	std::cout << "usage: CPURayTracing <scene file> <output folder> <texture folder> [options]" << std::endl;
+	std::cout << "       CPURayTracing --merge <output ppm> <partial file>..." << std::endl;
+	std::cout << "  --threads N            render tiles on N threads" << std::endl;
+	std::cout << "  --numa p               thread placement: off (default), pin threads to cpus spread over the memory nodes, or replicate the scene on every node too" << std::endl;
+	std::cout << "  --numa-report          print which cpu and node every render thread ran on" << std::endl;
+	std::cout << "  --bench-numa           render unpinned, pinned and replicated and compare the trace times" << std::endl;
+	std::cout << "  --tile-size N          tile edge length in pixels (default 32)" << std::endl;
+	std::cout << "  --region x0 y0 x1 y1   only render this pixel rectangle, write a partial image" << std::endl;
+	std::cout << "  --crop x0 y0 x1 y1     only render this pixel rectangle of the frame, write it as an image of its own" << std::endl;
+	std::cout << "  --crop-into file       write the --crop rectangle into an existing image of the full frame instead" << std::endl;
+	std::cout << "  --shard k/N            only render every N-th tile starting at k, write a partial image" << std::endl;
+	std::cout << "  --partial file         partial image file name for --region/--shard" << std::endl;
+	std::cout << "  --workers N            spawn N worker processes and merge their shards" << std::endl;
+	std::cout << "  --shards N             number of shards handed out to the workers (default 4 per worker)" << std::endl;
+	std::cout << "  --server               keep the scene loaded and read render jobs from stdin" << std::endl;
+	std::cout << "  --camera-path file     render every frame of a camera path in one process" << std::endl;
+	std::cout << "  --watch                keep rendering: after a save of the scene file or a texture, re-trace only what the edit changes" << std::endl;
+	std::cout << "  --incremental          camera paths: when the camera stays put, only re-trace the tiles the frame's moves can change" << std::endl;
+	std::cout << "  --jobs N               render at most N server jobs at the same time (default 2)" << std::endl;
+	std::cout << "  --compact-geometry     keep triangles quantized and compressed instead of in doubles" << std::endl;
+	std::cout << "  --geometry-report      print geometry bytes per triangle and the time spent tracing" << std::endl;
+	std::cout << "  --light-cutoff x       skip lights whose attenuation leaves less than x (0..1) of a material's response" << std::endl;
+	std::cout << "  --light-samples K      cast at most K shadow rays per shading point, chosen by contribution" << std::endl;
+	std::cout << "  --accel a              acceleration structure: bvh2 (default), bvh4 / bvh8 with SIMD node tests, grid, or auto to pick grid or bvh2 per scene" << std::endl;
+	std::cout << "  --bench-accel          render with every acceleration structure and compare build and trace times" << std::endl;
+	std::cout << "  --bvh-build m          how trees are split: median (default), sah (binned surface area heuristic) or lbvh (Morton codes, fastest build)" << std::endl;
+	std::cout << "  --build-report         print the acceleration structure's build time and SAH cost" << std::endl;
+	std::cout << "  --startup-report       print when every startup stage ran, the time to the first ray and its critical path" << std::endl;
+	std::cout << "  --isa s                kernel instruction set: auto (default, detected with cpuid), generic, sse4, avx2 or avx512" << std::endl;
+	std::cout << "  --out-of-core          write finished tiles straight into a binary ppm instead of keeping the image in memory" << std::endl;
+	std::cout << "  --checkpoint file      save the finished tiles to file while rendering, removed once the image is written" << std::endl;
+	std::cout << "  --checkpoint-interval s  seconds between checkpoints (default 60)" << std::endl;
+	std::cout << "  --resume               continue from the --checkpoint file, only tracing the tiles it lacks" << std::endl;
+	std::cout << "  --quality q            preview (quarter size, 2 bounces, one shadow ray, coarse textures), draft (half size, 4 bounces) or final (default)" << std::endl;
+	std::cout << "  --shadows s            all, one (the strongest light's shadow ray stands for every light) or off, overrides the --quality level" << std::endl;
+	std::cout << "  --texture-filter f     nearest (default), bilinear or trilinear, the filtered modes read mip levels sized to the ray's footprint" << std::endl;
+	std::cout << "  --coherent-rays        trace tiles breadth first, sorting secondary rays by direction and origin" << std::endl;
+	std::cout << "  --ray-stats            print the rays traced and rays per second" << std::endl;
+	std::cout << "  --tile-order o         order tiles are rendered in: row (default), column, morton, hilbert or center" << std::endl;
+	std::cout << "  --pixel-order o        order of the pixels inside a tile: column (default), row, morton, hilbert or center" << std::endl;
+	std::cout << "  --progressive N        rewrite the output image after every N finished tiles" << std::endl;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "rtTile.h"
+#include "rtAccelerator.h"
+#include "rtTexture.h"
+#include "rtInstructionSet.h"
+#include "rtNumaTopology.h"
+#include "rtQuality.h"
+
+// command line of CPURayTracing
+//
+//   CPURayTracing <scene file> <output folder> <texture folder> [options]
+//   CPURayTracing --merge <output ppm> <partial file>...
+class rtRenderOptions
+{
+public:
+	bool parse(int argc, char* argv[]);
+	static void printUsage();
+
+	std::string m_executable;
+	std::string m_sceneFile;
+	std::string m_outFolder;
+	std::string m_textureDir;
+
+	int m_threads = 1;
+
+	// thread placement on numa machines
+	eNumaPolicy m_numaPolicy = eNumaPolicy::kOff;
+	bool m_numaReport = false;
+	bool m_benchNuma = false;
+
+	// distributed rendering
+	rtShardSpec m_shard;
+	std::string m_partialFile;
+	int m_workers = 0;
+	int m_shardCount = 0;
+
+	// render server
+	bool m_server = false;
+	int m_maxConcurrentJobs = 2;
+
+	// re-render whenever the scene file or a texture is saved
+	bool m_watch = false;
+
+	// camera animation batch
+	std::string m_cameraPath;
+	bool m_incremental = false;
+
+	// quantized geometry
+	bool m_compactGeometry = false;
+	bool m_geometryReport = false;
+
+	// many lights
+	double m_lightCutoff = 0.0;
+	int m_lightSamples = 0;
+
+	// acceleration structure
+	eAcceleratorType m_accelerator = eAcceleratorType::kBVH2;
+	bool m_benchAccelerators = false;
+	eBVHBuild m_bvhBuild = eBVHBuild::kMedian;
+	bool m_buildReport = false;
+	bool m_startupReport = false;
+
+	// kernel instruction set, detected with cpuid unless given
+	bool m_detectInstructionSet = true;
+	eInstructionSet m_instructionSet = eInstructionSet::kGeneric;
+
+	// crops render only m_shard.m_rect, into an image of its own or into m_cropInto
+	bool m_crop = false;
+	std::string m_cropInto;
+
+	// stream tiles into the output file instead of holding the image
+	bool m_outOfCore = false;
+
+	// checkpointing, the interval is in seconds
+	std::string m_checkpointFile;
+	double m_checkpointInterval = 60.0;
+	bool m_resume = false;
+
+	// quality level, --shadows overrides the level's shadow mode
+	eQuality m_quality = eQuality::kFinal;
+	bool m_overrideShadows = false;
+	eShadowMode m_shadows = eShadowMode::kAll;
+
+	// texture sampling
+	eTextureFilter m_textureFilter = eTextureFilter::kNearest;
+
+	// secondary ray coherence
+	bool m_coherentRays = false;
+	bool m_rayStats = false;
+
+	// render order, the tile order is m_shard.m_tileOrder
+	eTraversalOrder m_pixelOrder = eTraversalOrder::kColumn;
+	int m_progressiveInterval = 0;
+
+	std::string m_mergeOutput;
+	std::vector<std::string> m_mergeInputs;
+};
@@ -0,0 +1,189 @@
+#include "rtRenderServer.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+static bool ReadDoubles(std::istringstream& iss, double* values, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (!(iss >> values[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+rtRenderServer::rtRenderServer(std::unique_ptr<rayTracer> scene, int threadCount, const rtShardSpec& tiling, int maxConcurrentJobs)
+	: m_scene(std::move(scene)), m_threadCount(threadCount), m_tiling(tiling), m_maxConcurrentJobs(std::max(maxConcurrentJobs, 1))
+{
+}
+
+rtRenderServer::~rtRenderServer()
+{
+	WaitForJobs();
+}
+
+void rtRenderServer::Run(std::istream& input)
+{
+	Reply("ready");
+
+	std::string line;
+	while (std::getline(input, line))
+	{
+		std::istringstream iss(line);
+		std::string command;
+		if (!(iss >> command))
+		{
+			continue;
+		}
+
+		if (command == "render")
+		{
+			rtRenderJob job;
+			std::string error;
+			if (!ParseJob(iss, job, error))
+			{
+				Reply("error " + error);
+				continue;
+			}
+			job.m_id = m_nextJobId++;
+			Reply("accepted " + std::to_string(job.m_id));
+			StartJob(job);
+		}
+		else if (command == "wait")
+		{
+			WaitForJobs();
+			Reply("idle");
+		}
+		else if (command == "quit")
+		{
+			break;
+		}
+		else
+		{
+			Reply("error unknown command " + command);
+		}
+	}
+
+	WaitForJobs();
+	Reply("bye");
+}
+
+bool rtRenderServer::ParseJob(std::istringstream& iss, rtRenderJob& job, std::string& error) const
+{
+	job.m_camera = m_scene->GetCamera();
+	if (!(iss >> job.m_outFile))
+	{
+		error = "render requires an output file";
+		return false;
+	}
+
+	std::string block;
+	while (iss >> block)
+	{
+		double values[3];
+		if (block == "eye" && ReadDoubles(iss, values, 3))
+		{
+			job.m_camera.m_eye = rtPoint(values[0], values[1], values[2]);
+		}
+		else if (block == "viewdir" && ReadDoubles(iss, values, 3))
+		{
+			job.m_camera.m_viewDir = rtVector3(values[0], values[1], values[2]);
+		}
+		else if (block == "updir" && ReadDoubles(iss, values, 3))
+		{
+			job.m_camera.m_upDir = rtVector3(values[0], values[1], values[2]);
+		}
+		else if (block == "vfov" && ReadDoubles(iss, values, 1))
+		{
+			job.m_camera.m_vFov = values[0];
+		}
+		else if (block == "imsize" && ReadDoubles(iss, values, 2) && values[0] >= 1 && values[1] >= 1)
+		{
+			job.m_camera.m_imageSize = rtVector2<int>(static_cast<int>(values[0]), static_cast<int>(values[1]));
+		}
+		else
+		{
+			error = "bad camera override " + block;
+			return false;
+		}
+	}
+	return true;
+}
+
+void rtRenderServer::StartJob(const rtRenderJob& job)
+{
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_jobFinished.wait(lock, [this]() { return m_runningJobs < m_maxConcurrentJobs; });
+	JoinFinishedJobs();
+	m_runningJobs++;
+	m_jobThreads.emplace(job.m_id, std::thread([this, job]()
+	{
+		RunJob(job);
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_runningJobs--;
+		m_finishedJobs.push_back(job.m_id);
+		m_jobFinished.notify_all();
+	}));
+}
+
+void rtRenderServer::JoinFinishedJobs()
+{
+	// a thread lists itself as its last step, the joins return at once
+	for (int id : m_finishedJobs)
+	{
+		auto finished = m_jobThreads.find(id);
+		finished->second.join();
+		m_jobThreads.erase(finished);
+	}
+	m_finishedJobs.clear();
+}
+
+void rtRenderServer::RunJob(const rtRenderJob& job)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// geometry and textures stay resident in m_scene, only the frame state is rebuilt
+	std::unique_ptr<rayTracer> frame = m_scene->CreateJobInstance();
+	frame->SetCamera(job.m_camera);
+	if (!frame->PrepareFrame())
+	{
+		Reply("failed " + std::to_string(job.m_id) + " invalid camera");
+		return;
+	}
+
+	frame->ComputePixelColor(m_tiling.buildTiles(frame->GetImageSize()), m_threadCount);
+
+	if (!frame->OutputImage(job.m_outFile))
+	{
+		Reply("failed " + std::to_string(job.m_id) + " can't write " + job.m_outFile);
+		return;
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	Reply("done " + std::to_string(job.m_id) + " " + job.m_outFile + " " + std::to_string(elapsed.count()) + "ms");
+}
+
+void rtRenderServer::WaitForJobs()
+{
+	std::map<int, std::thread> jobThreads;
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		jobThreads.swap(m_jobThreads);
+	}
+	for (auto& jobThread : jobThreads)
+	{
+		jobThread.second.join();
+	}
+	// jobs start on this thread only, so every listed id belonged to a thread joined here
+	std::lock_guard<std::mutex> lock(m_jobMutex);
+	m_finishedJobs.clear();
+}
+
+void rtRenderServer::Reply(const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(m_replyMutex);
+	std::cout << message << std::endl;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rayTracer.h"
+
+struct rtRenderJob
+{
+	int m_id = 0;
+	std::string m_outFile;
+	rtCamera m_camera;
+};
+
+// keeps a loaded scene resident and renders jobs read line by line from a stream
+//
+//   render <output ppm> [eye x y z] [viewdir x y z] [updir x y z] [vfov degrees] [imsize w h]
+//   wait
+//   quit
+//
+// every job starts from the scene file's camera, jobs run concurrently
+class rtRenderServer
+{
+public:
+	rtRenderServer(std::unique_ptr<rayTracer> scene, int threadCount, const rtShardSpec& tiling, int maxConcurrentJobs);
+	~rtRenderServer();
+
+	void Run(std::istream& input);
+
+private:
+	bool ParseJob(std::istringstream& iss, rtRenderJob& job, std::string& error) const;
+	void StartJob(const rtRenderJob& job);
+	void RunJob(const rtRenderJob& job);
+	void WaitForJobs();
+	// m_jobMutex must be held
+	void JoinFinishedJobs();
+	void Reply(const std::string& message);
+
+	std::unique_ptr<rayTracer> m_scene;
+	int m_threadCount;
+	rtShardSpec m_tiling;
+	int m_maxConcurrentJobs;
+
+	int m_nextJobId = 1;
+	int m_runningJobs = 0;
+	std::map<int, std::thread> m_jobThreads;   // by job id
+	std::vector<int> m_finishedJobs;           // ids of threads that are done but not joined
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobFinished;
+	std::mutex m_replyMutex;
+};
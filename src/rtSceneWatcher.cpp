@@ -0,0 +1,216 @@
+#include "rtSceneWatcher.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// saves closer together than this are one change, editors often write a file in several steps
+static constexpr int SETTLE_MILLISECONDS = 50;
+static constexpr int POLL_MILLISECONDS = 100;
+
+rtSceneWatcher::rtSceneWatcher(const rtRenderOptions& options, std::function<std::unique_ptr<rayTracer>()> loadScene)
+	: m_options(options), m_loadScene(std::move(loadScene)), m_sceneFile(options.m_sceneFile), m_textureDir(options.m_textureDir)
+{
+}
+
+rtSceneWatcher::~rtSceneWatcher()
+{
+#ifdef __linux__
+	if (m_inotify >= 0)
+	{
+		close(m_inotify);
+	}
+#endif
+}
+
+bool rtSceneWatcher::StartWatching()
+{
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_CLOEXEC);
+	if (m_inotify >= 0)
+	{
+		// folders rather than files, editors that save by renaming a new file over the old
+		// one would end a watch on the file itself
+		uint32_t events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+		std::filesystem::path sceneDir = m_sceneFile.parent_path().empty() ? std::filesystem::path(".") : m_sceneFile.parent_path();
+		m_sceneWatch = inotify_add_watch(m_inotify, sceneDir.string().c_str(), events);
+		m_textureWatch = inotify_add_watch(m_inotify, m_textureDir.string().c_str(), events);
+		if (m_sceneWatch >= 0)
+		{
+			return true;
+		}
+		close(m_inotify);
+		m_inotify = -1;
+	}
+	std::cout << "watch: inotify unavailable, polling every " << POLL_MILLISECONDS << "ms" << std::endl;
+#endif
+	bool sceneChanged = false;
+	std::vector<std::string> textures;
+	PollChanges(sceneChanged, textures);
+	return std::filesystem::exists(m_sceneFile);
+}
+
+void rtSceneWatcher::PollChanges(bool& sceneChanged, std::vector<std::string>& textures)
+{
+	std::error_code error;
+	auto changed = [&](const std::filesystem::path& file)
+	{
+		auto writeTime = std::filesystem::last_write_time(file, error);
+		if (error)
+		{
+			return false;
+		}
+		// the first sight of a file only remembers its time
+		auto seen = m_writeTimes.find(file);
+		if (seen == m_writeTimes.end())
+		{
+			m_writeTimes.emplace(file, writeTime);
+			return false;
+		}
+		bool written = seen->second != writeTime;
+		seen->second = writeTime;
+		return written;
+	};
+	sceneChanged = changed(m_sceneFile) || sceneChanged;
+	for (const auto& entry : std::filesystem::directory_iterator(m_textureDir, error))
+	{
+		if (entry.is_regular_file(error) && changed(entry.path()))
+		{
+			textures.push_back(entry.path().filename().string());
+		}
+	}
+}
+
+void rtSceneWatcher::WaitForChange(bool& sceneChanged, std::vector<std::string>& textures)
+{
+	sceneChanged = false;
+	textures.clear();
+#ifdef __linux__
+	if (m_inotify >= 0)
+	{
+		std::string sceneName = m_sceneFile.filename().string();
+		alignas(inotify_event) char buffer[4096];
+		// wait for the first event, then until the folder is quiet
+		int timeout = -1;
+		pollfd descriptor = { m_inotify, POLLIN, 0 };
+		while (poll(&descriptor, 1, timeout) > 0)
+		{
+			ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+				std::string name = event->len > 0 ? event->name : "";
+				if (event->wd == m_sceneWatch && name == sceneName)
+				{
+					sceneChanged = true;
+				}
+				else if (event->wd == m_textureWatch && !name.empty() && std::find(textures.begin(), textures.end(), name) == textures.end())
+				{
+					textures.push_back(name);
+				}
+			}
+			if (sceneChanged || !textures.empty())
+			{
+				timeout = SETTLE_MILLISECONDS;
+			}
+		}
+		return;
+	}
+#endif
+	while (!sceneChanged && textures.empty())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MILLISECONDS));
+		PollChanges(sceneChanged, textures);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MILLISECONDS));
+	PollChanges(sceneChanged, textures);
+}
+
+void rtSceneWatcher::Render(const rtSceneEdit& edit, std::chrono::steady_clock::time_point saved)
+{
+	std::vector<rtTile> tiles = m_options.m_shard.buildTiles(m_app->GetImageSize());
+	std::vector<rtTile> update = m_app->TilesToUpdate(tiles, edit);
+	if (update.empty())
+	{
+		std::cout << "watch: nothing visible changed" << std::endl;
+		return;
+	}
+
+	// the progressive path shows the tiles traced so far while the rest keep their last pixels
+	int interval = m_options.m_progressiveInterval > 0 ? m_options.m_progressiveInterval : std::max<int>(1, static_cast<int>(tiles.size()) / 8);
+	m_app->SetProgressiveOutput(rayTracer::OutputFilePath(m_options.m_outFolder, m_options.m_sceneFile), interval);
+	m_app->ComputePixelColor(update, m_options.m_threads);
+	m_app->OutputFinalImage(m_options.m_outFolder);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - saved);
+	std::cout << "watch: " << update.size() << " of " << tiles.size() << " tiles traced, written " << elapsed.count() << "ms after the save" << std::endl;
+}
+
+bool rtSceneWatcher::Run(std::unique_ptr<rayTracer> app)
+{
+	m_app = std::move(app);
+	if (!StartWatching())
+	{
+		std::cout << "watch: can't watch " << m_sceneFile.string() << std::endl;
+		return false;
+	}
+	ObjFileReader baseline(m_options.m_sceneFile);
+	baseline.setSettingsOnly(true);
+	baseline.parseFile();
+	m_geometryHash = baseline.getGeometryHash();
+
+	m_app->SetDependencyRecording(true);
+	Render(rtSceneEdit(), std::chrono::steady_clock::now());
+	std::cout << "watch: waiting for " << m_sceneFile.string() << " or " << m_textureDir.string() << " to change" << std::endl;
+
+	while (true)
+	{
+		bool sceneChanged = false;
+		std::vector<std::string> textures;
+		WaitForChange(sceneChanged, textures);
+		auto saved = std::chrono::steady_clock::now();
+
+		rtSceneEdit edit;
+		if (!sceneChanged)
+		{
+			// files in the texture folder no material reads change nothing
+			m_app->ApplySceneSettings(nullptr, textures, edit);
+			if (!edit.empty())
+			{
+				Render(edit, saved);
+			}
+			continue;
+		}
+
+		// only the lines geometry doesn't depend on are parsed, the rest is compared by hash
+		ObjFileReader settings(m_options.m_sceneFile);
+		settings.setSettingsOnly(true);
+		if (eParseRetType::kSuccess != settings.parseFile())
+		{
+			std::cout << "watch: keeping the last image until the scene parses again" << std::endl;
+			continue;
+		}
+		if (settings.getGeometryHash() == m_geometryHash)
+		{
+			m_app->ApplySceneSettings(settings.getFileInfo().get(), textures, edit);
+			Render(edit, saved);
+			continue;
+		}
+
+		std::cout << "watch: geometry changed, loading the scene again" << std::endl;
+		std::unique_ptr<rayTracer> reloaded = m_loadScene();
+		if (!reloaded)
+		{
+			std::cout << "watch: keeping the last image until the scene loads again" << std::endl;
+			continue;
+		}
+		m_app = std::move(reloaded);
+		m_app->SetDependencyRecording(true);
+		m_geometryHash = settings.getGeometryHash();
+		Render(rtSceneEdit(), saved);
+	}
+}
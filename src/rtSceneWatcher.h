@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "rayTracer.h"
+#include "rtRenderOptions.h"
+
+// --watch: renders the scene, then waits for the scene file or a file in the texture folder to
+// be saved and renders again. a save that only changes camera, bkgcolor, mtlcolor, texture or
+// light lines is applied to the loaded scene, keeping geometry, acceleration structure and
+// unchanged textures, and only the tiles it can change are traced again. other edits load the
+// scene again. files are watched with inotify on linux, their write times are polled elsewhere
+class rtSceneWatcher
+{
+public:
+	// loadScene parses the scene and sets up a tracer for it, null on failure
+	rtSceneWatcher(const rtRenderOptions& options, std::function<std::unique_ptr<rayTracer>()> loadScene);
+	~rtSceneWatcher();
+
+	// renders app's scene and every saved version after it, returns only if watching fails
+	bool Run(std::unique_ptr<rayTracer> app);
+
+private:
+	bool StartWatching();
+	// blocks until watched files were saved and no more saves followed for a moment.
+	// texture receives the names of the saved files in the texture folder
+	void WaitForChange(bool& sceneChanged, std::vector<std::string>& textures);
+	void PollChanges(bool& sceneChanged, std::vector<std::string>& textures);
+	void Render(const rtSceneEdit& edit, std::chrono::steady_clock::time_point saved);
+
+	rtRenderOptions m_options;
+	std::function<std::unique_ptr<rayTracer>()> m_loadScene;
+	std::unique_ptr<rayTracer> m_app;
+	uint64_t m_geometryHash = 0;
+
+	std::filesystem::path m_sceneFile;
+	std::filesystem::path m_textureDir;
+	// inotify descriptor and the watches of the scene's folder and the texture folder
+	int m_inotify = -1;
+	int m_sceneWatch = -1;
+	int m_textureWatch = -1;
+	// polling: last seen write time of the scene file and every texture file
+	std::map<std::filesystem::path, std::filesystem::file_time_type> m_writeTimes;
+};
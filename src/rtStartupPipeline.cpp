@@ -0,0 +1,160 @@
+#include "rtStartupPipeline.h"
+#include <future>
+#include <iomanip>
+#include <iostream>
+
+static const char* const STAGE_NAMES[] = { "parse", "textures", "materials", "acceleration", "frame setup", "trace" };
+
+// the stages each one waits for
+static const std::vector<eStartupStage> STAGE_INPUTS[] = {
+	{},
+	{},
+	{ eStartupStage::kParse, eStartupStage::kTextures },
+	{ eStartupStage::kParse },
+	{ eStartupStage::kParse },
+	{ eStartupStage::kMaterials, eStartupStage::kAcceleration, eStartupStage::kFrameSetup },
+};
+
+rtStartupPipeline::rtStartupPipeline()
+	: m_origin(std::chrono::steady_clock::now())
+{
+}
+
+double rtStartupPipeline::Now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_origin).count();
+}
+
+template <typename Work>
+auto rtStartupPipeline::Timed(eStartupStage stage, Work&& work) -> decltype(work())
+{
+	// every stage writes only its own span, no lock is needed
+	rtStageSpan& span = m_stages[static_cast<int>(stage)];
+	span.m_start = Now();
+	auto result = work();
+	span.m_end = Now();
+	return result;
+}
+
+bool rtStartupPipeline::Run(rayTracer& app, const rtRenderOptions& options, bool prepareFrame)
+{
+	// texture decoding needs only the file names, each file decodes on a thread of its own
+	auto textures = std::async(std::launch::async, [&]()
+	{
+		return Timed(eStartupStage::kTextures, [&]()
+		{
+			std::vector<std::string> fileNames = ObjFileReader::scanTextureFiles(options.m_sceneFile);
+			std::vector<std::future<rtTexture>> decodes;
+			for (const std::string& fileName : fileNames)
+			{
+				decodes.push_back(std::async(std::launch::async, rtMaterialTable::loadTexture, options.m_textureDir, fileName));
+			}
+			rtDecodedTextures decoded;
+			for (size_t i = 0; i < fileNames.size(); i++)
+			{
+				decoded.emplace(fileNames[i], std::make_shared<const rtTexture>(decodes[i].get()));
+			}
+			return decoded;
+		});
+	});
+
+	bool parsed = Timed(eStartupStage::kParse, [&]()
+	{
+		if (!app.Init(options.m_sceneFile))
+		{
+			return false;
+		}
+		return !options.m_compactGeometry || app.CompactGeometry();
+	});
+	if (!parsed)
+	{
+		textures.wait();
+		return false;
+	}
+
+	// the three read the parsed scene and write disjoint parts of the tracer
+	auto acceleration = std::async(std::launch::async, [&]()
+	{
+		return Timed(eStartupStage::kAcceleration, [&]()
+		{
+			app.BuildAccelerationStructure();
+			return true;
+		});
+	});
+	std::future<bool> frameSetup;
+	if (prepareFrame)
+	{
+		frameSetup = std::async(std::launch::async, [&]()
+		{
+			return Timed(eStartupStage::kFrameSetup, [&]() { return app.PrepareFrame(); });
+		});
+	}
+	rtDecodedTextures decoded = textures.get();
+	bool ok = Timed(eStartupStage::kMaterials, [&]() { return app.ReadTextureFiles(options.m_textureDir, decoded); });
+
+	ok = acceleration.get() && ok;
+	if (prepareFrame)
+	{
+		ok = frameSetup.get() && ok;
+	}
+	return ok;
+}
+
+void rtStartupPipeline::TracingStarted()
+{
+	rtStageSpan& trace = m_stages[static_cast<int>(eStartupStage::kTrace)];
+	trace.m_start = Now();
+	trace.m_end = trace.m_start;
+}
+
+void rtStartupPipeline::PrintReport() const
+{
+	const rtStageSpan& trace = m_stages[static_cast<int>(eStartupStage::kTrace)];
+	std::cout << std::fixed << std::setprecision(1);
+	double sequential = 0.0;
+	for (int s = 0; s < static_cast<int>(eStartupStage::kTrace); s++)
+	{
+		sequential += m_stages[s].m_start >= 0.0 ? m_stages[s].m_end - m_stages[s].m_start : 0.0;
+	}
+	std::cout << "startup: first ray after " << trace.m_start << "ms, the stages add up to " << sequential << "ms" << std::endl;
+	for (int s = 0; s < static_cast<int>(eStartupStage::kTrace); s++)
+	{
+		const rtStageSpan& span = m_stages[s];
+		if (span.m_start < 0.0)
+		{
+			continue;
+		}
+		std::cout << "  " << std::left << std::setw(14) << STAGE_NAMES[s] << std::right << std::setw(9) << span.m_start << " -> "
+			<< std::setw(9) << span.m_end << "ms" << std::endl;
+	}
+
+	// walk back from the first ray through the input that finished last
+	std::vector<eStartupStage> path;
+	eStartupStage stage = eStartupStage::kTrace;
+	while (true)
+	{
+		int latest = -1;
+		for (eStartupStage input : STAGE_INPUTS[static_cast<int>(stage)])
+		{
+			const rtStageSpan& span = m_stages[static_cast<int>(input)];
+			if (span.m_start >= 0.0 && (latest < 0 || span.m_end > m_stages[latest].m_end))
+			{
+				latest = static_cast<int>(input);
+			}
+		}
+		if (latest < 0)
+		{
+			break;
+		}
+		stage = static_cast<eStartupStage>(latest);
+		path.insert(path.begin(), stage);
+	}
+	std::cout << "  critical path:";
+	for (eStartupStage step : path)
+	{
+		const rtStageSpan& span = m_stages[static_cast<int>(step)];
+		std::cout << " " << STAGE_NAMES[static_cast<int>(step)] << " (" << span.m_end - span.m_start << "ms) >";
+	}
+	std::cout << " first ray" << std::endl;
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include "rayTracer.h"
+#include "rtRenderOptions.h"
+
+enum class eStartupStage
+{
+	kParse,
+	kTextures,
+	kMaterials,
+	kAcceleration,
+	kFrameSetup,
+	kTrace,
+	kCount,
+};
+
+// runs the startup stages as soon as their inputs are ready instead of one after another:
+// textures decode while the scene parses, then the material table, the acceleration
+// structure and the frame setup are built side by side
+class rtStartupPipeline
+{
+public:
+	rtStartupPipeline();
+
+	// prepareFrame also runs the camera dependent setup, PrepareFrame's steps. the tracer's
+	// options are expected to be set already
+	bool Run(rayTracer& app, const rtRenderOptions& options, bool prepareFrame);
+	// marks the first ray, ends the startup
+	void TracingStarted();
+	// every stage's span, the time to first ray and the chain of stages that determined it
+	void PrintReport() const;
+
+private:
+	struct rtStageSpan
+	{
+		double m_start = -1.0; // milliseconds since the pipeline was created, -1 if it didn't run
+		double m_end = -1.0;
+	};
+
+	template <typename Work>
+	auto Timed(eStartupStage stage, Work&& work) -> decltype(work());
+	double Now() const;
+
+	std::chrono::steady_clock::time_point m_origin;
+	rtStageSpan m_stages[static_cast<int>(eStartupStage::kCount)];
+};
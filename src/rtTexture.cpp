@@ -0,0 +1,180 @@
+#include "rtTexture.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr int TEXTURE_TILE_SHIFT = 3;
+static constexpr int TEXTURE_TILE_SIZE = 1 << TEXTURE_TILE_SHIFT;
+
+static const char* const FILTER_NAMES[] = { "nearest", "bilinear", "trilinear" };
+
+bool ParseTextureFilter(const std::string& name, eTextureFilter& filter)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(FILTER_NAMES) / sizeof(FILTER_NAMES[0])); i++)
+	{
+		if (name == FILTER_NAMES[i])
+		{
+			filter = static_cast<eTextureFilter>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* TextureFilterName(eTextureFilter filter)
+{
+	return FILTER_NAMES[static_cast<int>(filter)];
+}
+
+static uint8_t ToChannel(double c)
+{
+	return static_cast<uint8_t>(std::min(std::max(c, 0.0), 255.0) + 0.5);
+}
+
+rtTexture::rtTexture(const std::vector<rtColor>& texels, const rtVector2<int>& size)
+	: m_size(size)
+{
+	if (size.m_x <= 0 || size.m_y <= 0 || texels.size() < static_cast<size_t>(size.m_x) * size.m_y)
+	{
+		m_size = rtVector2<int>();
+		return;
+	}
+
+	// lay out the chain, every level padded to whole tiles
+	size_t texelCount = 0;
+	int width = size.m_x;
+	int height = size.m_y;
+	while (true)
+	{
+		rtLevel level;
+		level.m_width = width;
+		level.m_height = height;
+		level.m_tilesX = (width + TEXTURE_TILE_SIZE - 1) >> TEXTURE_TILE_SHIFT;
+		level.m_offset = texelCount;
+		m_levels.push_back(level);
+		texelCount += static_cast<size_t>(level.m_tilesX) * ((height + TEXTURE_TILE_SIZE - 1) >> TEXTURE_TILE_SHIFT) * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+		if (width == 1 && height == 1)
+		{
+			break;
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	m_texels.assign(texelCount, rtTexel());
+
+	const rtLevel& full = m_levels[0];
+	for (int y = 0; y < full.m_height; y++)
+	{
+		for (int x = 0; x < full.m_width; x++)
+		{
+			const rtColor& c = texels[static_cast<size_t>(y) * full.m_width + x];
+			rtTexel& t = m_texels[texelIndex(full, x, y)];
+			t.m_r = ToChannel(c.m_r);
+			t.m_g = ToChannel(c.m_g);
+			t.m_b = ToChannel(c.m_b);
+		}
+	}
+
+	// box filter every level from the one above, odd edges repeat their last texel
+	for (size_t l = 1; l < m_levels.size(); l++)
+	{
+		const rtLevel& above = m_levels[l - 1];
+		const rtLevel& level = m_levels[l];
+		for (int y = 0; y < level.m_height; y++)
+		{
+			for (int x = 0; x < level.m_width; x++)
+			{
+				int x0 = std::min(2 * x, above.m_width - 1), x1 = std::min(2 * x + 1, above.m_width - 1);
+				int y0 = std::min(2 * y, above.m_height - 1), y1 = std::min(2 * y + 1, above.m_height - 1);
+				const rtTexel* quad[4] = { &texel(above, x0, y0), &texel(above, x1, y0), &texel(above, x0, y1), &texel(above, x1, y1) };
+				rtTexel& t = m_texels[texelIndex(level, x, y)];
+				t.m_r = ToChannel((quad[0]->m_r + quad[1]->m_r + quad[2]->m_r + quad[3]->m_r) * 0.25);
+				t.m_g = ToChannel((quad[0]->m_g + quad[1]->m_g + quad[2]->m_g + quad[3]->m_g) * 0.25);
+				t.m_b = ToChannel((quad[0]->m_b + quad[1]->m_b + quad[2]->m_b + quad[3]->m_b) * 0.25);
+			}
+		}
+	}
+}
+
+size_t rtTexture::texelIndex(const rtLevel& level, int x, int y) const
+{
+	size_t tile = static_cast<size_t>(y >> TEXTURE_TILE_SHIFT) * level.m_tilesX + (x >> TEXTURE_TILE_SHIFT);
+	int inTile = ((y & (TEXTURE_TILE_SIZE - 1)) << TEXTURE_TILE_SHIFT) | (x & (TEXTURE_TILE_SIZE - 1));
+	return level.m_offset + (tile << (2 * TEXTURE_TILE_SHIFT)) + inTile;
+}
+
+const rtTexel& rtTexture::texel(const rtLevel& level, int x, int y) const
+{
+	return m_texels[texelIndex(level, x, y)];
+}
+
+rtColor rtTexture::sample(double u, double v) const
+{
+	if (m_levels.empty())
+	{
+		return rtColor();
+	}
+	// texel centers sit at i / (size - 1), the corners of the texture on texel centers
+	const rtLevel& full = m_levels[0];
+	int x = static_cast<int>(std::min(std::max(u * (full.m_width - 1.0) + 0.5, 0.0), full.m_width - 1.0));
+	int y = static_cast<int>(std::min(std::max(v * (full.m_height - 1.0) + 0.5, 0.0), full.m_height - 1.0));
+	const rtTexel& t = texel(full, x, y);
+	return rtColor(t.m_r, t.m_g, t.m_b);
+}
+
+rtColor rtTexture::sampleLevel(double u, double v, int level) const
+{
+	if (m_levels.empty())
+	{
+		return rtColor();
+	}
+	const rtLevel& coarse = m_levels[std::min(std::max(level, 0), static_cast<int>(m_levels.size()) - 1)];
+	int x = static_cast<int>(std::min(std::max(u * (coarse.m_width - 1.0) + 0.5, 0.0), coarse.m_width - 1.0));
+	int y = static_cast<int>(std::min(std::max(v * (coarse.m_height - 1.0) + 0.5, 0.0), coarse.m_height - 1.0));
+	const rtTexel& t = texel(coarse, x, y);
+	return rtColor(t.m_r, t.m_g, t.m_b);
+}
+
+rtColor rtTexture::bilinear(const rtLevel& level, double u, double v) const
+{
+	double x = std::min(std::max(u * (level.m_width - 1.0), 0.0), level.m_width - 1.0);
+	double y = std::min(std::max(v * (level.m_height - 1.0), 0.0), level.m_height - 1.0);
+	int x0 = static_cast<int>(x), y0 = static_cast<int>(y);
+	int x1 = std::min(x0 + 1, level.m_width - 1), y1 = std::min(y0 + 1, level.m_height - 1);
+	double fx = x - x0, fy = y - y0;
+
+	const rtTexel& t00 = texel(level, x0, y0);
+	const rtTexel& t10 = texel(level, x1, y0);
+	const rtTexel& t01 = texel(level, x0, y1);
+	const rtTexel& t11 = texel(level, x1, y1);
+	double w00 = (1.0 - fx) * (1.0 - fy), w10 = fx * (1.0 - fy), w01 = (1.0 - fx) * fy, w11 = fx * fy;
+	return rtColor(w00 * t00.m_r + w10 * t10.m_r + w01 * t01.m_r + w11 * t11.m_r,
+		w00 * t00.m_g + w10 * t10.m_g + w01 * t01.m_g + w11 * t11.m_g,
+		w00 * t00.m_b + w10 * t10.m_b + w01 * t01.m_b + w11 * t11.m_b);
+}
+
+rtColor rtTexture::sample(double u, double v, double lod, eTextureFilter filter) const
+{
+	if (filter == eTextureFilter::kNearest || m_levels.empty())
+	{
+		return sample(u, v);
+	}
+
+	int lastLevel = static_cast<int>(m_levels.size()) - 1;
+	// NaN footprints read the full resolution level
+	lod = lod > 0.0 ? std::min(lod, static_cast<double>(lastLevel)) : 0.0;
+	if (filter == eTextureFilter::kBilinear)
+	{
+		return bilinear(m_levels[static_cast<int>(lod + 0.5)], u, v);
+	}
+
+	int fine = static_cast<int>(lod);
+	int coarse = std::min(fine + 1, lastLevel);
+	double blend = lod - fine;
+	rtColor a = bilinear(m_levels[fine], u, v);
+	if (blend <= 0.0 || coarse == fine)
+	{
+		return a;
+	}
+	rtColor b = bilinear(m_levels[coarse], u, v);
+	return rtColor(a.m_r + (b.m_r - a.m_r) * blend, a.m_g + (b.m_g - a.m_g) * blend, a.m_b + (b.m_b - a.m_b) * blend);
+}
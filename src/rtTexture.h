@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "rtColor.h"
+#include "rtVector.h"
+
+// nearest reads the full resolution level, as textures always were. bilinear blends four
+// texels of the mip level the footprint picks, trilinear also blends the two nearest levels
+enum class eTextureFilter
+{
+	kNearest,
+	kBilinear,
+	kTrilinear,
+};
+
+bool ParseTextureFilter(const std::string& name, eTextureFilter& filter);
+const char* TextureFilterName(eTextureFilter filter);
+
+// 8 bits per channel, padded to 4 bytes
+struct rtTexel
+{
+	uint8_t m_r;
+	uint8_t m_g;
+	uint8_t m_b;
+	uint8_t m_pad;
+};
+
+// mip chain of box filtered levels, each halving the last, down to 1x1. every level is stored
+// in 8x8 texel tiles of 256 bytes, so a filter footprint touches few cache lines whichever
+// direction it runs in
+class rtTexture
+{
+public:
+	rtTexture() {}
+	// texels are row-major with colors in 0..255
+	rtTexture(const std::vector<rtColor>& texels, const rtVector2<int>& size);
+
+	// nearest texel of the full resolution level at (u, v) in [0, 1], colors are in 0..255
+	rtColor sample(double u, double v) const;
+	// lod is log2 of the footprint in full resolution texels
+	rtColor sample(double u, double v, double lod, eTextureFilter filter) const;
+	// nearest texel of mip level, clamped to the coarsest
+	rtColor sampleLevel(double u, double v, int level) const;
+
+	bool empty() const { return m_texels.empty(); }
+	const rtVector2<int>& size() const { return m_size; }
+	int levelCount() const { return static_cast<int>(m_levels.size()); }
+
+private:
+	struct rtLevel
+	{
+		int m_width;
+		int m_height;
+		int m_tilesX;
+		size_t m_offset;
+	};
+
+	size_t texelIndex(const rtLevel& level, int x, int y) const;
+	const rtTexel& texel(const rtLevel& level, int x, int y) const;
+	rtColor bilinear(const rtLevel& level, double u, double v) const;
+
+	std::vector<rtLevel> m_levels;
+	std::vector<rtTexel> m_texels;
+	rtVector2<int> m_size;
+};
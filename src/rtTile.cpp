@@ -0,0 +1,50 @@
+#include "rtTile.h"
+#include <algorithm>
+
+std::vector<rtTile> rtShardSpec::buildTiles(const rtVector2<int>& imageSize) const
+{
+	rtTile area(0, 0, imageSize.m_x, imageSize.m_y);
+	if (m_mode == eShardMode::kRect)
+	{
+		area.m_x0 = std::max(area.m_x0, m_rect.m_x0);
+		area.m_y0 = std::max(area.m_y0, m_rect.m_y0);
+		area.m_x1 = std::min(area.m_x1, m_rect.m_x1);
+		area.m_y1 = std::min(area.m_y1, m_rect.m_y1);
+	}
+
+	std::vector<rtTile> tiles;
+	if (area.empty())
+	{
+		return tiles;
+	}
+
+	int tileSize = std::max(m_tileSize, 1);
+	int columns = (area.width() + tileSize - 1) / tileSize;
+	int rows = (area.height() + tileSize - 1) / tileSize;
+	std::vector<std::pair<uint64_t, rtTile>> ordered;
+	int tileIndex = 0;
+	for (int y = area.m_y0; y < area.m_y1; y += tileSize)
+	{
+		for (int x = area.m_x0; x < area.m_x1; x += tileSize, tileIndex++)
+		{
+			// interleaved shards take every m_count-th tile so the work stays balanced
+			if (m_mode == eShardMode::kInterleaved && tileIndex % m_count != m_index)
+			{
+				continue;
+			}
+			uint64_t key = TraversalKey(m_tileOrder, (x - area.m_x0) / tileSize, (y - area.m_y0) / tileSize, columns, rows);
+			ordered.emplace_back(key, rtTile(x, y, std::min(x + tileSize, area.m_x1), std::min(y + tileSize, area.m_y1)));
+		}
+	}
+
+	// shards pick their tiles in row order above, so every order splits the image the same way
+	std::stable_sort(ordered.begin(), ordered.end(), [](const std::pair<uint64_t, rtTile>& a, const std::pair<uint64_t, rtTile>& b)
+	{
+		return a.first < b.first;
+	});
+	for (const auto& entry : ordered)
+	{
+		tiles.push_back(entry.second);
+	}
+	return tiles;
+}
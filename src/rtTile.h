@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "rtVector.h"
+#include "rtTraversalOrder.h"
+
+// half-open pixel rectangle [m_x0, m_x1) x [m_y0, m_y1)
+struct rtTile
+{
+	rtTile() {}
+	rtTile(int _x0, int _y0, int _x1, int _y1)
+		: m_x0(_x0), m_y0(_y0), m_x1(_x1), m_y1(_y1) {}
+
+	int width() const { return m_x1 - m_x0; }
+	int height() const { return m_y1 - m_y0; }
+	bool empty() const { return m_x1 <= m_x0 || m_y1 <= m_y0; }
+
+	int m_x0 = 0;
+	int m_y0 = 0;
+	int m_x1 = 0;
+	int m_y1 = 0;
+};
+
+enum class eShardMode
+{
+	kFull,
+	kRect,
+	kInterleaved,
+};
+
+// describes which part of the image a single render process is responsible for
+struct rtShardSpec
+{
+	std::vector<rtTile> buildTiles(const rtVector2<int>& imageSize) const;
+
+	eShardMode m_mode = eShardMode::kFull;
+	rtTile m_rect;
+	int m_index = 0;
+	int m_count = 1;
+	int m_tileSize = 32;
+	// order of the returned tiles, which is the order they are rendered in
+	eTraversalOrder m_tileOrder = eTraversalOrder::kRow;
+};
@@ -0,0 +1,91 @@
+#include "rtTiledImageFile.h"
+#include <filesystem>
+#include <iostream>
+
+bool rtTiledImageFile::create(const std::string& fileName, const rtVector2<int>& imageSize)
+{
+	m_fileName = fileName;
+	m_imageSize = imageSize;
+	std::string header = "P6\n" + std::to_string(imageSize.m_x) + ' ' + std::to_string(imageSize.m_y) + "\n255\n";
+	m_dataStart = static_cast<std::streamoff>(header.size());
+	{
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		file.write(header.data(), header.size());
+		if (file.fail())
+		{
+			std::cout << "Can't write image: " << fileName << std::endl;
+			return false;
+		}
+	}
+
+	// the file system hands out the space lazily, unwritten ranges read as zeros
+	std::error_code error;
+	std::filesystem::resize_file(fileName, m_dataStart + static_cast<uintmax_t>(imageSize.m_x) * imageSize.m_y * 3, error);
+	if (error)
+	{
+		std::cout << "Can't size image: " << fileName << " (" << error.message() << ")" << std::endl;
+		return false;
+	}
+	m_file.open(fileName, std::ios::binary | std::ios::in | std::ios::out);
+	if (m_file.fail())
+	{
+		std::cout << "Can't write image: " << fileName << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool rtTiledImageFile::open(const std::string& fileName, const rtVector2<int>& imageSize)
+{
+	m_fileName = fileName;
+	m_imageSize = imageSize;
+	m_file.open(fileName, std::ios::binary | std::ios::in | std::ios::out);
+	std::string magic;
+	int width = 0, height = 0, maxValue = 0;
+	m_file >> magic >> width >> height >> maxValue;
+	if (m_file.fail() || magic != "P6" || maxValue != 255)
+	{
+		std::cout << "Not a binary ppm: " << fileName << std::endl;
+		return false;
+	}
+	if (width != imageSize.m_x || height != imageSize.m_y)
+	{
+		std::cout << "Image is " << width << "x" << height << ", not " << imageSize.m_x << "x" << imageSize.m_y << ": " << fileName << std::endl;
+		return false;
+	}
+	// a single whitespace character ends the header
+	m_dataStart = static_cast<std::streamoff>(m_file.tellg()) + 1;
+	return true;
+}
+
+bool rtTiledImageFile::writeTile(const rtTile& tile, const std::vector<rtColor>& pixels)
+{
+	// one image row of the tile at a time, rows are contiguous in the file
+	std::vector<char> row(static_cast<size_t>(tile.width()) * 3);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (int j = tile.m_y0; j < tile.m_y1; j++)
+	{
+		for (int i = tile.m_x0; i < tile.m_x1; i++)
+		{
+			rtColor pixel = pixels[static_cast<size_t>(i - tile.m_x0) * tile.height() + (j - tile.m_y0)];
+			size_t offset = static_cast<size_t>(i - tile.m_x0) * 3;
+			row[offset] = static_cast<char>(pixel.rtoi());
+			row[offset + 1] = static_cast<char>(pixel.gtoi());
+			row[offset + 2] = static_cast<char>(pixel.btoi());
+		}
+		m_file.seekp(m_dataStart + (static_cast<std::streamoff>(j) * m_imageSize.m_x + tile.m_x0) * 3);
+		m_file.write(row.data(), row.size());
+	}
+	if (m_file.fail())
+	{
+		std::cout << "Can't write image: " << m_fileName << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool rtTiledImageFile::close()
+{
+	m_file.close();
+	return !m_file.fail();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "rtColor.h"
+#include "rtTile.h"
+
+// binary ppm (P6) on disk, sized for the whole image when it is created so finished tiles can
+// be written into place in any order without the image ever being held in memory. pixels that
+// are never written stay black
+class rtTiledImageFile
+{
+public:
+	bool create(const std::string& fileName, const rtVector2<int>& imageSize);
+	// an existing binary ppm of imageSize, its other pixels are kept
+	bool open(const std::string& fileName, const rtVector2<int>& imageSize);
+	// pixels holds the tile column by column, pixel (i, j) at (i - x0) * height + (j - y0).
+	// safe to call from several threads
+	bool writeTile(const rtTile& tile, const std::vector<rtColor>& pixels);
+	bool close();
+
+private:
+	std::fstream m_file;
+	std::mutex m_mutex;
+	std::string m_fileName;
+	rtVector2<int> m_imageSize;
+	std::streamoff m_dataStart = 0;
+};
@@ -0,0 +1,118 @@
+#include "rtTransform.h"
+#include <cmath>
+#include <corecrt_math_defines.h>
+
+rtTransform::rtTransform()
+{
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m_m[r][c] = r == c ? 1.0 : 0.0;
+		}
+	}
+}
+
+rtTransform rtTransform::translate(const rtVector3& t)
+{
+	rtTransform ans;
+	ans.m_m[0][3] = t.m_x;
+	ans.m_m[1][3] = t.m_y;
+	ans.m_m[2][3] = t.m_z;
+	return ans;
+}
+
+rtTransform rtTransform::scale(const rtVector3& s)
+{
+	rtTransform ans;
+	ans.m_m[0][0] = s.m_x;
+	ans.m_m[1][1] = s.m_y;
+	ans.m_m[2][2] = s.m_z;
+	return ans;
+}
+
+rtTransform rtTransform::rotate(const rtVector3& axis, double degrees)
+{
+	rtVector3 a = axis.getTwoNorm();
+	double theta = degrees * M_PI / 180.0;
+	double c = std::cos(theta);
+	double s = std::sin(theta);
+	double t = 1.0 - c;
+
+	rtTransform ans;
+	ans.m_m[0][0] = t * a.m_x * a.m_x + c;
+	ans.m_m[0][1] = t * a.m_x * a.m_y - s * a.m_z;
+	ans.m_m[0][2] = t * a.m_x * a.m_z + s * a.m_y;
+	ans.m_m[1][0] = t * a.m_x * a.m_y + s * a.m_z;
+	ans.m_m[1][1] = t * a.m_y * a.m_y + c;
+	ans.m_m[1][2] = t * a.m_y * a.m_z - s * a.m_x;
+	ans.m_m[2][0] = t * a.m_x * a.m_z - s * a.m_y;
+	ans.m_m[2][1] = t * a.m_y * a.m_z + s * a.m_x;
+	ans.m_m[2][2] = t * a.m_z * a.m_z + c;
+	return ans;
+}
+
+rtTransform rtTransform::multiply(const rtTransform& t) const
+{
+	rtTransform ans;
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			double value = c == 3 ? m_m[r][3] : 0.0;
+			for (int k = 0; k < 3; k++)
+			{
+				value += m_m[r][k] * t.m_m[k][c];
+			}
+			ans.m_m[r][c] = value;
+		}
+	}
+	return ans;
+}
+
+rtTransform rtTransform::inverse() const
+{
+	// inverse of the linear part by cofactors, then the translation
+	const double (&m)[3][4] = m_m;
+	double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			   - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			   + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	double invDet = 1.0 / det;
+
+	rtTransform ans;
+	ans.m_m[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * invDet;
+	ans.m_m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+	ans.m_m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+	ans.m_m[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * invDet;
+	ans.m_m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+	ans.m_m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+	ans.m_m[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * invDet;
+	ans.m_m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+	ans.m_m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+	for (int r = 0; r < 3; r++)
+	{
+		ans.m_m[r][3] = -(ans.m_m[r][0] * m[0][3] + ans.m_m[r][1] * m[1][3] + ans.m_m[r][2] * m[2][3]);
+	}
+	return ans;
+}
+
+rtPoint rtTransform::transformPoint(const rtPoint& p) const
+{
+	return rtPoint(m_m[0][0] * p.m_x + m_m[0][1] * p.m_y + m_m[0][2] * p.m_z + m_m[0][3],
+				   m_m[1][0] * p.m_x + m_m[1][1] * p.m_y + m_m[1][2] * p.m_z + m_m[1][3],
+				   m_m[2][0] * p.m_x + m_m[2][1] * p.m_y + m_m[2][2] * p.m_z + m_m[2][3]);
+}
+
+rtVector3 rtTransform::transformVector(const rtVector3& v) const
+{
+	return rtVector3(m_m[0][0] * v.m_x + m_m[0][1] * v.m_y + m_m[0][2] * v.m_z,
+					 m_m[1][0] * v.m_x + m_m[1][1] * v.m_y + m_m[1][2] * v.m_z,
+					 m_m[2][0] * v.m_x + m_m[2][1] * v.m_y + m_m[2][2] * v.m_z);
+}
+
+rtVector3 rtTransform::transformNormalByInverse(const rtVector3& n) const
+{
+	return rtVector3(m_m[0][0] * n.m_x + m_m[1][0] * n.m_y + m_m[2][0] * n.m_z,
+					 m_m[0][1] * n.m_x + m_m[1][1] * n.m_y + m_m[2][1] * n.m_z,
+					 m_m[0][2] * n.m_x + m_m[1][2] * n.m_y + m_m[2][2] * n.m_z);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "rtPoint.h"
+#include "rtVector.h"
+
+// affine 3x4 transform, points are column vectors: p' = M * p
+class rtTransform
+{
+public:
+	rtTransform();
+
+	static rtTransform translate(const rtVector3& t);
+	static rtTransform scale(const rtVector3& s);
+	// rotation around an arbitrary axis through the origin
+	static rtTransform rotate(const rtVector3& axis, double degrees);
+
+	// this applied after t
+	rtTransform multiply(const rtTransform& t) const;
+	rtTransform inverse() const;
+
+	rtPoint transformPoint(const rtPoint& p) const;
+	rtVector3 transformVector(const rtVector3& v) const;
+	// normals transform with the inverse transpose, call this on the inverse transform
+	rtVector3 transformNormalByInverse(const rtVector3& n) const;
+
+	double m_m[3][4];
+};
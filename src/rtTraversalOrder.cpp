@@ -0,0 +1,88 @@
+#include "rtTraversalOrder.h"
+
+static const char* const ORDER_NAMES[] = { "column", "row", "morton", "hilbert", "center" };
+
+bool ParseTraversalOrder(const std::string& name, eTraversalOrder& order)
+{
+	for (int i = 0; i < static_cast<int>(sizeof(ORDER_NAMES) / sizeof(ORDER_NAMES[0])); i++)
+	{
+		if (name == ORDER_NAMES[i])
+		{
+			order = static_cast<eTraversalOrder>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* TraversalOrderName(eTraversalOrder order)
+{
+	return ORDER_NAMES[static_cast<int>(order)];
+}
+
+static uint64_t SpreadBits(uint32_t x)
+{
+	// 32 bits to the even bits of 64
+	uint64_t v = x;
+	v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+	v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+	v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+	v = (v | (v << 2)) & 0x3333333333333333ull;
+	v = (v | (v << 1)) & 0x5555555555555555ull;
+	return v;
+}
+
+static uint64_t HilbertIndex(uint32_t x, uint32_t y, uint32_t n)
+{
+	// n is a power of two covering the grid
+	uint64_t d = 0;
+	for (uint32_t s = n / 2; s > 0; s /= 2)
+	{
+		uint32_t rx = (x & s) ? 1 : 0;
+		uint32_t ry = (y & s) ? 1 : 0;
+		d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+		// rotate the quadrant so the curve stays continuous
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = s - 1 - (x & (s - 1));
+				y = s - 1 - (y & (s - 1));
+			}
+			uint32_t t = x;
+			x = y;
+			y = t;
+		}
+	}
+	return d;
+}
+
+uint64_t TraversalKey(eTraversalOrder order, int x, int y, int width, int height)
+{
+	switch (order)
+	{
+	case eTraversalOrder::kColumn:
+		return static_cast<uint64_t>(x) * height + y;
+	case eTraversalOrder::kRow:
+		return static_cast<uint64_t>(y) * width + x;
+	case eTraversalOrder::kMorton:
+		return SpreadBits(static_cast<uint32_t>(x)) | (SpreadBits(static_cast<uint32_t>(y)) << 1);
+	case eTraversalOrder::kHilbert:
+	{
+		uint32_t n = 1;
+		while (n < static_cast<uint32_t>(width) || n < static_cast<uint32_t>(height))
+		{
+			n *= 2;
+		}
+		return HilbertIndex(static_cast<uint32_t>(x), static_cast<uint32_t>(y), n);
+	}
+	case eTraversalOrder::kCenter:
+	{
+		// squared distance of the cell center to the grid center, in half cells
+		int64_t dx = 2 * static_cast<int64_t>(x) + 1 - width;
+		int64_t dy = 2 * static_cast<int64_t>(y) + 1 - height;
+		return static_cast<uint64_t>(dx * dx + dy * dy);
+	}
+	}
+	return 0;
+}
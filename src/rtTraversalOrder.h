@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// order in which tiles of the image, or pixels of a tile, are rendered.
+// column and row are plain scans, morton and hilbert follow space filling curves so
+// consecutive cells stay neighbors, center starts in the middle and spirals outwards
+enum class eTraversalOrder
+{
+	kColumn,
+	kRow,
+	kMorton,
+	kHilbert,
+	kCenter,
+};
+
+bool ParseTraversalOrder(const std::string& name, eTraversalOrder& order);
+const char* TraversalOrderName(eTraversalOrder order);
+
+// position of cell (x, y) of a width x height grid along the order, lower keys come first.
+// sort stably, cells with equal keys keep the order they were listed in
+uint64_t TraversalKey(eTraversalOrder order, int x, int y, int width, int height);
+
+// the low 10 bits of x to every third bit of 30, three of them interleave to a 3D Morton code
+inline uint32_t SpreadBitsBy3(uint32_t x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
@@ -0,0 +1,96 @@
+#include "rtWideBVH.h"
+#include <limits>
+
+template <int N>
+void rtWideBVH<N>::build(const rtBVH& binary)
+{
+	m_nodes.clear();
+	m_primIndices = &binary.getPrimIndices();
+	if (binary.empty())
+	{
+		return;
+	}
+	m_nodes.reserve(binary.getNodes().size() / (N - 1) + 1);
+	collapse(binary, 0);
+}
+
+template <int N>
+int rtWideBVH<N>::collapse(const rtBVH& binary, int binaryNode)
+{
+	const std::vector<rtBVHNode>& nodes = binary.getNodes();
+
+	// open the interior child with the largest surface area until N children are gathered
+	int children[N];
+	int childCount = 0;
+	if (nodes[binaryNode].m_primCount > 0)
+	{
+		children[childCount++] = binaryNode;
+	}
+	else
+	{
+		children[childCount++] = binaryNode + 1;
+		children[childCount++] = nodes[binaryNode].m_rightChild;
+	}
+	while (childCount < N)
+	{
+		int widest = -1;
+		double widestArea = -1.0;
+		for (int k = 0; k < childCount; k++)
+		{
+			const rtBVHNode& child = nodes[children[k]];
+			if (child.m_primCount == 0 && child.m_bounds.surfaceArea() > widestArea)
+			{
+				widest = k;
+				widestArea = child.m_bounds.surfaceArea();
+			}
+		}
+		if (widest < 0)
+		{
+			break;
+		}
+		int opened = children[widest];
+		children[widest] = opened + 1;
+		children[childCount++] = nodes[opened].m_rightChild;
+	}
+
+	int nodeIndex = static_cast<int>(m_nodes.size());
+	m_nodes.push_back(rtWideBVHNode<N>());
+	for (int k = 0; k < N; k++)
+	{
+		rtWideBVHNode<N>& node = m_nodes[nodeIndex];
+		if (k >= childCount)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.m_min[axis][k] = std::numeric_limits<double>::quiet_NaN();
+				node.m_max[axis][k] = std::numeric_limits<double>::quiet_NaN();
+			}
+			node.m_child[k] = 0;
+			node.m_count[k] = -1;
+			continue;
+		}
+
+		const rtBVHNode& child = nodes[children[k]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			node.m_min[axis][k] = rtAxis(child.m_bounds.m_min, axis);
+			node.m_max[axis][k] = rtAxis(child.m_bounds.m_max, axis);
+		}
+		if (child.m_primCount > 0)
+		{
+			node.m_child[k] = child.m_firstPrim;
+			node.m_count[k] = child.m_primCount;
+		}
+		else
+		{
+			// collapse() grows m_nodes, node must not be held across it
+			int collapsed = collapse(binary, children[k]);
+			m_nodes[nodeIndex].m_child[k] = collapsed;
+			m_nodes[nodeIndex].m_count[k] = 0;
+		}
+	}
+	return nodeIndex;
+}
+
+template class rtWideBVH<4>;
+template class rtWideBVH<8>;
@@ -0,0 +1,208 @@
+#pragma once
+#include <vector>
+#include "rtBVH.h"
+#include "rtInstructionSet.h"
+#if RT_X86
+#include <immintrin.h>
+#endif
+
+// N children per node, their bounds stored per axis so one vector operation tests the ray
+// against all of them. unused lanes hold NaN boxes, whose entry never compares below the exit
+template <int N>
+struct alignas(64) rtWideBVHNode
+{
+	double m_min[3][N];
+	double m_max[3][N];
+	int m_child[N];   // node index of interior children, first primitive of leaves
+	int m_count[N];   // primitive count of leaves, 0 for interior children, -1 for unused lanes
+};
+
+// ray constants every lane test shares
+struct rtWideRay
+{
+	rtWideRay(const rtRay& ray)
+		: m_origin{ ray.m_origin.m_x, ray.m_origin.m_y, ray.m_origin.m_z },
+		  m_invDir{ 1.0 / ray.m_direction.m_x, 1.0 / ray.m_direction.m_y, 1.0 / ray.m_direction.m_z } {}
+
+	double m_origin[3];
+	double m_invDir[3];
+};
+
+// the vector paths compute rtRayBoxTest's expressions lane for lane. std::min(a, b) is
+// min_pd(b, a) and std::max(a, b) is max_pd(b, a), NaNs included, so every path culls
+// exactly the boxes the binary tree would. they are compiled for their own instruction set
+// and only called from kernels dispatched to it
+#if RT_X86
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+inline unsigned IntersectFourLanesAVX2(const double* const min[3], const double* const max[3], const rtWideRay& ray, double tMax, double* tEntry)
+{
+	__m256d slabNear[3], slabFar[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		__m256d origin = _mm256_set1_pd(ray.m_origin[axis]);
+		__m256d invDir = _mm256_set1_pd(ray.m_invDir[axis]);
+		__m256d t0 = _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(min[axis]), origin), invDir);
+		__m256d t1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_load_pd(max[axis]), origin), invDir);
+		slabNear[axis] = _mm256_min_pd(t1, t0);
+		slabFar[axis] = _mm256_max_pd(t1, t0);
+	}
+	__m256d tNear = _mm256_max_pd(_mm256_max_pd(_mm256_setzero_pd(), slabNear[2]), _mm256_max_pd(slabNear[1], slabNear[0]));
+	__m256d tFar = _mm256_min_pd(_mm256_min_pd(_mm256_set1_pd(tMax), slabFar[2]), _mm256_min_pd(slabFar[1], slabFar[0]));
+	_mm256_storeu_pd(tEntry, tNear);
+	return static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(tNear, tFar, _CMP_LE_OQ)));
+}
+
+#if defined(__GNUC__)
+__attribute__((target("avx512f")))
+#endif
+inline unsigned IntersectEightLanesAVX512(const double* const min[3], const double* const max[3], const rtWideRay& ray, double tMax, double* tEntry)
+{
+	__m512d slabNear[3], slabFar[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		__m512d origin = _mm512_set1_pd(ray.m_origin[axis]);
+		__m512d invDir = _mm512_set1_pd(ray.m_invDir[axis]);
+		__m512d t0 = _mm512_mul_pd(_mm512_sub_pd(_mm512_load_pd(min[axis]), origin), invDir);
+		__m512d t1 = _mm512_mul_pd(_mm512_sub_pd(_mm512_load_pd(max[axis]), origin), invDir);
+		slabNear[axis] = _mm512_min_pd(t1, t0);
+		slabFar[axis] = _mm512_max_pd(t1, t0);
+	}
+	__m512d tNear = _mm512_max_pd(_mm512_max_pd(_mm512_setzero_pd(), slabNear[2]), _mm512_max_pd(slabNear[1], slabNear[0]));
+	__m512d tFar = _mm512_min_pd(_mm512_min_pd(_mm512_set1_pd(tMax), slabFar[2]), _mm512_min_pd(slabFar[1], slabFar[0]));
+	_mm512_storeu_pd(tEntry, tNear);
+	return static_cast<unsigned>(_mm512_cmp_pd_mask(tNear, tFar, _CMP_LE_OQ));
+}
+#endif
+
+// bit k set if lane k is hit before tMax, tEntry[k] receives its entry distance. sse4 has
+// only two lanes and gains nothing over the scalar loop
+template <eInstructionSet Isa, int N>
+inline unsigned IntersectLanes(const rtWideBVHNode<N>& node, const rtWideRay& ray, double tMax, double tEntry[N])
+{
+#if RT_X86
+	if constexpr (Isa >= eInstructionSet::kAVX512 && N == 8)
+	{
+		const double* const min[3] = { node.m_min[0], node.m_min[1], node.m_min[2] };
+		const double* const max[3] = { node.m_max[0], node.m_max[1], node.m_max[2] };
+		return IntersectEightLanesAVX512(min, max, ray, tMax, tEntry);
+	}
+	else if constexpr (Isa >= eInstructionSet::kAVX2)
+	{
+		unsigned mask = 0;
+		for (int first = 0; first < N; first += 4)
+		{
+			const double* const min[3] = { node.m_min[0] + first, node.m_min[1] + first, node.m_min[2] + first };
+			const double* const max[3] = { node.m_max[0] + first, node.m_max[1] + first, node.m_max[2] + first };
+			mask |= IntersectFourLanesAVX2(min, max, ray, tMax, tEntry + first) << first;
+		}
+		return mask;
+	}
+#endif
+	unsigned mask = 0;
+	for (int k = 0; k < N; k++)
+	{
+		double t0x = (node.m_min[0][k] - ray.m_origin[0]) * ray.m_invDir[0];
+		double t1x = (node.m_max[0][k] - ray.m_origin[0]) * ray.m_invDir[0];
+		double t0y = (node.m_min[1][k] - ray.m_origin[1]) * ray.m_invDir[1];
+		double t1y = (node.m_max[1][k] - ray.m_origin[1]) * ray.m_invDir[1];
+		double t0z = (node.m_min[2][k] - ray.m_origin[2]) * ray.m_invDir[2];
+		double t1z = (node.m_max[2][k] - ray.m_origin[2]) * ray.m_invDir[2];
+		double tNear = std::max(std::max(std::min(t0x, t1x), std::min(t0y, t1y)), std::max(std::min(t0z, t1z), 0.0));
+		double tFar = std::min(std::min(std::max(t0x, t1x), std::max(t0y, t1y)), std::min(std::max(t0z, t1z), tMax));
+		tEntry[k] = tNear;
+		mask |= (tNear <= tFar ? 1u : 0u) << k;
+	}
+	return mask;
+}
+
+// bounding volume hierarchy with N (4 or 8) children per node, collapsed from a binary rtBVH
+// by repeatedly opening the child with the largest surface area. it shares the binary tree's
+// primitive order and leaves, and answers the same queries
+template <int N>
+class rtWideBVH
+{
+public:
+	void build(const rtBVH& binary);
+
+	bool empty() const { return m_nodes.empty(); }
+	size_t nodeCount() const { return m_nodes.size(); }
+
+	// same contract as rtBVH::traverse, the node tests use the vector path of Isa
+	template <eInstructionSet Isa, typename Visitor>
+	void traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const;
+
+private:
+	int collapse(const rtBVH& binary, int binaryNode);
+
+	std::vector<rtWideBVHNode<N>> m_nodes;
+	const std::vector<int>* m_primIndices = nullptr;
+};
+
+template <int N>
+template <eInstructionSet Isa, typename Visitor>
+void rtWideBVH<N>::traverse(const rtRay& ray, double& tMax, Visitor&& visitor) const
+{
+	// every node pushes at most N - 1 lanes and the binary tree is at most 64 deep
+	static constexpr int kStackSize = 64 * (N - 1) + 1;
+	struct rtLane
+	{
+		int m_child;
+		int m_count;
+		double m_tEntry;
+	};
+
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	rtWideRay wideRay(ray);
+	rtLane stack[kStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = { 0, 0, 0.0 };
+	const std::vector<int>& primIndices = *m_primIndices;
+
+	while (stackSize > 0)
+	{
+		const rtLane lane = stack[--stackSize];
+		// skip subtrees that start behind a hit found meanwhile
+		if (lane.m_tEntry > tMax)
+		{
+			continue;
+		}
+		if (lane.m_count > 0)
+		{
+			for (int i = 0; i < lane.m_count; i++)
+			{
+				if (!visitor(primIndices[lane.m_child + i], tMax))
+				{
+					return;
+				}
+			}
+			continue;
+		}
+
+		const rtWideBVHNode<N>& node = m_nodes[lane.m_child];
+		alignas(64) double tEntry[N];
+		unsigned mask = IntersectLanes<Isa, N>(node, wideRay, tMax, tEntry);
+
+		// push the hit lanes far to near, so the nearest is popped next
+		int first = stackSize;
+		for (int k = 0; k < N; k++)
+		{
+			if (mask & (1u << k))
+			{
+				rtLane hit = { node.m_child[k], node.m_count[k], tEntry[k] };
+				int slot = stackSize++;
+				while (slot > first && stack[slot - 1].m_tEntry < hit.m_tEntry)
+				{
+					stack[slot] = stack[slot - 1];
+					slot--;
+				}
+				stack[slot] = hit;
+			}
+		}
+	}
+}